@@ -63,6 +63,8 @@ enum {
 	CLEVER_DEEP_COPY,
 	CLEVER_EMPTY_STR,
 	CLEVER_VOID_STR,
+	CLEVER_TO_STRING,
+	CLEVER_COMPARE,
 	NUM_CACHED_PTRS
 };
 
@@ -23,10 +23,14 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <limits>
 #include "interpreter/ast.h"
 #include "compiler/cgvisitor.h"
 #include "compiler/compiler.h"
 #include "compiler/typechecker.h"
+#include "compiler/scope.h"
+#include "compiler/symbol.h"
 #include "vm/opcode.h"
 
 namespace clever { namespace ast {
@@ -61,6 +65,17 @@ inline Opcode* CodeGenVisitor::emit(OpcodeType type, VM::opcode_handler handler,
 	return opcode;
 }
 
+inline Opcode* CodeGenVisitor::emit(OpcodeType type, VM::opcode_handler handler, long addr,
+	ValueVector* op2) {
+	Opcode* opcode = new Opcode(type, handler, addr, op2);
+	m_opcodes.push_back(opcode);
+
+	// Sets the opcode number, which is used by JMP opcodes
+	opcode->setOpNum(getOpNum());
+
+	return opcode;
+}
+
 inline Opcode* CodeGenVisitor::emit(OpcodeType type, VM::opcode_handler handler, Value* op1,
 	ValueVector* op2) {
 	Opcode* opcode = new Opcode(type, handler, op1, op2);
@@ -162,10 +177,68 @@ AST_VISITOR(CodeGenVisitor, UnaryExpr) {
 		->setResult(expr->getValue());
 }
 
+/**
+ * Checks if the expression is a non-assignment String + String operation
+ */
+bool CodeGenVisitor::_is_string_concat(const BinaryExpr* expr) const {
+	if (expr->getOp() != PLUS || expr->isAssigned()) {
+		return false;
+	}
+
+	return expr->getValue()->getTypePtr() == CLEVER_STR
+		&& expr->getLhs()->getValue()->getTypePtr() == CLEVER_STR
+		&& expr->getRhs()->getValue()->getTypePtr() == CLEVER_STR;
+}
+
+/**
+ * Emits the operands of a String concatenation chain (e.g. a + b + c)
+ * in evaluation order, collecting their values into the vector
+ */
+void CodeGenVisitor::_flatten_concat(ASTNode* node, ValueVector* operands,
+	bool is_root) {
+	BinaryExpr* expr = node->asBinaryExpr();
+
+	if (expr == NULL || !_is_string_concat(expr)) {
+		node->acceptVisitor(*this);
+		node->getValue()->addRef();
+		operands->push_back(node->getValue());
+		return;
+	}
+
+	_flatten_concat(expr->getLhs(), operands, false);
+	_flatten_concat(expr->getRhs(), operands, false);
+
+	// The operator data built by the TypeChecker would be owned by the
+	// opcode which is not going to be generated for this node
+	delete expr->getArgsValue();
+
+	if (!is_root) {
+		expr->getCallValue()->delRef();
+		expr->getValue()->delRef();
+	}
+}
+
 /**
  * Generates opcode for binary expression
  */
 AST_VISITOR(CodeGenVisitor, BinaryExpr) {
+	// Chained String concatenation is generated as a single opcode, which
+	// computes the total length once and writes into just one buffer
+	BinaryExpr* lhs_expr = expr->getLhs()->asBinaryExpr();
+	BinaryExpr* rhs_expr = expr->getRhs()->asBinaryExpr();
+
+	if (_is_string_concat(expr)
+		&& ((lhs_expr && _is_string_concat(lhs_expr))
+			|| (rhs_expr && _is_string_concat(rhs_expr)))) {
+		ValueVector* operands = new ValueVector;
+
+		_flatten_concat(expr, operands, true);
+
+		emit(OP_CONCAT, &VM_H(concat), expr->getCallValue(), operands,
+			expr->getValue());
+		return;
+	}
+
 	expr->getLhs()->acceptVisitor(*this);
 
 	Value* rhs;
@@ -235,6 +308,19 @@ AST_VISITOR(CodeGenVisitor, BinaryExpr) {
 AST_VISITOR(CodeGenVisitor, VariableDecl) {
 	ValueVector* args = expr->getArgsValue();
 
+	// Const variables initialized with a constant are known at compile time
+	if (!expr->getConstructorArgs() && expr->getRhs()) {
+		Value* value = _get_constant(expr->getRhs());
+
+		if (value) {
+			if (expr->isConst()) {
+				m_consts[expr->getVariable()->getValue()] = value;
+			} else {
+				m_inits[expr->getVariable()->getValue()] = value;
+			}
+		}
+	}
+
 	if (!expr->getConstructorArgs() && args) {
 		expr->getCallValue()->addRef();
 
@@ -394,18 +480,204 @@ AST_VISITOR(CodeGenVisitor, WhileExpr) {
 	jmpz->setJmpAddr2(getOpNum());
 }
 
+/**
+ * Case value and its jump address
+ */
+typedef std::pair<int64_t, long> SwitchCase;
+typedef std::vector<SwitchCase> SwitchCases;
+
+/**
+ * Distance from the smallest case value to v, computed unsigned since
+ * the labels may span more than int64_t holds
+ */
+static uint64_t _switch_offset(const SwitchCases& cases, int64_t v) {
+	return uint64_t(v) - uint64_t(cases.front().first);
+}
+
+/**
+ * Case values spanning at most twice their count use a jump table
+ */
+static bool _is_dense_switch(const SwitchCases& cases) {
+	if (cases.empty()) {
+		return false;
+	}
+
+	uint64_t span = _switch_offset(cases, cases.back().first);
+
+	// span + 1 would wrap to 0
+	if (span == std::numeric_limits<uint64_t>::max()) {
+		return false;
+	}
+
+	return span + 1 <= cases.size() * 2;
+}
+
+static void _build_jump_table(ValueVector* table, const SwitchCases& cases,
+	long default_addr) {
+	size_t size = size_t(_switch_offset(cases, cases.back().first)) + 1;
+
+	table->push_back(new Value(cases.front().first));
+	table->push_back(new Value(int64_t(default_addr)));
+
+	for (size_t i = 0, k = 0; i < size; ++i) {
+		if (_switch_offset(cases, cases[k].first) == i) {
+			table->push_back(new Value(int64_t(cases[k++].second)));
+		} else {
+			table->push_back(new Value(int64_t(default_addr)));
+		}
+	}
+}
+
+static void _build_search_table(ValueVector* table, const SwitchCases& cases,
+	long default_addr) {
+	table->push_back(new Value(int64_t(default_addr)));
+
+	for (size_t i = 0, j = cases.size(); i < j; ++i) {
+		table->push_back(new Value(cases[i].first));
+		table->push_back(new Value(int64_t(cases[i].second)));
+	}
+}
+
+/**
+ * Looks for a multiplier which maps every case id to its own slot in a
+ * power of two table, growing the table until one is found
+ */
+static void _build_hash_table(ValueVector* table, const SwitchCases& cases,
+	long default_addr) {
+	const size_t id_bits = sizeof(CString::IdType) * 8;
+	size_t bits = 1;
+	CString::IdType mult = 0;
+	std::vector<bool> used;
+
+	while ((size_t(1) << bits) < cases.size() * 2) {
+		++bits;
+	}
+
+	for (bool found = false; !found; ++bits) {
+		// Odd multipliers derived from the golden ratio
+		for (size_t k = 0; !found && k < 256; ++k) {
+			mult = CString::IdType(0x9E3779B97F4A7C15ULL + k * 2);
+			used.assign(size_t(1) << bits, false);
+			found = true;
+
+			for (size_t i = 0, j = cases.size(); found && i < j; ++i) {
+				size_t slot = (CString::IdType(cases[i].first) * mult)
+					>> (id_bits - bits);
+
+				found = !used[slot];
+				used[slot] = true;
+			}
+		}
+		if (found) {
+			break;
+		}
+	}
+
+	size_t size = size_t(1) << bits;
+	size_t shift = id_bits - bits;
+	std::vector<const SwitchCase*> slots(size, static_cast<const SwitchCase*>(NULL));
+
+	for (size_t i = 0, j = cases.size(); i < j; ++i) {
+		slots[(CString::IdType(cases[i].first) * mult) >> shift] = &cases[i];
+	}
+
+	table->push_back(new Value(int64_t(default_addr)));
+	table->push_back(new Value(int64_t(mult)));
+	table->push_back(new Value(int64_t(shift)));
+
+	for (size_t i = 0; i < size; ++i) {
+		if (slots[i]) {
+			table->push_back(new Value(slots[i]->first));
+			table->push_back(new Value(int64_t(slots[i]->second)));
+		} else {
+			table->push_back(new Value(int64_t(0)));
+			table->push_back(new Value(int64_t(default_addr)));
+		}
+	}
+}
+
+/**
+ * Generates opcodes for the switch statement. The dispatch opcode is
+ * chosen from the cases: a jump table for dense Int/Byte values, a binary
+ * search for sparse ones and a perfect hash on the string ids for String.
+ * Cases fall through until a break is found
+ */
+AST_VISITOR(CodeGenVisitor, SwitchExpr) {
+	expr->getExpr()->acceptVisitor(*this);
+
+	Value* value = expr->getExpr()->getValue();
+	value->addRef();
+
+	bool is_str = value->getTypePtr() == CLEVER_STR;
+	ValueVector* table = new ValueVector;
+	Opcode* dispatch;
+
+	// The table is filled when the case addresses are known
+	if (is_str) {
+		dispatch = emit(OP_SWITCH_HASH, &VM_H(switch_hash), value, table);
+	} else {
+		dispatch = emit(OP_SWITCH_SEARCH, &VM_H(switch_search), value, table);
+	}
+
+	const NodeList& nodes = expr->getNodes();
+	SwitchCases cases;
+	long default_addr = -1;
+
+	m_brks.push(OpcodeStack());
+
+	for (size_t i = 0, j = nodes.size(); i < j; ++i) {
+		CaseNode* node = static_cast<CaseNode*>(nodes[i]);
+		long addr = long(getOpNum());
+
+		if (node->isDefault()) {
+			default_addr = addr;
+		} else if (is_str) {
+			cases.push_back(SwitchCase(
+				int64_t(node->getLabelValue()->getStringP()->getId()), addr));
+		} else {
+			cases.push_back(SwitchCase(node->getLabelValue()->getInteger(), addr));
+		}
+
+		node->getBlock()->acceptVisitor(*this);
+	}
+
+	// Points break statements to out of SWITCH block
+	while (!m_brks.top().empty()) {
+		m_brks.top().top()->setJmpAddr1(getOpNum());
+		m_brks.top().pop();
+	}
+	m_brks.pop();
+
+	if (default_addr == -1) {
+		default_addr = long(getOpNum());
+	}
+
+	std::sort(cases.begin(), cases.end());
+
+	if (is_str) {
+		_build_hash_table(table, cases, default_addr);
+	} else if (_is_dense_switch(cases)) {
+		_build_jump_table(table, cases, default_addr);
+		dispatch->setHandler(OP_SWITCH_TABLE, &VM_H(switch_table));
+	} else {
+		_build_search_table(table, cases, default_addr);
+	}
+}
+
 /**
  * Generates the opcode for FOR expression
  */
 AST_VISITOR(CodeGenVisitor, ForExpr) {
 	if (!expr->isIteratorMode()) {
 		Value* value;
+		size_t decl_begin = m_opcodes.size();
 
 		if (expr->getVarDecl() != NULL) {
 			expr->getVarDecl()->acceptVisitor(*this);
 		}
 
 		size_t start_pos = getOpNum();
+		size_t cond_begin = m_opcodes.size();
 
 		if (expr->getCondition()) {
 			expr->getCondition()->acceptVisitor(*this);
@@ -435,6 +707,8 @@ AST_VISITOR(CodeGenVisitor, ForExpr) {
 			m_brks.pop();
 		}
 
+		size_t incr_begin = m_opcodes.size();
+
 		if (expr->getIncrement() != NULL) {
 			expr->getIncrement()->acceptVisitor(*this);
 		}
@@ -442,6 +716,11 @@ AST_VISITOR(CodeGenVisitor, ForExpr) {
 		emit(OP_JMP, &VM_H(jmp), start_pos);
 
 		jmpz->setJmpAddr2(getOpNum());
+
+		if (expr->getVarDecl() && expr->getCondition()
+			&& expr->getIncrement()) {
+			_optimize_array_loop(decl_begin, cond_begin, incr_begin);
+		}
 	}
 }
 
@@ -450,6 +729,11 @@ AST_VISITOR(CodeGenVisitor, ForEachExpr) {
 		return;
 	}
 
+	if (expr->isNative()) {
+		_visit_native_foreach(expr);
+		return;
+	}
+
 	// Iterator constructor call
 	emit(OP_MCALL, &VM_H(mcall), expr->getCtorCallValue(),
 		expr->getCtorArgsValue(),
@@ -476,6 +760,52 @@ AST_VISITOR(CodeGenVisitor, ForEachExpr) {
 	jmpz->setJmpAddr2(getOpNum());
 }
 
+/**
+ * Generates the opcodes for Array and Map iteration:
+ *
+ *   FOREACH_INIT  collection, cursor
+ *   FOREACH_NEXT  end, [collection, cursor, elem, key]
+ *   ...block...
+ *   JMP           FOREACH_NEXT
+ */
+void CodeGenVisitor::_visit_native_foreach(ForEachExpr* expr) {
+	Value* collection = expr->getVar()->getValue();
+	Value* cursor = expr->getCursor();
+	ValueVector* slots = new ValueVector;
+
+	collection->addRef();
+	emit(OP_FOREACH_INIT, &VM_H(foreach_init), collection, cursor, NULL);
+
+	slots->push_back(collection);
+	slots->push_back(cursor);
+	slots->push_back(expr->getElemValue());
+
+	if (expr->getKeyValue()) {
+		slots->push_back(expr->getKeyValue());
+	}
+
+	for (size_t i = 0, j = slots->size(); i < j; ++i) {
+		slots->at(i)->addRef();
+	}
+
+	Opcode* next = emit(OP_FOREACH_NEXT, &VM_H(foreach_next), 0L, slots);
+
+	m_brks.push(OpcodeStack());
+
+	expr->getBlock()->acceptVisitor(*this);
+
+	// Points break statements to out of the loop
+	while (!m_brks.top().empty()) {
+		m_brks.top().top()->setJmpAddr1(getOpNum()+1);
+		m_brks.top().pop();
+	}
+	m_brks.pop();
+
+	emit(OP_JMP, &VM_H(jmp), next->getOpNum()-1);
+
+	next->setJmpAddr1(getOpNum());
+}
+
 /**
  * Generates opcode for break statement
  */
@@ -500,6 +830,10 @@ AST_VISITOR(CodeGenVisitor, FunctionCall) {
 		expr->getArgs()->acceptVisitor(*this);
 	}
 
+	if (_fold_call(expr)) {
+		return;
+	}
+
 	fvalue->addRef();
 	emit(OP_FCALL, &VM_H(fcall), fvalue, arg_values, expr->getValue());
 }
@@ -544,6 +878,11 @@ AST_VISITOR(CodeGenVisitor, FuncDeclaration) {
 	emit(OP_LEAVE, &VM_H(leave));
 
 	jmp->setJmpAddr1(getOpNum());
+
+	if (user_func->isPure()
+		&& _is_foldable(user_func, static_cast<BlockNode*>(expr->getBlock()))) {
+		m_foldable.insert(user_func);
+	}
 }
 
 AST_VISITOR(CodeGenVisitor, FuncPrototype) {
@@ -568,6 +907,17 @@ AST_VISITOR(CodeGenVisitor, ReturnStmt) {
 	emit(OP_RETURN, &VM_H(return), expr_value);
 }
 
+/**
+ * Generates opcode for yield statement
+ */
+AST_VISITOR(CodeGenVisitor, YieldStmt) {
+	Value* expr_value = expr->getExprValue();
+
+	expr_value->addRef();
+
+	emit(OP_YIELD, &VM_H(yield), expr_value);
+}
+
 /**
  * Generates opcodes for class declaration
  */
@@ -604,4 +954,366 @@ AST_VISITOR(CodeGenVisitor, CopyExpr) {
 		expr->getValue());
 }
 
+/**
+ * Compile time evaluation of pure functions
+ */
+
+// Limit of opcodes run when evaluating a call at compile time
+#define CLEVER_FOLD_MAX_OPS 100000
+
+typedef std::set<const Value*> ValueSet;
+
+static bool _is_primitive(const Type* type) {
+	return type == CLEVER_INT || type == CLEVER_DOUBLE || type == CLEVER_BOOL
+		|| type == CLEVER_BYTE || type == CLEVER_STR;
+}
+
+static void _collect_values(Scope* scope, ValueSet& values) {
+	SymbolMap& symbols = scope->getSymbols();
+	SymbolMap::const_iterator it(symbols.begin()), end(symbols.end());
+
+	for (; it != end; ++it) {
+		if (it->second->isValue()) {
+			values.insert(it->second->getValue());
+		}
+	}
+
+	ScopeVector& children = scope->getChildren();
+
+	for (size_t i = 0, j = children.size(); i < j; ++i) {
+		_collect_values(children[i], values);
+	}
+}
+
+/**
+ * Temporaries and literals have no name, named values must be variables
+ * of the function itself
+ */
+static bool _is_local_value(const Value* value, const ValueSet& locals) {
+	return value == NULL || !value->hasName() || locals.count(value);
+}
+
+static bool _is_local_operand(const Operand& op, const ValueSet& locals) {
+	if (op.getType() == VALUE) {
+		return _is_local_value(op.getValue(), locals);
+	}
+
+	if (op.getType() == VECTOR && op.getVector()) {
+		const ValueVector* vec = op.getVector();
+
+		for (size_t i = 0, j = vec->size(); i < j; ++i) {
+			if (!_is_local_value(vec->at(i), locals)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * A pure function can be run at compile time when it only takes and
+ * returns primitive values, and its opcodes only touch its own variables,
+ * call infallible methods on them and call other foldable functions. No
+ * native called while folding can report an error, so nothing has to
+ * unwind through native frames
+ */
+bool CodeGenVisitor::_is_foldable(const Function* func, BlockNode* block) const {
+	if (func->isGenerator() || !_is_primitive(func->getReturnType())) {
+		return false;
+	}
+
+	const FunctionArgs& args = func->getArgs();
+
+	for (size_t i = 0, j = args.size(); i < j; ++i) {
+		if (!_is_primitive(args[i].type)) {
+			return false;
+		}
+	}
+
+	ValueSet locals;
+
+	_collect_values(func->getScope() ? func->getScope() : block->getScope(),
+		locals);
+
+	for (size_t i = func->getOffset() + 1, j = m_opcodes.size(); i < j; ++i) {
+		const Opcode* opcode = m_opcodes[i];
+
+		const Value* op1 = opcode->getOp1().getType() == ADDR
+			? NULL : opcode->getOp1Value();
+
+		if (op1 && op1->isCallable()) {
+			const CallableValue* call = static_cast<const CallableValue*>(op1);
+
+			if (opcode->getType() == OP_FCALL) {
+				if (!call->isNearCall() || (call->getFunction() != func
+					&& !m_foldable.count(call->getFunction()))) {
+					return false;
+				}
+			} else if (!call->isMethod() || !_is_primitive(call->getTypePtr())
+				|| !call->getMethod() || !call->getMethod()->isInfallible()
+				|| !_is_local_value(call->getContext(), locals)) {
+				return false;
+			}
+		} else if (!_is_local_operand(opcode->getOp1(), locals)) {
+			return false;
+		}
+
+		if (!_is_local_operand(opcode->getOp2(), locals)
+			|| !_is_local_operand(opcode->getResult(), locals)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Value* CodeGenVisitor::_get_constant(ASTNode* node) const {
+	Value* value = node->getValue();
+
+	if (value == NULL) {
+		return NULL;
+	}
+
+	if (node->isLiteral()) {
+		return _is_primitive(value->getTypePtr()) ? value : NULL;
+	}
+
+	std::map<const Value*, Value*>::const_iterator it(m_consts.find(value));
+
+	return it == m_consts.end() ? NULL : it->second;
+}
+
+/**
+ * Runs a call to a foldable function with constant arguments, the result
+ * is stored in the call value and no opcode is emitted
+ */
+bool CodeGenVisitor::_fold_call(FunctionCall* expr) {
+	const CallableValue* fvalue = expr->getFuncValue();
+
+	if (!fvalue->isNearCall() || !m_foldable.count(fvalue->getFunction())) {
+		return false;
+	}
+
+	ValueVector args;
+
+	if (expr->getArgs()) {
+		const NodeList& nodes = expr->getArgs()->getNodes();
+
+		for (size_t i = 0, j = nodes.size(); i < j; ++i) {
+			Value* value = _get_constant(nodes[i]);
+
+			if (value == NULL) {
+				return false;
+			}
+			args.push_back(value);
+		}
+	}
+
+	const Value* result = VM::eval(&m_opcodes, fvalue->getFunction(),
+		args.empty() ? NULL : &args, CLEVER_FOLD_MAX_OPS);
+
+	if (result == NULL) {
+		return false;
+	}
+
+	expr->getValue()->copy(result);
+	m_consts[expr->getValue()] = expr->getValue();
+
+	// Release what the call opcode would have owned
+	ValueVector* arg_values = expr->getArgsValue();
+
+	if (arg_values) {
+		for (size_t i = 0, j = arg_values->size(); i < j; ++i) {
+			CLEVER_DELREF(arg_values->at(i));
+		}
+		delete arg_values;
+		expr->setArgsValue(NULL);
+	}
+	expr->getValue()->delRef();
+
+	return true;
+}
+
+/**
+ * Bounds check elimination
+ */
+
+static bool _is_array_method(const CallableValue* call, const char* name) {
+	const Type* type = call->getTypePtr();
+
+	return call->isMethod() && type && type->isTemplatedType()
+		&& type->getName()->compare(0, 6, "Array<") == 0
+		&& call->getMethod()->getName() == name;
+}
+
+/**
+ * Array methods which neither resize the array nor run user code
+ */
+static bool _is_array_reader(const CallableValue* call) {
+	return _is_array_method(call, "size") || _is_array_method(call, "isEmpty")
+		|| _is_array_method(call, "find") || _is_array_method(call, "slice")
+		|| _is_array_method(call, "toString");
+}
+
+static bool _uses_value(const Opcode* opcode, const Value* value) {
+	const Operand* ops[] = { &opcode->getOp1(), &opcode->getOp2() };
+
+	for (size_t i = 0; i < 2; ++i) {
+		if (ops[i]->getType() == VALUE && ops[i]->getValue() == value) {
+			return true;
+		}
+		if (ops[i]->getType() == VECTOR && ops[i]->getVector()) {
+			const ValueVector* vec = ops[i]->getVector();
+
+			if (std::find(vec->begin(), vec->end(), value) != vec->end()) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Recognizes the loop
+ *
+ *   for (Int i = <non negative constant>; i < arr.size(); ++i) { ... }
+ *
+ * and, when its body can't change i nor the size of any Array, turns the
+ * arr.at(i) and arr.set(i, ...) calls into ARRAY_AT and ARRAY_SET, which
+ * access the element directly. Only internal functions taking primitive
+ * arguments may be called, as anything else could resize an alias of arr,
+ * and i can't be passed to any call but at() and set().
+ */
+void CodeGenVisitor::_optimize_array_loop(size_t decl_begin,
+	size_t cond_begin, size_t incr_begin) {
+	size_t body_begin = cond_begin + 3;
+
+	// Condition: MCALL arr.size(), LESS i, JMPZ
+	if (incr_begin < body_begin || m_opcodes.size() != incr_begin + 2
+		|| m_opcodes[cond_begin]->getType() != OP_MCALL
+		|| m_opcodes[cond_begin + 1]->getType() != OP_LESS
+		|| m_opcodes[cond_begin + 2]->getType() != OP_JMPZ) {
+		return;
+	}
+
+	const Opcode* size_op = m_opcodes[cond_begin];
+	const Opcode* less_op = m_opcodes[cond_begin + 1];
+	const CallableValue* size_call = size_op->getOp1Callable();
+	const Value* array = size_call->getContext();
+	const ValueVector* operands = less_op->getOp2Vector();
+
+	if (!_is_array_method(size_call, "size") || array == NULL
+		|| !array->hasName() || operands == NULL || operands->size() != 2
+		|| operands->at(1) != size_op->getResultValue()
+		|| m_opcodes[cond_begin + 2]->getOp1Value()
+			!= less_op->getResultValue()) {
+		return;
+	}
+
+	const Value* index = operands->at(0);
+
+	if (!index->hasName() || index->getTypePtr() != CLEVER_INT) {
+		return;
+	}
+
+	// The counter is declared by the loop with a non negative constant...
+	std::map<const Value*, Value*>::const_iterator init(m_inits.find(index));
+
+	if (init == m_inits.end() || init->second->getTypePtr() != CLEVER_INT
+		|| init->second->getInteger() < 0) {
+		return;
+	}
+
+	bool declared = false;
+
+	for (size_t i = decl_begin; i < cond_begin; ++i) {
+		if (m_opcodes[i]->getType() == OP_ASSIGN
+			&& m_opcodes[i]->getOp1Callable()->getContext() == index) {
+			declared = true;
+		}
+	}
+
+	// ... and is only incremented at the end of each iteration
+	const Opcode* incr = m_opcodes[incr_begin];
+
+	if (!declared || (incr->getType() != OP_PRE_INC
+		&& incr->getType() != OP_POS_INC)
+		|| incr->getOp1Callable()->getContext() != index) {
+		return;
+	}
+
+	std::vector<Opcode*> accesses;
+
+	for (size_t i = body_begin; i < incr_begin; ++i) {
+		Opcode* opcode = m_opcodes[i];
+
+		if (opcode->getType() == OP_YIELD
+			|| opcode->getResultValue() == index) {
+			return;
+		}
+
+		if (opcode->getType() == OP_INIT_VAR
+			|| opcode->getType() == OP_FOREACH_INIT
+			|| opcode->getType() == OP_FOREACH_NEXT) {
+			if (_uses_value(opcode, index)) {
+				return;
+			}
+			continue;
+		}
+
+		const Value* op1 = opcode->getOp1().getType() == ADDR
+			? NULL : opcode->getOp1Value();
+
+		if (op1 == NULL || !op1->isCallable()) {
+			continue;
+		}
+
+		const CallableValue* call = static_cast<const CallableValue*>(op1);
+		const ValueVector* args = opcode->getOp2Vector();
+
+		// Natives may write through their arguments, see setOutputArg()
+		if ((opcode->getType() == OP_FCALL || opcode->getType() == OP_MCALL)
+			&& _uses_value(opcode, index)
+			&& !_is_array_method(call, "at") && !_is_array_method(call, "set")) {
+			return;
+		}
+
+		if (opcode->getType() == OP_FCALL) {
+			if (call->isNearCall() || !call->getFunction()->isInternal()) {
+				return;
+			}
+			for (size_t j = 0, sz = args ? args->size() : 0; j < sz; ++j) {
+				if (!_is_primitive(args->at(j)->getTypePtr())) {
+					return;
+				}
+			}
+		} else if (!call->isMethod()) {
+			return;
+		} else if (_is_primitive(call->getTypePtr())) {
+			if (call->getContext() == index
+				&& (opcode->getType() == OP_ASSIGN
+					|| !call->getMethod()->isConst())) {
+				return;
+			}
+		} else if (_is_array_method(call, "at")
+			|| _is_array_method(call, "set")) {
+			if (call->getContext() == array && args->at(0) == index) {
+				accesses.push_back(opcode);
+			}
+		} else if (!_is_array_reader(call)) {
+			return;
+		}
+	}
+
+	for (size_t i = 0, j = accesses.size(); i < j; ++i) {
+		if (_is_array_method(accesses[i]->getOp1Callable(), "at")) {
+			accesses[i]->setHandler(OP_ARRAY_AT, &VM_H(array_at));
+		} else {
+			accesses[i]->setHandler(OP_ARRAY_SET, &VM_H(array_set));
+		}
+	}
+}
+
 }} // clever::ast
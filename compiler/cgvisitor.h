@@ -26,6 +26,8 @@
 #ifndef CLEVER_CGVISITOR_H
 #define CLEVER_CGVISITOR_H
 
+#include <map>
+#include <set>
 #include <stack>
 
 #include "vm/opcode.h"
@@ -84,6 +86,10 @@ private:
 	Opcode* emit(OpcodeType type, VM::opcode_handler handler, Value* op1,
 		ValueVector* op2);
 
+	// Output an opcode
+	Opcode* emit(OpcodeType type, VM::opcode_handler handler, long addr,
+		ValueVector* op2);
+
 	// Output an opcode
 	Opcode* emit(OpcodeType type, VM::opcode_handler handler, CallableValue* op1,
 		ValueVector* op2, Value* result);
@@ -96,6 +102,28 @@ private:
 	Opcode* emit(OpcodeType type, VM::opcode_handler handler, Value* op1,
 		Value* op2, Value* result);
 
+	// Emits the native Array/Map iteration opcodes
+	void _visit_native_foreach(ForEachExpr*);
+
+	// Checks if the expression is a String + String operation
+	bool _is_string_concat(const BinaryExpr*) const;
+
+	// Emits the operands of a String concatenation chain, releasing the
+	// data of the intermediate expressions that won't be emitted
+	void _flatten_concat(ASTNode*, ValueVector*, bool);
+
+	// Checks whether a pure function can be run at compile time
+	bool _is_foldable(const Function*, BlockNode*) const;
+
+	// Returns the compile time value of an argument or NULL
+	Value* _get_constant(ASTNode*) const;
+
+	// Replaces a call to a foldable function by its result
+	bool _fold_call(FunctionCall*);
+
+	// Removes the bounds checks of Array accesses in a counted loop
+	void _optimize_array_loop(size_t, size_t, size_t);
+
 	// Returns the opcode number
 	size_t getOpNum() const {
 		return m_opcodes.size() == 0 ? 0 : m_opcodes.size()-1;
@@ -105,6 +133,15 @@ private:
 	OpcodeList m_opcodes;
 	JmpStack m_brks;
 
+	// Const functions which can be run at compile time
+	std::set<const Function*> m_foldable;
+
+	// Values known at compile time, by the value holding them at runtime
+	std::map<const Value*, Value*> m_consts;
+
+	// Constant initializers of the non-const variables
+	std::map<const Value*, Value*> m_inits;
+
 	DISALLOW_COPY_AND_ASSIGN(CodeGenVisitor);
 };
 
@@ -147,8 +147,9 @@ extern jmp_buf fatal_error;
 
 /**
  * Performs an internal type method call
+ * The method name must be an interned CString* (e.g. from CACHE_PTR)
  */
-#define CLEVER_INTERNAL_MCALL(ctx, method, tv, vv, ret) (ctx)->getTypePtr()->getMethod(CSTRING((method)), tv)->call((vv), (ret), (ctx))
+#define CLEVER_INTERNAL_MCALL(ctx, method, tv, vv, ret) (ctx)->getTypePtr()->getMethod((method), tv)->call((vv), (ret), (ctx))
 
 /**
  * Returns a type/value (if it is in the g_scope)
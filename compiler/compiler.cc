@@ -136,6 +136,10 @@ void Compiler::loadNativeTypes() {
 	g_scope.pushType(CSTRING("ForwardIterator"), fwd_iterator);
 	g_scope.pushType(CSTRING("BidirectionalIterator"), bid_iterator);
 
+	// Generator<T> implements ForwardIterator, so it must come after it
+	Type* generator = new Generator;
+	g_scope.pushType(CSTRING("Generator"), generator);
+
 	// Initialize native data types
 	CLEVER_INT->init();
 	CLEVER_DOUBLE->init();
@@ -149,6 +153,7 @@ void Compiler::loadNativeTypes() {
 	function->init();
 	fwd_iterator->init();
 	bid_iterator->init();
+	generator->init();
 }
 
 /**
@@ -58,6 +58,14 @@ public:
 		: RefCounted(0), std::string(str), m_id(0),
 			m_interned(interned) {}
 
+	/**
+	 * Creates a non-interned string from the [pos, pos+len) range of str,
+	 * copying the characters straight from the source buffer
+	 */
+	CString(const std::string& str, size_t pos, size_t len)
+		: RefCounted(0), std::string(str, pos, len), m_id(0),
+			m_interned(false) {}
+
 	bool hasSameId(const CString* cstring) const {
 		return m_id == cstring->m_id;
 	}
@@ -157,12 +165,19 @@ public:
 		}
 	}
 
-	const CString* intern(const std::string& needle) {
+	/**
+	 * Returns the id the string has (or would have) when interned
+	 */
+	static IdType getId(const std::string& needle) {
 #ifdef CLEVER_MSVC
-		IdType id = std::tr1::hash<const std::string*>()(&needle);
+		return std::tr1::hash<const std::string*>()(&needle);
 #else
-		IdType id = std::tr1::hash<std::string>()(needle);
+		return std::tr1::hash<std::string>()(needle);
 #endif
+	}
+
+	const CString* intern(const std::string& needle) {
+		IdType id = getId(needle);
 		CStringTableBase::const_iterator it(m_map.find(id));
 
 		if (it == m_map.end()) {
@@ -196,5 +211,9 @@ inline const clever::CString* CSTRINGT(const std::string& str, bool interned = f
 	return new clever::CString(str, interned);
 }
 
+inline const clever::CString* CSTRINGT(const std::string& str, size_t pos, size_t len) {
+	return new clever::CString(str, pos, len);
+}
+
 #endif /* CLEVER_CSTRING_H */
 
@@ -35,6 +35,7 @@
 #include <tr1/unordered_map>
 #endif
 #include "types/type.h"
+#include "compiler/memocache.h"
 
 namespace clever {
 
@@ -79,50 +80,68 @@ public:
 
 	explicit Function(std::string name)
 		: m_name(name), m_kind(INTERNAL), m_num_args(0), m_min_args(0),
-			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED) {}
+			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL) {}
 
 	Function(std::string libname, std::string name, const Type* rtype,
 		FunctionPtr ptr)
 		: m_libname(libname), m_lfname(name), m_name(name),
 			m_kind(EXTERNAL), m_num_args(0), m_min_args(0),
-			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.ptr = ptr; }
 
 	Function(std::string libname, std::string lfname, std::string name,
 		const Type* rtype, FunctionPtr ptr)
 		: m_libname(libname), m_lfname(lfname), m_name(name),
 			m_kind(EXTERNAL), m_num_args(0), m_min_args(0),
-			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.ptr = ptr; }
 
 	Function(std::string name, FunctionPtr ptr)
 		: m_name(name), m_kind(INTERNAL), m_num_args(0), m_min_args(0),
-			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.ptr = ptr; }
 
 	Function(std::string name, FunctionPtr ptr, const Type* rtype)
 		: m_name(name), m_kind(INTERNAL), m_num_args(0), m_min_args(0),
-			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(rtype), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.ptr = ptr; }
 
 	Function(std::string name, FunctionPtr ptr, int numargs,
 		const Type* rtype)
 		: m_name(name), m_kind(INTERNAL), m_num_args(numargs),
 			m_min_args(0), m_rtype(rtype), m_scope(NULL), m_rconst(false),
-			m_state(IMPLEMENTED) 
+			m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL) 
 			{ m_info.ptr = ptr; }
 
 	Function(std::string& name, size_t offset)
 		: m_name(name), m_kind(USER), m_num_args(0), m_min_args(0),
-			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.offset = offset; }
 
 	Function(std::string& name, size_t offset, int numargs)
 		: m_name(name), m_kind(USER), m_num_args(numargs), m_min_args(0),
-			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED)
+			m_rtype(NULL), m_scope(NULL), m_rconst(false), m_state(IMPLEMENTED),
+			m_generator(false), m_pure(false), m_thread_safe(false),
+			m_output_arg(-1), m_memo(NULL)
 			{ m_info.offset = offset; }
 
-	virtual ~Function() {}
+	virtual ~Function() {
+		delete m_memo;
+	}
 
 	Function* addArg(std::string name, const Type* type,
 		bool constness = true) {
@@ -149,6 +168,21 @@ public:
 	Function* setMinNumArgs(int nargs) { m_min_args = nargs; return this; }
 	int getMinNumArgs() const { return m_min_args; }
 
+	/**
+	 * Internal functions which write their result into an argument, the
+	 * caller must pass a non-const variable there
+	 */
+	Function* setOutputArg(int arg) { m_output_arg = arg; return this; }
+	int getOutputArg() const { return m_output_arg; }
+
+	/**
+	 * Internal functions which only read their arguments and set a primitive
+	 * result: they never report errors, look up methods or touch interpreter
+	 * state, so they may run outside the main thread
+	 */
+	Function* setThreadSafe() { m_thread_safe = true; return this; }
+	bool isThreadSafe() const { return m_thread_safe; }
+
 	bool isUserDefined() const { return m_kind == USER; }
 	bool isInternal() const { return m_kind == INTERNAL; }
 	bool isExternal() const { return m_kind == EXTERNAL; }
@@ -170,6 +204,31 @@ public:
 	void setReturnConst(bool is_const) { m_rconst = is_const; }
 	bool hasReturnConst() const { return m_rconst; }
 
+	/**
+	 * Generator functions (the ones using yield) don't run their body on
+	 * call, they return a Generator<T> which resumes it on demand
+	 */
+	void setGenerator() { m_generator = true; }
+	bool isGenerator() const { return m_generator; }
+
+	/**
+	 * Pure functions (annotated with @@Pure) may be run at compile time
+	 * when all their arguments are constants
+	 */
+	void setPure() { m_pure = true; }
+	bool isPure() const { return m_pure; }
+
+	/**
+	 * Memoized functions (annotated with @@Memoize) have their results
+	 * cached by argument values, a zero capacity means unbounded
+	 */
+	void setMemoized(size_t capacity) {
+		delete m_memo;
+		m_memo = new MemoCache(capacity);
+	}
+	bool isMemoized() const { return m_memo != NULL; }
+	MemoCache* getMemo() const { return m_memo; }
+
 	FunctionPtr getPtr() const { return m_info.ptr; }
 
 	const std::string& getName() const { return m_name; }
@@ -199,6 +258,11 @@ private:
 	Scope* m_scope;
 	bool m_rconst;
 	FunctionState m_state;
+	bool m_generator;
+	bool m_pure;
+	bool m_thread_safe;
+	int m_output_arg;
+	MemoCache* m_memo;
 };
 
 } // clever
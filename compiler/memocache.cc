@@ -0,0 +1,121 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+#include "compiler/memocache.h"
+#include "compiler/value.h"
+
+namespace clever {
+
+template <typename T>
+static void _append(std::string& key, T data) {
+	char buf[sizeof(T)];
+
+	std::memcpy(buf, &data, sizeof(T));
+	key.append(buf, sizeof(T));
+}
+
+void MemoCache::buildKey(const ValueVector* args, std::string& key) {
+	key.clear();
+
+	if (args == NULL) {
+		return;
+	}
+
+	for (size_t i = 0, sz = args->size(); i < sz; ++i) {
+		const Value* arg = args->at(i);
+
+		if (arg->isInteger()) {
+			key += 'i';
+			_append(key, arg->getInteger());
+		} else if (arg->isDouble()) {
+			key += 'd';
+			_append(key, arg->getDouble());
+		} else if (arg->isBoolean()) {
+			key += arg->getBoolean() ? 'T' : 'F';
+		} else if (arg->isByte()) {
+			key += 'c';
+			key += static_cast<char>(arg->getByte());
+		} else if (arg->isString()) {
+			const std::string& str = arg->getString();
+
+			key += 's';
+			_append(key, str.size());
+			key += str;
+		}
+	}
+}
+
+const Value* MemoCache::find(const std::string& key) {
+	EntryMap::iterator it = m_index.find(key);
+
+	if (it == m_index.end()) {
+		return NULL;
+	}
+
+	// Moves the entry to the front, as the most recently used
+	if (it->second != m_entries.begin()) {
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+	}
+
+	return it->second->second;
+}
+
+void MemoCache::insert(const std::string& key, const Value* value) {
+	EntryMap::iterator it = m_index.find(key);
+
+	if (it != m_index.end()) {
+		it->second->second->copy(value);
+		return;
+	}
+
+	if (m_capacity && m_entries.size() >= m_capacity) {
+		Entry& last = m_entries.back();
+
+		m_index.erase(last.first);
+		last.second->delRef();
+		m_entries.pop_back();
+	}
+
+	Value* result = new Value;
+	result->copy(value);
+
+	m_entries.push_front(Entry(key, result));
+	m_index.insert(EntryMap::value_type(key, m_entries.begin()));
+}
+
+void MemoCache::clear() {
+	EntryList::iterator it = m_entries.begin(), end = m_entries.end();
+
+	while (it != end) {
+		it->second->delRef();
+		++it;
+	}
+
+	m_entries.clear();
+	m_index.clear();
+}
+
+} // clever
@@ -0,0 +1,94 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_MEMOCACHE_H
+#define CLEVER_MEMOCACHE_H
+
+#include <list>
+#include <string>
+#include <vector>
+#ifdef CLEVER_MSVC
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+#include "compiler/clever.h"
+
+namespace clever {
+
+class Value;
+
+typedef std::vector<Value*> ValueVector;
+
+/**
+ * Results cache of a memoized function (declared with @@Memoize), keyed on
+ * its primitive argument values. When a capacity is given the least
+ * recently used entry is evicted once the cache is full.
+ */
+class MemoCache {
+public:
+	explicit MemoCache(size_t capacity)
+		: m_capacity(capacity) {}
+
+	~MemoCache() { clear(); }
+
+	/**
+	 * Builds the lookup key for the argument values
+	 */
+	static void buildKey(const ValueVector* args, std::string& key);
+
+	/**
+	 * Returns the cached result for key, or NULL when there is none
+	 */
+	const Value* find(const std::string& key);
+
+	/**
+	 * Stores a copy of the result for key
+	 */
+	void insert(const std::string& key, const Value* value);
+
+	void clear();
+
+	size_t size() const { return m_entries.size(); }
+
+	size_t getCapacity() const { return m_capacity; }
+private:
+	typedef std::pair<std::string, Value*> Entry;
+	typedef std::list<Entry> EntryList;
+	typedef std::tr1::unordered_map<std::string, EntryList::iterator> EntryMap;
+
+	// Entries from the most to the least recently used
+	EntryList m_entries;
+	EntryMap m_index;
+
+	// Max number of entries, 0 means unbounded
+	size_t m_capacity;
+
+	DISALLOW_COPY_AND_ASSIGN(MemoCache);
+};
+
+} // clever
+
+#endif // CLEVER_MEMOCACHE_H
@@ -69,8 +69,8 @@ public:
 	Method(std::string name, MethodPtr ptr, const Type* rtype,
 		bool constness = true)
 		: RefCounted(1), m_name(name), m_type(INTERNAL), m_rtype(rtype),
-			m_num_args(0), m_min_args(0), m_is_const(constness),
-			m_is_static(false) {
+			m_num_args(0), m_min_args(0), m_output_arg(-1),
+			m_is_const(constness), m_is_static(false), m_infallible(false) {
 		m_info.ptr = ptr;
 	}
 
@@ -110,10 +110,24 @@ public:
 	Method* setMinNumArgs(int nargs) { m_min_args = nargs; return this; }
 	int getMinNumArgs() const { return m_min_args; }
 
+	/**
+	 * Methods which write their result into an argument, the caller must
+	 * pass a non-const variable there
+	 */
+	Method* setOutputArg(int arg) { m_output_arg = arg; return this; }
+	int getOutputArg() const { return m_output_arg; }
+
 	bool isConst() const { return m_is_const; }
 
 	Method* setStatic() { m_is_static = true; return this; }
 	bool isStatic() const { return m_is_static; }
+
+	/**
+	 * Internal methods which never report errors nor warnings, calls to
+	 * them may be run by the compiler when folding a pure function
+	 */
+	Method* setInfallible() { m_infallible = true; return this; }
+	bool isInfallible() const { return m_infallible; }
 private:
 	union {
 		MethodPtr ptr;
@@ -136,7 +150,8 @@ private:
 
 	int m_num_args;
 	int m_min_args;
-	bool m_is_const, m_is_static;
+	int m_output_arg;
+	bool m_is_const, m_is_static, m_infallible;
 
 	DISALLOW_COPY_AND_ASSIGN(Method);
 };
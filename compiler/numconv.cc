@@ -0,0 +1,150 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include "compiler/numconv.h"
+
+namespace clever {
+
+/**
+ * Pairs of decimal digits for the numbers from 00 to 99
+ */
+static const char s_digit_pairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static inline bool _is_space(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Writes the decimal representation of the number, two digits at a time
+ */
+size_t format_int(int64_t value, char* buf) {
+	char tmp[CLEVER_NUM_BUFSIZE];
+	char* const end = tmp + sizeof(tmp);
+	char* p = end;
+	uint64_t num = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+
+	while (num >= 100) {
+		const char* pair = s_digit_pairs + (num % 100) * 2;
+
+		num /= 100;
+		*--p = pair[1];
+		*--p = pair[0];
+	}
+
+	if (num >= 10) {
+		const char* pair = s_digit_pairs + num * 2;
+
+		*--p = pair[1];
+		*--p = pair[0];
+	} else {
+		*--p = char('0' + num);
+	}
+
+	if (value < 0) {
+		*--p = '-';
+	}
+
+	size_t len = end - p;
+
+	::memcpy(buf, p, len);
+	buf[len] = '\0';
+
+	return len;
+}
+
+/**
+ * Writes the number using the same notation the default ostream
+ * formatting uses (%g, 6 significant digits)
+ */
+size_t format_double(double value, char* buf) {
+	return ::sprintf(buf, "%g", value);
+}
+
+/**
+ * Parses a signed decimal integer
+ */
+const char* parse_int(const char* str, int64_t& value) {
+	while (_is_space(*str)) {
+		++str;
+	}
+
+	bool negative = *str == '-';
+
+	if (*str == '-' || *str == '+') {
+		++str;
+	}
+
+	const uint64_t max = ~uint64_t(0) >> 1;
+	const uint64_t limit = negative ? max + 1 : max;
+	const char* start = str;
+	uint64_t num = 0;
+
+	for (; *str >= '0' && *str <= '9'; ++str) {
+		unsigned digit = *str - '0';
+
+		if (num > (limit - digit) / 10) {
+			return NULL;
+		}
+		num = num * 10 + digit;
+	}
+
+	if (str == start) {
+		return NULL;
+	}
+
+	value = negative ? int64_t(0 - num) : int64_t(num);
+
+	return str;
+}
+
+/**
+ * Parses a floating point number
+ */
+const char* parse_double(const char* str, double& value) {
+	char* end;
+	double num;
+
+	errno = 0;
+	num = ::strtod(str, &end);
+
+	if (end == str || errno == ERANGE) {
+		return NULL;
+	}
+
+	value = num;
+
+	return end;
+}
+
+} // clever
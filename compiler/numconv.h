@@ -0,0 +1,60 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_NUMCONV_H
+#define CLEVER_NUMCONV_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace clever {
+
+/**
+ * Buffer size large enough for any number written by the format functions
+ * (including the trailing NUL)
+ */
+#define CLEVER_NUM_BUFSIZE 32
+
+/**
+ * Number formatting
+ * Both functions write a NUL-terminated string into buf, which must have
+ * at least CLEVER_NUM_BUFSIZE bytes, and return its length
+ */
+size_t format_int(int64_t value, char* buf);
+size_t format_double(double value, char* buf);
+
+/**
+ * Number parsing
+ * Leading whitespaces are skipped and the parsing stops at the first
+ * character that doesn't belong to the number. Returns a pointer to that
+ * character, or NULL when no number could be read (or it is out of range),
+ * in which case value is left untouched.
+ */
+const char* parse_int(const char* str, int64_t& value);
+const char* parse_double(const char* str, double& value);
+
+} // clever
+
+#endif // CLEVER_NUMCONV_H
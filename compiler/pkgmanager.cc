@@ -142,14 +142,18 @@ static void _load_module_classes(const CString* alias, Scope* scope,
 	const std::string prefix = alias ? alias->str() + "::" : "";
 
 	/**
-	 * Inserts all classes into the symbol table
+	 * Inserts all classes into the symbol table, before initializing
+	 * them, as a class may refer to the others of its module
 	 */
 	while (itc != endc) {
 		g_scope.pushType(CSTRING(prefix + *itc->first), itc->second);
 		itc->second->addRef();
-		itc->second->init();
 		++itc;
 	}
+
+	for (itc = classes.begin(); itc != endc; ++itc) {
+		itc->second->init();
+	}
 }
 
 /**
@@ -23,6 +23,7 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <set>
 #include "compiler/compiler.h"
 #include "compiler/typechecker.h"
 #include "compiler/cached_ptrs.h"
@@ -250,6 +251,24 @@ static void _check_function_arg_types(const Function* func,
 	}
 }
 
+/**
+ * Checks that the argument receiving the result of a native is a variable
+ * which may be written
+ */
+static void _check_output_arg(int arg, const std::string& name,
+	const ValueVector* arg_values, const location& loc) {
+	if (arg < 0 || arg_values == NULL || size_t(arg) >= arg_values->size()) {
+		return;
+	}
+
+	const Value* val = arg_values->at(arg);
+
+	if (!val->hasName() || val->isConst()) {
+		Compiler::errorf(loc, "Argument #%i of `%s' receives its result, "
+			"a non-const variable is expected", arg + 1, name.c_str());
+	}
+}
+
 /**
  * Prepares the node to generate an opcode which will make a method call
  */
@@ -318,6 +337,9 @@ static CallableValue* _prepare_method_call(const Type* type, Value* var,
 		var->addRef();
 	}
 
+	_check_output_arg(method->getOutputArg(), method->getName(), vv,
+		expr->getLocation());
+
 	CallableValue* call = new CallableValue(mname, type);
 	call->setHandler(method);
 	call->setContext(var);
@@ -776,6 +798,76 @@ AST_VISITOR(TypeChecker, IfExpr) {
 	}
 }
 
+/**
+ * Switch statement visitor
+ */
+AST_VISITOR(TypeChecker, SwitchExpr) {
+	expr->getExpr()->acceptVisitor(*this);
+
+	const Type* type = expr->getExpr()->getValue()->getTypePtr();
+
+	if (UNEXPECTED(type != CLEVER_INT && type != CLEVER_BYTE
+		&& type != CLEVER_STR)) {
+		Compiler::errorf(expr->getLocation(), "Cannot switch on a value of "
+			"type %S, only Int, Byte and String are supported",
+			type ? type->getName() : CSTRING("Void"));
+	}
+
+	const NodeList& cases = expr->getNodes();
+	std::set<int64_t> int_labels;
+	std::set<const CString*> str_labels;
+	bool has_default = false, all_return = true;
+
+	for (size_t i = 0, j = cases.size(); i < j; ++i) {
+		CaseNode* node = static_cast<CaseNode*>(cases[i]);
+		const Value* label = node->getLabelValue();
+
+		if (node->isDefault()) {
+			if (UNEXPECTED(has_default)) {
+				Compiler::error("Multiple default labels in one switch",
+					expr->getLocation());
+			}
+			has_default = true;
+		} else if (type == CLEVER_STR) {
+			if (UNEXPECTED(!label->isString())) {
+				Compiler::errorf(expr->getLocation(),
+					"Case label must be a String literal");
+			}
+			if (UNEXPECTED(!str_labels.insert(label->getStringP()).second)) {
+				Compiler::errorf(expr->getLocation(),
+					"Duplicate case label \"%S\"", label->getStringP());
+			}
+		} else {
+			if (UNEXPECTED(!label->isInteger())) {
+				Compiler::errorf(expr->getLocation(),
+					"Case label must be an Int literal");
+			}
+			if (UNEXPECTED(type == CLEVER_BYTE
+				&& (label->getInteger() < 0 || label->getInteger() > 255))) {
+				Compiler::errorf(expr->getLocation(),
+					"Case label %l is out of the Byte range", label->getInteger());
+			}
+			if (UNEXPECTED(!int_labels.insert(label->getInteger()).second)) {
+				Compiler::errorf(expr->getLocation(),
+					"Duplicate case label %l", label->getInteger());
+			}
+		}
+
+		node->getBlock()->acceptVisitor(*this);
+
+		// Empty cases fall through to the next one
+		if (!node->getBlock()->hasReturn()
+			&& (node->getBlock()->hasNodes() || i == j - 1)) {
+			all_return = false;
+		}
+	}
+
+	// Every path returns when all the cases do and a default exists
+	if (has_default && all_return) {
+		expr->setReturn();
+	}
+}
+
 /**
  * Block visitor
  */
@@ -902,6 +994,128 @@ AST_VISITOR(TypeChecker, ForExpr) {
 	m_scope = m_scope->getParent();
 }
 
+/**
+ * Checks if the type is an instance of the template named by prefix
+ * (e.g. "Array<")
+ */
+static bool _is_template_instance(const Type* type, const char* prefix) {
+	return type->isTemplatedType()
+		&& type->getName()->compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+/**
+ * Types which values can be used as a memoization key
+ */
+static bool _is_memo_type(const Type* type) {
+	return type == CLEVER_INT || type == CLEVER_DOUBLE || type == CLEVER_BOOL
+		|| type == CLEVER_BYTE || type == CLEVER_STR;
+}
+
+/**
+ * Applies the @@Pure and @@Memoize annotations, the optional argument of
+ * @@Memoize bounds the number of cached results
+ */
+static void _apply_annotations(FuncDeclaration* expr, Function* func) {
+	if (expr->getAnnotations()->find(CSTRING("Pure"))) {
+		func->setPure();
+	}
+
+	Annotation* memo = expr->getAnnotations()->find(CSTRING("Memoize"));
+
+	if (memo == NULL) {
+		return;
+	}
+
+	if (func->isGenerator() || !_is_memo_type(func->getReturnType())) {
+		Compiler::errorf(expr->getLocation(), "Memoized function `%S' "
+			"must return a primitive value", expr->getName());
+	}
+
+	const FunctionArgs& args = func->getArgs();
+
+	for (size_t i = 0, sz = args.size(); i < sz; ++i) {
+		if (!_is_memo_type(args[i].type)) {
+			Compiler::errorf(expr->getLocation(), "Memoized function `%S' "
+				"can only take primitive arguments", expr->getName());
+		}
+	}
+
+	int64_t capacity = 0;
+
+	if (memo->getArg()) {
+		capacity = memo->getArg()->getValue()->getInteger();
+
+		if (capacity <= 0) {
+			Compiler::errorf(expr->getLocation(), "Memoized function `%S' "
+				"must have a positive cache capacity", expr->getName());
+		}
+	}
+
+	func->setMemoized(static_cast<size_t>(capacity));
+}
+
+/**
+ * Creates a loop variable in the current scope
+ */
+static Value* _new_foreach_var(Scope* scope, Identifier* ident,
+	const Type* type) {
+	Value* var = new Value(type);
+
+	var->setName(ident->getName());
+	ident->setValue(var);
+	var->addRef();
+
+	scope->pushValue(var->getName(), var);
+
+	return var;
+}
+
+/**
+ * Prepares the native Array and Map iteration, which avoids the iterator
+ * object and its method calls:
+ *
+ *   for (array in elem) / for (array in index, elem)
+ *   for (map in key)    / for (map in key, value)
+ */
+static void _prepare_native_foreach(Scope* scope, ForEachExpr* expr,
+	const Type* type) {
+	Identifier* first = expr->getIdentifier();
+	Identifier* second = expr->getValueIdentifier();
+	const TemplatedType* tpl = static_cast<const TemplatedType*>(type);
+
+	if (_is_template_instance(type, "Array<")) {
+		if (second) {
+			expr->setKeyValue(_new_foreach_var(scope, first, CLEVER_INT));
+			expr->setElemValue(_new_foreach_var(scope, second,
+				tpl->getTypeArg(0)));
+		} else {
+			expr->setElemValue(_new_foreach_var(scope, first,
+				tpl->getTypeArg(0)));
+		}
+
+		expr->setCursor(new Value(int64_t(0)));
+	} else {
+		if (second) {
+			expr->setKeyValue(_new_foreach_var(scope, first,
+				tpl->getTypeArg(0)));
+			expr->setElemValue(_new_foreach_var(scope, second,
+				tpl->getTypeArg(1)));
+		} else {
+			expr->setElemValue(_new_foreach_var(scope, first,
+				tpl->getTypeArg(0)));
+		}
+
+		expr->setCursor(new Value(
+			static_cast<const TemplatedType*>(CLEVER_TYPE("MapIterator"))
+				->getTemplatedType(tpl->getTypeArg(0), tpl->getTypeArg(1))));
+	}
+
+	// Keeps the cursor along with the loop variables, so it is saved with
+	// the function frame on recursion and generator suspension
+	scope->pushValue(CSTRING(".cursor"), expr->getCursor());
+	expr->getCursor()->addRef();
+}
+
 /**
  * ForEach visitor
  */
@@ -915,6 +1129,25 @@ AST_VISITOR(TypeChecker, ForEachExpr) {
 
 	clever_assert_not_null(instancetype);
 
+	// Array and Map are iterated natively by the VM
+	if (_is_template_instance(instancetype, "Array<")
+		|| _is_template_instance(instancetype, "Map<")) {
+		m_scope = m_scope->newChild();
+
+		_prepare_native_foreach(m_scope, expr, instancetype);
+
+		expr->getBlock()->acceptVisitor(*this);
+
+		m_scope = m_scope->getParent();
+		return;
+	}
+
+	if (expr->hasValueIdentifier()) {
+		Compiler::errorf(expr->getLocation(),
+			"Type `%S' doesn't support key/value iteration",
+			instancetype->getName());
+	}
+
 	/* TODO: Change to Iterable */
 	if (!instancetype->implementsInterface(CLEVER_TYPE("Iterator"))) {
 		Compiler::error("Variable type doesn't implements Iterator interface");
@@ -1092,6 +1325,8 @@ AST_VISITOR(TypeChecker, FunctionCall) {
 		ValueVector* arg_values = expr->getArgs()->getArgValue();
 
 		_check_function_arg_types(func, arg_values,	expr->getLocation());
+		_check_output_arg(func->getOutputArg(), func->getName(), arg_values,
+			expr->getLocation());
 
 		expr->setArgsValue(arg_values);
 	}
@@ -1294,11 +1529,17 @@ AST_VISITOR(TypeChecker, FuncDeclaration) {
 	expr->setValue(func);
 	user_func->setImplemented();
 
-	if (args) {
-		ArgumentDecls& arg_nodes = args->getArgs();
-		ArgumentDecls::iterator it = arg_nodes.begin(),
-			end = arg_nodes.end();
+	/**
+	 * Functions returning Generator<T> are generators, their variables
+	 * must live in the function scope to be saved between resumes
+	 */
+	bool is_generator = rtype && _is_template_instance(rtype, "Generator<");
 
+	if (is_generator) {
+		user_func->setGenerator();
+	}
+
+	if (args || is_generator) {
 		if (func->isMethod()) {
 			// TODO: assert whether the child's class is an orphaned scope
 			m_scope = m_scope->newChild();
@@ -1307,6 +1548,12 @@ AST_VISITOR(TypeChecker, FuncDeclaration) {
 		}
 
 		user_func->setScope(m_scope);
+	}
+
+	if (args) {
+		ArgumentDecls& arg_nodes = args->getArgs();
+		ArgumentDecls::iterator it = arg_nodes.begin(),
+			end = arg_nodes.end();
 
 		while (EXPECTED(it != end)) {
 			Value* var = new Value;
@@ -1330,11 +1577,16 @@ AST_VISITOR(TypeChecker, FuncDeclaration) {
 		}
 	}
 
+	if (expr->getAnnotations()) {
+		_apply_annotations(expr, user_func);
+	}
+
 	m_funcs.push(user_func);
 
 	expr->getBlock()->acceptVisitor(*this);
 
-	if (user_func->getReturnType() && expr->getBlock()->hasReturn() == false) {
+	if (user_func->getReturnType() && !is_generator
+		&& expr->getBlock()->hasReturn() == false) {
 		Compiler::errorf(expr->getLocation(), "Function `%S' must return "
 			"a value of type `%S', and it may not return",
 			name, user_func->getReturnType()->getName());
@@ -1342,7 +1594,7 @@ AST_VISITOR(TypeChecker, FuncDeclaration) {
 
 	m_funcs.pop();
 
-	if (args) {
+	if (args || is_generator) {
 		m_scope = m_scope->getParent();
 	}
 }
@@ -1417,9 +1669,40 @@ AST_VISITOR(TypeChecker, ReturnStmt) {
 
 	const Function* func = m_funcs.top();
 
+	// A generator just finishes on return
+	if (func->isGenerator()) {
+		if (expr->getExprValue()) {
+			Compiler::errorf(expr->getLocation(), "Generator `%s' cannot "
+				"return a value, use yield instead", func->getName().c_str());
+		}
+		return;
+	}
+
 	_check_function_return(func, expr->getExprValue(), expr->getLocation());
 }
 
+/**
+ * Yield statement visitor
+ */
+AST_VISITOR(TypeChecker, YieldStmt) {
+	if (UNEXPECTED(m_funcs.empty() || !m_funcs.top()->isGenerator())) {
+		Compiler::error("Cannot use yield outside a function returning "
+			"a Generator", expr->getLocation());
+	}
+
+	const Function* func = m_funcs.top();
+	const Type* vtype = static_cast<const TemplatedType*>(
+		func->getReturnType())->getTypeArg(0);
+	const Value* value = expr->getExprValue();
+
+	if (UNEXPECTED(value->getTypePtr() != vtype)) {
+		Compiler::errorf(expr->getLocation(),
+			"Generator `%s' yields %S values, not %S values",
+			func->getName().c_str(), vtype->getName(),
+			value->getTypePtr()->getName());
+	}
+}
+
 /**
  * Type creation visitor
  */
@@ -23,8 +23,8 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <sstream>
 #include "compiler/value.h"
+#include "compiler/numconv.h"
 #include "types/type.h"
 
 namespace clever {
@@ -137,26 +137,39 @@ void Value::deepCopy(const Value* const value) {
  */
 const std::string Value::toString() {
 	if (isPrimitive()) {
-		std::ostringstream str;
+		char buf[CLEVER_NUM_BUFSIZE];
 
 		if (isInteger()) {
-			str << getInteger();
+			return std::string(buf, format_int(getInteger(), buf));
 		} else if (isDouble()) {
-			str << getDouble();
+			return std::string(buf, format_double(getDouble(), buf));
 		} else if (isBoolean()) {
 			return *CSTRING(getBoolean() ? "true" : "false");
 		} else if (isString()) {
 			return getString();
 		} else if (isByte()) {
-			str << "0x" << std::hex << uint32_t(getByte());
+			static const char hex[] = "0123456789abcdef";
+			uint8_t byte = getByte();
+			size_t len = 0;
+
+			buf[len++] = '0';
+			buf[len++] = 'x';
+
+			if (byte >= 16) {
+				buf[len++] = hex[byte >> 4];
+			}
+			buf[len++] = hex[byte & 0xf];
+
+			return std::string(buf, len);
 		}
 
-		return str.str();
+		return std::string();
 	} else if (getTypePtr() == CLEVER_VOID) {
 		return *CACHE_PTR(CLEVER_VOID_STR, "Void");
 	} else {
 		Value ret;
-		CLEVER_INTERNAL_MCALL(this, "toString", NULL, NULL, &ret);
+		CLEVER_INTERNAL_MCALL(this, CACHE_PTR(CLEVER_TO_STRING, "toString"),
+			NULL, NULL, &ret);
 
 		return ret.getString().str();
 	}
@@ -78,8 +78,12 @@ else (LIBPTHREAD_DIR)
 	endif (LIBPTHREAD_LIBRARIES AND LIBPTHREAD_INCLUDE_DIRS)
 endif (LIBPTHREAD_DIR)
 
+# The core interpreter uses threads (see types/workpool.cc)
 if (LIBPTHREAD_FOUND)
-	add_definitions(-DHAVE_LIBPTHREAD)
+	add_definitions(-pthread -DHAVE_LIBPTHREAD)
+	set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -pthread")
+	list(APPEND CLEVER_INCLUDE_DIRS ${LIBPTHREAD_INCLUDE_DIRS})
+	list(APPEND CLEVER_LIBRARIES ${LIBPTHREAD_LIBRARIES})
 endif (LIBPTHREAD_FOUND)
 
 # libffi
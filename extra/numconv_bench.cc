@@ -0,0 +1,136 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <ctime>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "compiler/numconv.h"
+
+/**
+ * Number conversion benchmark
+ * Compares the stream based conversions used before with the dedicated
+ * formatting and parsing functions from compiler/numconv.h
+ */
+
+#define ITERATIONS 2000000
+
+static double elapsed(clock_t start) {
+	return double(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+static void report(const char* name, double old_ms, double new_ms) {
+	::printf("%-16s stream: %8.1f ms  numconv: %8.1f ms  (%.1fx)\n",
+		name, old_ms, new_ms, new_ms > 0 ? old_ms / new_ms : 0.0);
+}
+
+int main(void) {
+	char buf[CLEVER_NUM_BUFSIZE];
+	size_t sink = 0;
+	clock_t start;
+	double old_ms, new_ms;
+
+	// Int -> String
+	start = clock();
+	for (int64_t i = -ITERATIONS/2; i < ITERATIONS/2; ++i) {
+		std::ostringstream str;
+		str << i * 7919;
+		sink += str.str().size();
+	}
+	old_ms = elapsed(start);
+
+	start = clock();
+	for (int64_t i = -ITERATIONS/2; i < ITERATIONS/2; ++i) {
+		sink += std::string(buf, clever::format_int(i * 7919, buf)).size();
+	}
+	new_ms = elapsed(start);
+	report("format Int", old_ms, new_ms);
+
+	// Double -> String
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		std::ostringstream str;
+		str << i / 7.0;
+		sink += str.str().size();
+	}
+	old_ms = elapsed(start);
+
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		sink += std::string(buf, clever::format_double(i / 7.0, buf)).size();
+	}
+	new_ms = elapsed(start);
+	report("format Double", old_ms, new_ms);
+
+	// String -> Int
+	std::string ints[16];
+	for (int i = 0; i < 16; ++i) {
+		ints[i] = std::string(buf, clever::format_int(int64_t(i) * 1234567891 - 9999, buf));
+	}
+
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		int64_t num = 0;
+		std::stringstream stream(ints[i & 15]);
+		stream >> num;
+		sink += size_t(num);
+	}
+	old_ms = elapsed(start);
+
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		int64_t num = 0;
+		clever::parse_int(ints[i & 15].c_str(), num);
+		sink += size_t(num);
+	}
+	new_ms = elapsed(start);
+	report("parse Int", old_ms, new_ms);
+
+	// String -> Double
+	std::string doubles[16];
+	for (int i = 0; i < 16; ++i) {
+		doubles[i] = std::string(buf, clever::format_double(i * 3.14159 - 7, buf));
+	}
+
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		double num = 0;
+		std::stringstream stream(doubles[i & 15]);
+		stream >> num;
+		sink += size_t(num);
+	}
+	old_ms = elapsed(start);
+
+	start = clock();
+	for (int i = 0; i < ITERATIONS; ++i) {
+		double num = 0;
+		clever::parse_double(doubles[i & 15].c_str(), num);
+		sink += size_t(num);
+	}
+	new_ms = elapsed(start);
+	report("parse Double", old_ms, new_ms);
+
+	return sink == 0;
+}
@@ -0,0 +1,263 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * RPC loopback benchmark
+ * Starts a server running extra/rpc_bench/server.clv and a number of
+ * clients running extra/rpc_bench/client.clv against it, all at once.
+ * Reports the calls per second of the clients together and the latency
+ * percentiles each client measured with RPCClass::stats().
+ *
+ * Usage: rpc-bench <clever> <bench dir> <library> [clients [calls [port]]]
+ */
+
+#define DEFAULT_CLIENTS 4
+#define DEFAULT_CALLS   20000
+#define DEFAULT_PORT    7790
+
+// Kill command of the RPC protocol, see modules/std/rpc/rpcvalue.h
+#define RPC_KILL 0x6
+
+struct ClientResult {
+	ClientResult()
+		: calls(0), p50(0), p99(0) {}
+
+	long calls;
+	double p50;
+	double p99;
+};
+
+static double elapsed(const struct timeval& start) {
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+
+	return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+/**
+ * Runs the program with its stdout and stderr sent to the given
+ * descriptors, -1 discards the output
+ */
+static pid_t spawn(const std::vector<std::string>& args, int out, int err) {
+	pid_t pid = fork();
+
+	if (pid != 0) {
+		return pid;
+	}
+
+	int null = open("/dev/null", O_WRONLY);
+
+	dup2(out < 0 ? null : out, 1);
+	dup2(err < 0 ? null : err, 2);
+
+	std::vector<char*> argv;
+
+	for (size_t i = 0; i < args.size(); ++i) {
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	}
+	argv.push_back(NULL);
+
+	execv(argv[0], &argv[0]);
+	_exit(127);
+}
+
+static int connect_port(int port) {
+	struct sockaddr_in sa;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static bool wait_server(int port) {
+	for (int i = 0; i < 100; ++i) {
+		int fd = connect_port(port);
+
+		if (fd >= 0) {
+			close(fd);
+			return true;
+		}
+		usleep(50000);
+	}
+
+	return false;
+}
+
+static std::string read_all(int fd) {
+	std::string data;
+	char buf[4096];
+	ssize_t n;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		data.append(buf, n);
+	}
+	close(fd);
+
+	return data;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s <clever> <bench dir> <library> "
+			"[clients [calls [port]]]\n", argv[0]);
+		return 1;
+	}
+
+	std::string clever(argv[1]), dir(argv[2]), library(argv[3]);
+	int clients = argc > 4 ? atoi(argv[4]) : DEFAULT_CLIENTS;
+	long calls = argc > 5 ? atol(argv[5]) : DEFAULT_CALLS;
+	int port = argc > 6 ? atoi(argv[6]) : DEFAULT_PORT;
+	char port_str[16], calls_str[32];
+
+	snprintf(port_str, sizeof(port_str), "%d", port);
+	snprintf(calls_str, sizeof(calls_str), "%ld", calls);
+
+	// The server's stderr carries its stats, dumped at shutdown
+	int server_err[2];
+
+	pipe(server_err);
+
+	std::vector<std::string> args;
+
+	args.push_back(clever);
+	args.push_back(dir + "/server.clv");
+	args.push_back(library);
+	args.push_back(port_str);
+
+	pid_t server = spawn(args, -1, server_err[1]);
+
+	close(server_err[1]);
+
+	if (!wait_server(port)) {
+		fprintf(stderr, "rpc-bench: the server did not start on port %d\n", port);
+		kill(server, SIGTERM);
+		return 1;
+	}
+
+	args.clear();
+	args.push_back(clever);
+	args.push_back(dir + "/client.clv");
+	args.push_back(port_str);
+	args.push_back(calls_str);
+
+	std::vector<pid_t> pids;
+	std::vector<int> outputs;
+	struct timeval start;
+
+	gettimeofday(&start, NULL);
+
+	for (int i = 0; i < clients; ++i) {
+		int out[2];
+
+		pipe(out);
+		pids.push_back(spawn(args, out[1], -1));
+		close(out[1]);
+		outputs.push_back(out[0]);
+	}
+
+	std::vector<ClientResult> results(clients);
+	std::vector<double> p50s;
+	double p99 = 0;
+	long total = 0;
+	bool failed = false;
+
+	for (int i = 0; i < clients; ++i) {
+		std::string line = read_all(outputs[i]);
+		ClientResult& r = results[i];
+
+		waitpid(pids[i], NULL, 0);
+
+		if (sscanf(line.c_str(), "%ld %lf %lf", &r.calls, &r.p50, &r.p99) != 3) {
+			fprintf(stderr, "rpc-bench: client %d failed\n", i);
+			failed = true;
+			continue;
+		}
+
+		total += r.calls;
+		p50s.push_back(r.p50);
+		p99 = std::max(p99, r.p99);
+	}
+
+	double seconds = elapsed(start);
+
+	int fd = connect_port(port);
+	int kill_cmd = RPC_KILL;
+
+	if (fd >= 0) {
+		write(fd, &kill_cmd, sizeof(kill_cmd));
+		close(fd);
+	}
+
+	std::string server_log = read_all(server_err[0]);
+
+	waitpid(server, NULL, 0);
+
+	printf("clients: %d  calls: %ld  time: %.3f s  calls/sec: %.0f\n",
+		clients, total, seconds, seconds > 0 ? total / seconds : 0.0);
+
+	if (!p50s.empty()) {
+		std::sort(p50s.begin(), p50s.end());
+
+		printf("latency p50: %.1f us (median of the clients)  "
+			"p99: %.1f us (worst client)\n", p50s[p50s.size() / 2], p99);
+	}
+
+	for (int i = 0; i < clients; ++i) {
+		printf("  client %d: calls=%ld p50=%.1f us p99=%.1f us\n",
+			i, results[i].calls, results[i].p50, results[i].p99);
+	}
+
+	size_t stats = server_log.find("RPC server stats:");
+
+	if (stats != std::string::npos) {
+		printf("%s", server_log.substr(stats).c_str());
+	}
+
+	return failed;
+}
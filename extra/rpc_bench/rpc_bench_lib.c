@@ -0,0 +1,6 @@
+/**
+ * Function served by the RPC benchmark server
+ */
+int add(int a, int b) {
+	return a + b;
+}
@@ -103,6 +103,7 @@ enum {
 
 class NumberLiteral;
 class StringLiteral;
+class BinaryExpr;
 
 /**
  * AST node representation
@@ -181,7 +182,9 @@ public:
 	virtual void acceptVisitor(ASTVisitor& visitor) { }
 	virtual ASTNode* acceptTransformer(ASTTransformer& transformer) { return this; }
 
+	virtual bool isLiteral() const { return false; }
 	virtual NumberLiteral* asNumberLiteral() { return NULL; }
+	virtual BinaryExpr* asBinaryExpr() { return NULL; }
 	virtual bool hasBlock() const { return false; }
 	virtual bool hasReturn() const { return false; }
 
@@ -542,6 +545,60 @@ private:
 	DISALLOW_COPY_AND_ASSIGN(WhileExpr);
 };
 
+class CaseNode : public ASTNode {
+public:
+	CaseNode(ASTNode* label, ASTNode* block)
+		: m_label(label), m_block(block) {
+		CLEVER_SAFE_ADDREF(m_label);
+		CLEVER_ADDREF(m_block);
+	}
+
+	~CaseNode() {
+		CLEVER_SAFE_DELREF(m_label);
+		CLEVER_DELREF(m_block);
+	}
+
+	bool isDefault() const { return m_label == NULL; }
+
+	Value* getLabelValue() const { return m_label ? m_label->getValue() : NULL; }
+
+	ASTNode* getBlock() { return m_block; }
+private:
+	ASTNode* m_label;
+	ASTNode* m_block;
+
+	DISALLOW_COPY_AND_ASSIGN(CaseNode);
+};
+
+class SwitchExpr : public ASTNode {
+public:
+	explicit SwitchExpr(ASTNode* expr)
+		: m_expr(expr), m_has_return(false) {
+		CLEVER_ADDREF(m_expr);
+		m_nodes = new NodeList;
+	}
+
+	~SwitchExpr() {
+		CLEVER_DELREF(m_expr);
+		clearNodes();
+		delete m_nodes;
+	}
+
+	ASTNode* getExpr() { return m_expr; }
+
+	bool hasReturn() const { return m_has_return; }
+	void setReturn() { m_has_return = true; }
+
+	void acceptVisitor(ASTVisitor& visitor) {
+		visitor.visit(this);
+	}
+private:
+	ASTNode* m_expr;
+	bool m_has_return;
+
+	DISALLOW_COPY_AND_ASSIGN(SwitchExpr);
+};
+
 class ForExpr : public ASTNode {
 public:
 	ForExpr(ASTNode* var_decl, ASTNode* condition, ASTNode* increment, ASTNode* block)
@@ -589,16 +646,29 @@ private:
 class ForEachExpr : public ASTNode {
 public:
 	ForEachExpr(ASTNode* var, Identifier* ident, ASTNode* block)
-		: m_var(var), m_ident(ident), m_block(block), m_it_value(NULL),
-		m_has_return(false) {
+		: m_var(var), m_ident(ident), m_value_ident(NULL), m_block(block),
+		m_it_value(NULL), m_cursor(NULL), m_key_value(NULL),
+		m_elem_value(NULL), m_has_return(false) {
 		CLEVER_ADDREF(m_var);
 		CLEVER_ADDREF(m_ident);
 		CLEVER_SAFE_ADDREF(m_block);
 	}
 
+	ForEachExpr(ASTNode* var, Identifier* key, Identifier* value,
+		ASTNode* block)
+		: m_var(var), m_ident(key), m_value_ident(value), m_block(block),
+		m_it_value(NULL), m_cursor(NULL), m_key_value(NULL),
+		m_elem_value(NULL), m_has_return(false) {
+		CLEVER_ADDREF(m_var);
+		CLEVER_ADDREF(m_ident);
+		CLEVER_ADDREF(m_value_ident);
+		CLEVER_SAFE_ADDREF(m_block);
+	}
+
 	~ForEachExpr() {
 		CLEVER_SAFE_DELREF(m_var);
 		CLEVER_SAFE_DELREF(m_ident);
+		CLEVER_SAFE_DELREF(m_value_ident);
 		CLEVER_SAFE_DELREF(m_block);
 	}
 
@@ -607,6 +677,28 @@ public:
 	Identifier* getIdentifier() const { return m_ident; }
 	ASTNode* getBlock() const { return m_block; }
 
+	/**
+	 * The second identifier of `for (var in key, value)'; only Array
+	 * and Map iteration accept it
+	 */
+	bool hasValueIdentifier() const { return m_value_ident != NULL; }
+	Identifier* getValueIdentifier() const { return m_value_ident; }
+
+	/**
+	 * Native iteration (Array and Map) state: the cursor is an Int index
+	 * or a MapIterator, and the key slot is NULL on single variable form
+	 */
+	bool isNative() const { return m_cursor != NULL; }
+
+	void setCursor(Value* value) { m_cursor = value; }
+	Value* getCursor() const { return m_cursor; }
+
+	void setKeyValue(Value* value) { m_key_value = value; }
+	Value* getKeyValue() const { return m_key_value; }
+
+	void setElemValue(Value* value) { m_elem_value = value; }
+	Value* getElemValue() const { return m_elem_value; }
+
 	void setValue(Value* value) { m_result = value; }
 	Value* getValue() const { return m_result; }
 
@@ -642,9 +734,13 @@ public:
 private:
 	ASTNode* m_var;
 	Identifier* m_ident;
+	Identifier* m_value_ident;
 	ASTNode* m_block;
 	Value* m_result;
 	Value* m_it_value;
+	Value* m_cursor;
+	Value* m_key_value;
+	Value* m_elem_value;
 	Value* m_var_value;
 	ValueVector* m_ctor_args;
 	CallableValue* m_ctor_value;
@@ -759,6 +855,8 @@ public:
 
 	bool hasValue() const { return true; }
 
+	BinaryExpr* asBinaryExpr() { return this; }
+
 	bool isAssigned() const { return m_assign; }
 
 	ASTNode* getLhs() const { return m_lhs; }
@@ -1181,6 +1279,57 @@ private:
 	DISALLOW_COPY_AND_ASSIGN(TypeCreation);
 };
 
+class Annotation : public ASTNode {
+public:
+	Annotation(Identifier* name, NumberLiteral* arg)
+		: m_name(name), m_arg(arg) {
+		CLEVER_ADDREF(m_name);
+		CLEVER_SAFE_ADDREF(m_arg);
+	}
+
+	~Annotation() {
+		CLEVER_DELREF(m_name);
+		CLEVER_SAFE_DELREF(m_arg);
+	}
+
+	const CString* getName() const { return m_name->getName(); }
+
+	NumberLiteral* getArg() const { return m_arg; }
+private:
+	Identifier* m_name;
+	NumberLiteral* m_arg;
+
+	DISALLOW_COPY_AND_ASSIGN(Annotation);
+};
+
+class AnnotationList : public ASTNode {
+public:
+	AnnotationList() {
+		m_nodes = new NodeList;
+	}
+
+	~AnnotationList() {
+		clearNodes();
+		delete m_nodes;
+	}
+
+	/**
+	 * Returns the annotation with the given name, or NULL when absent
+	 */
+	Annotation* find(const CString* name) {
+		NodeList::const_iterator it = m_nodes->begin(), end = m_nodes->end();
+
+		for (; it != end; ++it) {
+			if (static_cast<Annotation*>(*it)->getName() == name) {
+				return static_cast<Annotation*>(*it);
+			}
+		}
+		return NULL;
+	}
+private:
+	DISALLOW_COPY_AND_ASSIGN(AnnotationList);
+};
+
 class FuncPrototype : public ASTNode {
 public:
 	FuncPrototype(Identifier* name, Identifier* rtype, ArgumentDeclList* args)
@@ -1226,7 +1375,7 @@ public:
 	FuncDeclaration(Identifier* name, Identifier* rtype,
 		ArgumentDeclList* args, BlockNode* block, bool is_const = false)
 		: m_name(name), m_return(rtype), m_args(args), m_block(block),
-			m_value(NULL), m_is_const(is_const) {
+			m_value(NULL), m_is_const(is_const), m_annotations(NULL) {
 		CLEVER_SAFE_ADDREF(m_name);
 		CLEVER_SAFE_ADDREF(m_return);
 		CLEVER_SAFE_ADDREF(m_args);
@@ -1239,11 +1388,18 @@ public:
 		CLEVER_SAFE_DELREF(m_args);
 		CLEVER_SAFE_DELREF(m_block);
 		CLEVER_SAFE_DELREF(m_value);
+		CLEVER_SAFE_DELREF(m_annotations);
 	}
 
 	const CString* getName() const { return m_name->getName(); }
 	ArgumentDeclList* getArgs() const { return m_args; }
 
+	void setAnnotations(AnnotationList* annotations) {
+		CLEVER_ADDREF(annotations);
+		m_annotations = annotations;
+	}
+	AnnotationList* getAnnotations() const { return m_annotations; }
+
 	Identifier* getReturn() const { return m_return; }
 
 	Identifier* getReturnValue() const { return m_return ? m_return : NULL; }
@@ -1267,6 +1423,7 @@ protected:
 	BlockNode* m_block;
 	CallableValue* m_value;
 	bool m_is_const;
+	AnnotationList* m_annotations;
 private:
 	DISALLOW_COPY_AND_ASSIGN(FuncDeclaration);
 };
@@ -1752,6 +1909,31 @@ private:
 	DISALLOW_COPY_AND_ASSIGN(ReturnStmt);
 };
 
+class YieldStmt : public ASTNode {
+public:
+	explicit YieldStmt(ASTNode* expr)
+		: m_expr(expr) {
+		CLEVER_ADDREF(m_expr);
+	}
+
+	~YieldStmt() {
+		CLEVER_DELREF(m_expr);
+	}
+
+	ASTNode* getExpr() const { return m_expr; }
+
+	Value* getExprValue() const { return m_expr->getValue(); }
+
+	void acceptVisitor(ASTVisitor& visitor) {
+		m_expr->acceptVisitor(visitor);
+		visitor.visit(this);
+	}
+private:
+	ASTNode* m_expr;
+
+	DISALLOW_COPY_AND_ASSIGN(YieldStmt);
+};
+
 class IntegralValue : public ASTNode {
 public:
 	IntegralValue(int value) : m_int_value(value) { }
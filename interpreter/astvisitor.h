@@ -35,6 +35,7 @@ class BinaryExpr;
 class VariableDecl;
 class IfExpr;
 class WhileExpr;
+class SwitchExpr;
 class ForExpr;
 class ForEachExpr;
 class FunctionCall;
@@ -50,6 +51,7 @@ class FuncPrototype;
 class ExtFuncDeclaration;
 class ClassDeclaration;
 class ReturnStmt;
+class YieldStmt;
 class TypeCreation;
 class UnaryExpr;
 class AliasStmt;
@@ -78,6 +80,7 @@ class CopyExpr;
 	V(VarDecls); \
 	V(IfExpr); \
 	V(WhileExpr); \
+	V(SwitchExpr); \
 	V(ForExpr); \
 	V(ForEachExpr); \
 	V(BreakNode); \
@@ -90,6 +93,7 @@ class CopyExpr;
 	V(ExtFuncDeclaration); \
 	V(ClassDeclaration); \
 	V(ReturnStmt); \
+	V(YieldStmt); \
 	V(ArgumentList); \
 	V(Identifier); \
 	V(ArrayList); \
@@ -76,6 +76,9 @@ namespace clever {
 %token IF            "if"
 %token ELSE          "else"
 %token ELSEIF        "else if"
+%token SWITCH        "switch"
+%token CASE          "case"
+%token DEFAULT       "default"
 %token LESS_EQUAL    "<="
 %token GREATER_EQUAL ">="
 %token LESS          "<"
@@ -103,6 +106,7 @@ namespace clever {
 %token BW_OR_EQUAL   "|="
 %token BW_XOR_EQUAL  "^="
 %token RETURN        "return"
+%token YIELD         "yield"
 %token CLASS 	     "class"
 %token PUBLIC	     "public"
 %token PRIVATE       "private"
@@ -154,10 +158,12 @@ namespace clever {
 	ast::StringLiteral* str_literal;
 	ast::ClassStmtList* class_stmt;
 	ast::ReturnStmt* return_stmt;
+	ast::YieldStmt* yield_stmt;
 	ast::VariableDecl* variable_decl;
 	ast::VariableDecls* variable_decls;
 	ast::ClassDeclaration* class_decl;
 	ast::FuncDeclaration* func_decl;
+	ast::AnnotationList* annotation_list;
 	ast::FuncPrototype* func_proto;
 	ast::ExtFuncDeclaration* ext_func_decl;
 	ast::ExtFuncDecls* ext_func_decls;
@@ -167,6 +173,7 @@ namespace clever {
 	ast::ForEachExpr* foreach_expr;
 	ast::WhileExpr* while_expr;
 	ast::ElseIfExpr* elseif_opt;
+	ast::SwitchExpr* switch_expr;
 	ast::BlockNode* block_stmt;
 	ast::UnscopedBlockNode* block_stmt2;
 	ast::BreakNode* break_stmt;
@@ -188,6 +195,7 @@ namespace clever {
 }
 
 %type <identifier> IDENT
+%type <identifier> ANNOTATION
 %type <num_literal> NUM_INTEGER
 %type <num_literal> NUM_DOUBLE
 %type <str_literal> STR
@@ -210,6 +218,7 @@ namespace clever {
 %type <block_stmt> block_stmt
 %type <ast_node> statements
 %type <return_stmt> return_stmt
+%type <yield_stmt> yield_stmt
 %type <arg_decl_list> args_declaration_non_empty
 %type <arg_decl_list> args_declaration
 %type <func_decl> func_declaration
@@ -248,6 +257,8 @@ namespace clever {
 %type <if_expr> if_expr
 %type <elseif_opt> elseif_opt
 %type <block_stmt> else_opt
+%type <switch_expr> switch_expr
+%type <ast_node> case_label
 %type <break_stmt> break_stmt
 %type <import_stmt> import_stmt
 %type <import_stmt> import_stmt2
@@ -257,7 +268,7 @@ namespace clever {
 %type <arg_list> map_arg_list
 %type <map_list> map_list
 %type <lambda_function> lambda_function
-%type <ast_node> annotation
+%type <annotation_list> annotation
 
 %%
 
@@ -294,11 +305,13 @@ statements:
 	|	for_expr                 		{ $$ = $<ast_node>1; }
 	|	foreach_expr               		{ $$ = $<ast_node>1; }
 	|	while_expr               		{ $$ = $<ast_node>1; }
+	|	switch_expr               		{ $$ = $<ast_node>1; }
 	|	block_stmt               		{ $$ = $<ast_node>1; }
 	|	break_stmt ';'           		{ $$ = $<ast_node>1; }
 	|	import_stmt ';'          		{ $$ = $<ast_node>1; }
 	|	import_file ';'          		{ $$ = $<ast_node>1; }
 	|	return_stmt ';'          		{ $$ = $<ast_node>1; }
+	|	yield_stmt ';'           		{ $$ = $<ast_node>1; }
 	|	class_declaration	     		{ $$ = $<ast_node>1; }
 	|	alias_stmt ';'           		{ $$ = $<ast_node>1; }
 ;
@@ -308,6 +321,10 @@ return_stmt:
 	|	RETURN      { $$ = new ast::ReturnStmt();   $$->setLocation(yylloc); }
 ;
 
+yield_stmt:
+		YIELD expr { $$ = new ast::YieldStmt($2); $$->setLocation(yylloc); }
+;
+
 args_declaration_non_empty:
 		TYPE IDENT                      	{ $$ = new ast::ArgumentDeclList(); $$->addArg($1, $2, false); }
 	|	CONST TYPE IDENT                   	{ $$ = new ast::ArgumentDeclList(); $$->addArg($2, $3, true);  }
@@ -325,8 +342,10 @@ args_declaration:
 ;
 
 annotation:
-		ANNOTATION            { $$ = NULL; }
-	|	annotation ANNOTATION { $$ = NULL; }
+		ANNOTATION                                   { $$ = new ast::AnnotationList; $$->add(new ast::Annotation($1, NULL)); }
+	|	ANNOTATION '(' NUM_INTEGER ')'               { $$ = new ast::AnnotationList; $$->add(new ast::Annotation($1, $3)); }
+	|	annotation ANNOTATION                        { $$ = $1; $$->add(new ast::Annotation($2, NULL)); }
+	|	annotation ANNOTATION '(' NUM_INTEGER ')'    { $$ = $1; $$->add(new ast::Annotation($2, $4)); }
 ;
 
 func_prototype:
@@ -336,10 +355,10 @@ func_prototype:
 func_declaration:
 		TYPE IDENT '(' args_declaration ')' block_stmt                { $$ = new ast::FuncDeclaration($2, $1, $4, $6);       $$->setLocation(yyloc); }
 	|	CONST TYPE IDENT '(' args_declaration ')' block_stmt          { $$ = new ast::FuncDeclaration($3, $2, $5, $7, true); $$->setLocation(yyloc); }
-	|	annotation TYPE IDENT '(' args_declaration ')' block_stmt     { $$ = new ast::FuncDeclaration($3, $2, $5, $7);       $$->setLocation(yyloc); }
+	|	annotation TYPE IDENT '(' args_declaration ')' block_stmt     { $$ = new ast::FuncDeclaration($3, $2, $5, $7);       $$->setAnnotations($1); $$->setLocation(yyloc); }
 	|	template IDENT '(' args_declaration ')' block_stmt            { $$ = new ast::FuncDeclaration($2, $1, $4, $6);       $$->setLocation(yyloc); }
 	|	CONST template IDENT '(' args_declaration ')' block_stmt      { $$ = new ast::FuncDeclaration($3, $2, $5, $7, true); $$->setLocation(yyloc); }
-	|	annotation template IDENT '(' args_declaration ')' block_stmt { $$ = new ast::FuncDeclaration($3, $2, $5, $7);       $$->setLocation(yyloc); }
+	|	annotation template IDENT '(' args_declaration ')' block_stmt { $$ = new ast::FuncDeclaration($3, $2, $5, $7);       $$->setAnnotations($1); $$->setLocation(yyloc); }
 ;
 
 lambda_function:
@@ -633,6 +652,7 @@ for_expr:
 
 foreach_expr:
 		FOR '(' expr IN  IDENT ')' block_stmt { $$ = new ast::ForEachExpr($3, $5, $7); $$->setLocation(yylloc); }
+	|	FOR '(' expr IN  IDENT ',' IDENT ')' block_stmt { $$ = new ast::ForEachExpr($3, $5, $7, $9); $$->setLocation(yylloc); }
 ;
 
 while_expr:
@@ -654,6 +674,23 @@ else_opt:
 	|	ELSE block_stmt { $$ = $2;   }
 ;
 
+switch_expr:
+		SWITCH '(' expr ')' '{' { $<switch_expr>$ = new ast::SwitchExpr($3); $<switch_expr>$->setLocation(yylloc); }
+		case_list '}'           { $$ = $<switch_expr>6; }
+;
+
+case_list:
+		/* empty */
+	|	case_list case_label ':' statement_list { $<switch_expr>0->add(new ast::CaseNode($2, $4)); }
+;
+
+case_label:
+		CASE NUM_INTEGER     { $$ = $2; $$->setLocation(yylloc); }
+	|	CASE '-' NUM_INTEGER { $$ = new ast::NumberLiteral(-$3->getValue()->getInteger()); delete $3; $$->setLocation(yylloc); }
+	|	CASE STR             { $$ = $2; $$->setLocation(yylloc); }
+	|	DEFAULT              { $$ = NULL; }
+;
+
 break_stmt:
 		BREAK { $$ = new ast::BreakNode(); $$->setLocation(yylloc); }
 ;
@@ -53,11 +53,16 @@ clever_module_msg(std_ffi ${MOD_STD_FFI})
 # std.rpc
 if (MOD_STD_RPC)
 	if (LIBPTHREAD_FOUND AND FFI_FOUND)
-		add_definitions(-DHAVE_LIBPTHREAD)
-		add_definitions(-pthread -DHAVE_FFI)
+		add_definitions(-DHAVE_FFI)
 		add_definitions(-DHAVE_MOD_STD_RPC)
-		list(APPEND CLEVER_INCLUDE_DIRS ${LIBPTHREAD_INCLUDE_DIRS} ${FFI_INCLUDE_DIRS})
-		list(APPEND CLEVER_LIBRARIES ${LIBPTHREAD_LIBRARIES} ${FFI_LIBRARIES} dl)
+		list(APPEND CLEVER_INCLUDE_DIRS ${FFI_INCLUDE_DIRS})
+		list(APPEND CLEVER_LIBRARIES ${FFI_LIBRARIES} dl)
+
+		# shm_open() lives in librt before glibc 2.34
+		find_library(LIBRT_LIBRARIES rt)
+		if (LIBRT_LIBRARIES)
+			list(APPEND CLEVER_LIBRARIES ${LIBRT_LIBRARIES})
+		endif (LIBRT_LIBRARIES)
 	else (LIBPTHREAD_FOUND AND FFI_FOUND)
 		clever_module_msg(std_rpc "libpthread or libffi not found. disabling.")
 		set(MOD_STD_RPC OFF)
@@ -24,10 +24,12 @@
  */
 
 #include <fstream>
+#include <vector>
 #include "compiler/compiler.h"
 #include "compiler/cstring.h"
 #include "modules/std/file/filestream.h"
 #include "types/nativetypes.h"
+#include "types/serializer.h"
 
 namespace clever { namespace packages { namespace std { namespace file {
 
@@ -219,6 +221,64 @@ CLEVER_METHOD(FileStream::writeLine) {
 	fsv->m_fstream << "\n";
 }
 
+/**
+ * FileStream::writeValue(object value)
+ * Writes the binary encoding of a native value, see serialize()
+ */
+CLEVER_METHOD(FileStream::writeValue) {
+	FileStreamValue* fsv = CLEVER_GET_VALUE(FileStreamValue*, value);
+
+	if (!fsv->m_fstream.is_open()) {
+		clever_error("calling FileStream::writeValue([Object]) :"
+			" no file stream is open (use Filestream::open() before)");
+	}
+
+	// Each value is prefixed by the size of its encoding
+	::std::string data(sizeof(uint32_t), '\0');
+
+	if (!Serializer::serialize(CLEVER_ARG(0), data)) {
+		clever_fatal("FileStream::writeValue(): unable to serialize a value of type %S",
+			CLEVER_ARG(0)->getTypePtr()->getName());
+	}
+
+	uint32_t size = data.size() - sizeof(uint32_t);
+
+	data.replace(0, sizeof(size), reinterpret_cast<const char*>(&size), sizeof(size));
+
+	fsv->m_fstream.write(data.data(), data.size());
+}
+
+/**
+ * Bool FileStream::readValue(object output)
+ * Reads a value written by writeValue() into output. Returns false, leaving
+ * output untouched, when the stream doesn't hold a value of its type
+ */
+CLEVER_METHOD(FileStream::readValue) {
+	FileStreamValue* fsv = CLEVER_GET_VALUE(FileStreamValue*, value);
+
+	if (!fsv->m_fstream.is_open()) {
+		clever_error("calling FileStream::readValue([Object]) :"
+			" no file stream is open (use Filestream::open() before)");
+	}
+
+	uint32_t size;
+
+	if (!fsv->m_fstream.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+		CLEVER_RETURN_BOOL(false);
+		return;
+	}
+
+	::std::vector<char> data(size);
+
+	if (size && !fsv->m_fstream.read(&data[0], size)) {
+		CLEVER_RETURN_BOOL(false);
+		return;
+	}
+
+	CLEVER_RETURN_BOOL(size
+		&& Serializer::deserialize(&data[0], size, CLEVER_ARG(0)));
+}
+
 void FileStream::init() {
 	const Type* fstream = CLEVER_TYPE("FileStream");
 
@@ -294,6 +354,19 @@ void FileStream::init() {
 			->addArg("data", CLEVER_BYTE)
 	);
 
+	addMethod(
+		(new Method("writeValue", (MethodPtr)&FileStream::writeValue, CLEVER_VOID))
+			->setVariadic()
+			->setMinNumArgs(1)
+	);
+
+	addMethod(
+		(new Method("readValue", (MethodPtr)&FileStream::readValue, CLEVER_BOOL))
+			->setVariadic()
+			->setMinNumArgs(1)
+			->setOutputArg(0)
+	);
+
 	addMethod(
 		(new Method("writeLine", (MethodPtr)&FileStream::writeLine,CLEVER_VOID))
 			->addArg("data", CLEVER_STR)
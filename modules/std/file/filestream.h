@@ -51,6 +51,8 @@ public:
 	static CLEVER_METHOD(read);
 	static CLEVER_METHOD(write);
 	static CLEVER_METHOD(writeLine);
+	static CLEVER_METHOD(writeValue);
+	static CLEVER_METHOD(readValue);
 	static CLEVER_METHOD(toString);
 	static CLEVER_METHOD(do_assign);
 private:
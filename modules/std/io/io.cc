@@ -23,15 +23,38 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <cctype>
+#include <cstdio>
 #include <iostream>
+#include "compiler/numconv.h"
 #include "compiler/pkgmanager.h"
 #include "compiler/value.h"
 #include "modules/std/io/io.h"
 #include "types/nativetypes.h"
+#include "types/serializer.h"
 
 namespace clever { namespace packages { namespace std {
 
 namespace io {
+
+/**
+ * Reads a whitespace delimited word from the standard input
+ */
+static void _read_word(::std::string& buffer) {
+	int c;
+
+	while ((c = ::getchar()) != EOF && ::isspace(c)) {}
+
+	while (c != EOF && !::isspace(c)) {
+		buffer += char(c);
+		c = ::getchar();
+	}
+
+	if (c != EOF) {
+		::ungetc(c, stdin);
+	}
+}
+
 /**
  * println(object a, [ ...])
  * Prints the object values without trailing newline
@@ -80,10 +103,13 @@ static CLEVER_FUNCTION(readString) {
  * Reads an Int from the standard input.
  */
 static CLEVER_FUNCTION(readInt) {
-	int64_t buffer;
-	::std::cin >> buffer;
+	::std::string buffer;
+	int64_t num = 0;
 
-	CLEVER_RETURN_INT(buffer);
+	_read_word(buffer);
+	parse_int(buffer.c_str(), num);
+
+	CLEVER_RETURN_INT(num);
 }
 
 /**
@@ -91,10 +117,44 @@ static CLEVER_FUNCTION(readInt) {
  * Reads a Double from the standard input.
  */
 static CLEVER_FUNCTION(readDouble) {
-	double buffer;
-	::std::cin >> buffer;
+	::std::string buffer;
+	double num = 0.0;
+
+	_read_word(buffer);
+	parse_double(buffer.c_str(), num);
 
-	CLEVER_RETURN_DOUBLE(buffer);
+	CLEVER_RETURN_DOUBLE(num);
+}
+
+/**
+ * String serialize(object value)
+ * Returns the binary encoding of a native value
+ */
+static CLEVER_FUNCTION(serialize) {
+	::std::string data;
+
+	if (!Serializer::serialize(CLEVER_ARG(0), data)) {
+		clever_fatal("serialize(): unable to serialize a value of type %S",
+			CLEVER_ARG(0)->getTypePtr()->getName());
+	}
+
+	CLEVER_RETURN_STR(CSTRINGT(data));
+}
+
+/**
+ * Bool deserialize(String data, object output)
+ * Decodes a value encoded by serialize() into output. Returns false, leaving
+ * output untouched, when data doesn't hold a value of the output's type
+ */
+static CLEVER_FUNCTION(deserialize) {
+	if (!CLEVER_ARG_IS_STR(0)) {
+		clever_fatal("deserialize(): the data must be a String");
+	}
+
+	const CString& data = CLEVER_ARG(0)->getString();
+
+	CLEVER_RETURN_BOOL(Serializer::deserialize(data.data(), data.size(),
+		CLEVER_ARG(1)));
 }
 
 } // namespace io
@@ -121,6 +181,15 @@ CLEVER_MODULE_INIT(IOModule) {
 	addFunction(new Function("readInt", &CLEVER_FUNC_NAME(readInt), CLEVER_INT));
 	addFunction(new Function("readDouble", &CLEVER_FUNC_NAME(readDouble), CLEVER_DOUBLE));
 
+	addFunction(new Function("serialize", &CLEVER_FUNC_NAME(serialize), CLEVER_STR))
+		->setVariadic()
+		->setMinNumArgs(1);
+
+	addFunction(new Function("deserialize", &CLEVER_FUNC_NAME(deserialize), CLEVER_BOOL))
+		->setVariadic()
+		->setMinNumArgs(2)
+		->setOutputArg(1);
+
 	END_DECLARE();
 }
 
@@ -302,42 +302,52 @@ CLEVER_MODULE_INIT(Math) {
 	BEGIN_DECLARE_FUNCTION();
 
 	addFunction(new Function("abs",	&CLEVER_NS_FNAME(math, abs_double), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 /*	addFunction(new Function("abs",	&CLEVER_NS_FNAME(math, abs_int), CLEVER_INT))
 		->addArg("x", CLEVER_INT);
 */
 	addFunction(new Function("acos", &CLEVER_NS_FNAME(math, acos), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("asin", &CLEVER_NS_FNAME(math, asin), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("atan", &CLEVER_NS_FNAME(math, atan), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("ceil", &CLEVER_NS_FNAME(math, ceil), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("cos",  &CLEVER_NS_FNAME(math, cos), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("floor",  &CLEVER_NS_FNAME(math, floor), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("log", &CLEVER_NS_FNAME(math, logb), CLEVER_DOUBLE))
 		->addArg("x", CLEVER_DOUBLE)
-		->addArg("base", CLEVER_DOUBLE);
+		->addArg("base", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 /*	addFunction(new Function("log",  &CLEVER_NS_FNAME(math, loge), CLEVER_DOUBLE))
 		->addArg("value", CLEVER_DOUBLE);
 */
 	addFunction(new Function("log10",  &CLEVER_NS_FNAME(math, log10), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("max", &CLEVER_NS_FNAME(math, max_double), CLEVER_DOUBLE))
 		->addArg("x", CLEVER_DOUBLE)
-		->addArg("y", CLEVER_DOUBLE);
+		->addArg("y", CLEVER_DOUBLE)
+		->setThreadSafe();
 /*
 	addFunction(new Function("max", &CLEVER_NS_FNAME(math, max_int), CLEVER_INT))
 		->addArg("x", CLEVER_INT)
@@ -345,7 +355,8 @@ CLEVER_MODULE_INIT(Math) {
 
 	addFunction(new Function("min", &CLEVER_NS_FNAME(math, min_double), CLEVER_DOUBLE))
 		->addArg("x", CLEVER_DOUBLE)
-		->addArg("y", CLEVER_DOUBLE);
+		->addArg("y", CLEVER_DOUBLE)
+		->setThreadSafe();
 /*
 	addFunction(new Function("min", &CLEVER_NS_FNAME(math, min_int), CLEVER_INT))
 		->addArg("x", CLEVER_INT)
@@ -353,32 +364,39 @@ CLEVER_MODULE_INIT(Math) {
 
 	addFunction(new Function("pow",  &CLEVER_NS_FNAME(math, pow_double), CLEVER_DOUBLE))
 		->addArg("x", CLEVER_DOUBLE)
-		->addArg("y", CLEVER_DOUBLE);/*
+		->addArg("y", CLEVER_DOUBLE)
+		->setThreadSafe();/*
 
 	addFunction(new Function("pow",  &CLEVER_NS_FNAME(math, pow_int), CLEVER_INT))
 		->addArg("x", CLEVER_INT)
 		->addArg("exp", CLEVER_INT);*/
 
 	addFunction(new Function("round",  &CLEVER_NS_FNAME(math, round), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("sin",  &CLEVER_NS_FNAME(math, sin), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("sign", &CLEVER_NS_FNAME(math, sign_double), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 /*
 	addFunction(new Function("sign", &CLEVER_NS_FNAME(math, sign_int), CLEVER_INT))
 		->addArg("x", CLEVER_INT);*/
 
 	addFunction(new Function("sqrt", &CLEVER_NS_FNAME(math, sqrt), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("tan",  &CLEVER_NS_FNAME(math, tan), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	addFunction(new Function("truncate",  &CLEVER_NS_FNAME(math, truncate), CLEVER_DOUBLE))
-		->addArg("x", CLEVER_DOUBLE);
+		->addArg("x", CLEVER_DOUBLE)
+		->setThreadSafe();
 
 	END_DECLARE();
 }
@@ -103,6 +103,35 @@ bool CSocket::connect() {
 	return true;
 }
 
+bool CSocket::shutdown() {
+	resetError();
+
+#ifdef CLEVER_WIN32
+	if (::shutdown(m_socket, SD_BOTH) == 0) {
+#else
+	if (::shutdown(m_socket, SHUT_RDWR) == 0) {
+#endif
+		return true;
+	}
+
+	setError();
+	return false;
+}
+
+bool CSocket::setNoDelay() {
+	int on = 1;
+
+	resetError();
+
+	if (::setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY,
+		reinterpret_cast<const char*>(&on), sizeof(on)) == 0) {
+		return true;
+	}
+
+	setError();
+	return false;
+}
+
 bool CSocket::close() {
 	int res;
 
@@ -157,6 +186,69 @@ bool CSocket::send(const char *buffer, int length) {
 	return true;
 }
 
+bool CSocket::receiveAll(char *buffer, int length) {
+	int received = 0;
+
+	resetError();
+
+	while (received < length) {
+		int res = ::recv(m_socket, &buffer[received], (length - received), 0);
+
+		if (res > 0) {
+			received += res;
+#ifndef CLEVER_WIN32
+		} else if (res < 0 && errno == EINTR) {
+			continue;
+#endif
+		} else {
+			setError();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CSocket::sendv(struct iovec* iov, int count) {
+#ifdef CLEVER_WIN32
+	for (int i = 0; i < count; ++i) {
+		if (!send(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len)) {
+			return false;
+		}
+	}
+
+	return true;
+#else
+	resetError();
+
+	while (count > 0) {
+		ssize_t res = ::writev(m_socket, iov, count);
+
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			setError();
+			return false;
+		}
+
+		// writev() may stop in the middle of a buffer, skip what was sent
+		while (count > 0 && static_cast<size_t>(res) >= iov->iov_len) {
+			res -= iov->iov_len;
+			++iov;
+			--count;
+		}
+
+		if (count > 0) {
+			iov->iov_base = static_cast<char*>(iov->iov_base) + res;
+			iov->iov_len -= res;
+		}
+	}
+
+	return true;
+#endif
+}
+
 bool CSocket::isOpen() {
 	struct timeval timeout;
 	char buf;
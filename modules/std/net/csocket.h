@@ -26,8 +26,10 @@
 #include <string>
 #ifndef _WIN32
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #else
 #include <ws2tcpip.h>
@@ -39,6 +41,13 @@
 #define NO_ERROR 0
 #endif
 
+#ifdef _WIN32
+struct iovec {
+	void* iov_base;
+	size_t iov_len;
+};
+#endif
+
 namespace clever {
 
 class CSocket {
@@ -53,9 +62,29 @@ public:
 	bool connect();
 	bool close();
 
+	/**
+	 * Ends both directions, a thread blocked receiving returns
+	 */
+	bool shutdown();
+
+	/**
+	 * Sends small writes at once instead of coalescing them (Nagle)
+	 */
+	bool setNoDelay();
+
 	bool receive(const char *buffer, int length);
 	bool send(const char *buffer, int length);
 
+	/**
+	 * Blocks until exactly length bytes were received
+	 */
+	bool receiveAll(char *buffer, int length);
+
+	/**
+	 * Sends the buffers in order with as few system calls as possible
+	 */
+	bool sendv(struct iovec* iov, int count);
+
 	bool isOpen();
 	bool poll();
 
@@ -65,16 +65,15 @@ CLEVER_METHOD(Pcre::matches) {
 			return;
 		} else if (n > 0 && self->match.groups == NULL) {
 			self->match.n_groups = n;
-			self->match.matches = new ::std::string[n];
+			self->match.matches = new pcrecpp::StringPiece[n];
 			self->match.groups = new pcrecpp::Arg*[n];
-			self->match.input = haystack->str();
-			self->match.last_input = haystack;
 
 			for (int i = 0; i < n; ++i) {
 				self->match.groups[i] = new pcrecpp::Arg;
 				*self->match.groups[i] = &self->match.matches[i];
 			}
 		}
+		self->match.setInput(haystack);
 	} else {
 		n = self->match.n_groups;
 	}
@@ -99,7 +98,10 @@ CLEVER_METHOD(Pcre::group) {
 	if (CLEVER_ARG_INT(0) >= self->match.n_groups) {
 		CLEVER_RETURN_EMPTY_STR();
 	} else {
-		CLEVER_RETURN_STR(CSTRINGT(self->match.matches[CLEVER_ARG_INT(0)]));
+		// The group is just a piece of the input until it gets requested
+		const pcrecpp::StringPiece& piece = self->match.matches[CLEVER_ARG_INT(0)];
+
+		CLEVER_RETURN_STR(CSTRINGT(piece.as_string()));
 	}
 }
 
@@ -28,6 +28,7 @@
 
 #include <pcrecpp.h>
 #include <string>
+#include "compiler/cstring.h"
 #include "compiler/datavalue.h"
 
 
@@ -39,6 +40,8 @@ public:
 		: last_input(NULL), groups(NULL), matches(NULL), n_groups(0) {}
 
 	~PcreMatch() {
+		setInput(NULL);
+
 		if (groups == NULL) {
 			return;
 		}
@@ -51,9 +54,27 @@ public:
 		delete[] groups;
 	}
 
+	/**
+	 * Sets the string being matched, holding a reference to it since the
+	 * captured groups point into its buffer until they are requested
+	 */
+	void setInput(const CString* str) {
+		if (str && !str->isInterned()) {
+			const_cast<CString*>(str)->addRef();
+		}
+		if (last_input && !last_input->isInterned()) {
+			const_cast<CString*>(last_input)->delRef();
+		}
+		last_input = str;
+
+		if (str) {
+			input = str->str();
+		}
+	}
+
 	const CString* last_input;
 	pcrecpp::Arg** groups;
-	::std::string* matches;
+	pcrecpp::StringPiece* matches;
 	int n_groups;
 	pcrecpp::StringPiece input;
 private:
@@ -34,6 +34,7 @@
 #include "modules/std/rpc/rpc.h"
 #include "modules/std/rpc/rpcclass.h"
 #include "modules/std/rpc/rpcobject.h"
+#include "modules/std/rpc/rpcfuture.h"
 #include "compiler/pkgmanager.h"
 
 namespace clever { namespace packages { namespace std {
@@ -46,6 +47,7 @@ CLEVER_MODULE_INIT(RPCModule) {
 
 	addClass(new rpc::RPC);
 	addClass(new rpc::RPCObject);
+	addClass(new rpc::RPCFuture);
 
 	END_DECLARE();
 }
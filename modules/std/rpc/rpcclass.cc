@@ -32,6 +32,7 @@
 #include "compiler/compiler.h"
 #include "compiler/cstring.h"
 #include "types/nativetypes.h"
+#include "types/serializer.h"
 
 namespace clever { namespace packages { namespace std { namespace rpc {
 
@@ -60,7 +61,18 @@ CLEVER_METHOD(RPC::client) {
 CLEVER_METHOD(RPC::server) {
 	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
 
-	rv->createServer(CLEVER_ARG_INT(0), CLEVER_ARG_INT(1));
+	size_t nargs = CLEVER_NUM_ARGS();
+
+	// Optionally the callProcess() workers and the queue length
+	int workers = nargs > 2 ? CLEVER_ARG_INT(2) : 0;
+	int queue_size = nargs > 3 ? CLEVER_ARG_INT(3) : 0;
+
+	// A port, or an address such as shm://name
+	if (CLEVER_ARG_IS_STR(0)) {
+		rv->createServer(CLEVER_ARG_STR(0).c_str(), CLEVER_ARG_INT(1), workers, queue_size);
+	} else {
+		rv->createServer(CLEVER_ARG_INT(0), CLEVER_ARG_INT(1), workers, queue_size);
+	}
 }
 
 CLEVER_METHOD(RPC::sendString) {
@@ -99,15 +111,28 @@ CLEVER_METHOD(RPC::sendInit) {
 	CLEVER_RETURN_BOOL(rv->sendInit());
 }
 
-CLEVER_METHOD(RPC::callFunction) {
+CLEVER_METHOD(RPC::beginBatch) {
 	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+
+	rv->beginBatch();
+}
+
+CLEVER_METHOD(RPC::endBatch) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+
+	rv->endBatch();
+}
+
+/**
+ * Packs the arguments of a call from args[first] on, each one as its
+ * type tag followed by its value
+ */
+static char* pack_call_args(const ValueVector* args, size_t first, int& len_args) {
 	size_t size = CLEVER_NUM_ARGS();
-	const char* fname = CLEVER_ARG_STR(0).c_str();
-	int len_fname = CLEVER_ARG_STR(0).size();
-	int n_args = size-1;
-	int len_args = 0;
 
-	for(size_t i=1;i<size;++i){
+	len_args = 0;
+
+	for(size_t i=first;i<size;++i){
 		len_args+=sizeof(char);
 		if (CLEVER_ARG_IS_INT(i)) {
 			len_args+=sizeof(int);
@@ -127,7 +152,7 @@ CLEVER_METHOD(RPC::callFunction) {
 	char* buffer = static_cast<char*>(malloc(len_args+1));
 
 	len_args=0;
-	for(size_t i=1;i<size;++i){
+	for(size_t i=first;i<size;++i){
 		if (CLEVER_ARG_IS_INT(i)) {
 			buffer[len_args]='i';
 			len_args+=sizeof(char);
@@ -180,6 +205,18 @@ CLEVER_METHOD(RPC::callFunction) {
 		}
 	}
 
+	return buffer;
+}
+
+CLEVER_METHOD(RPC::callFunction) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	size_t size = CLEVER_NUM_ARGS();
+	const char* fname = CLEVER_ARG_STR(0).c_str();
+	int len_fname = CLEVER_ARG_STR(0).size();
+	int n_args = size-1;
+	int len_args;
+	char* buffer = pack_call_args(args, 1, len_args);
+
 	rv->sendFunctionCall(fname,buffer,len_fname,n_args,len_args);
 	free(buffer);
 
@@ -193,83 +230,104 @@ CLEVER_METHOD(RPC::callProcess) {
 	const char* fname = CLEVER_ARG_STR(1).c_str();
 	int len_fname = CLEVER_ARG_STR(1).size();
 	int n_args = size-2;
-	int len_args = 0;
-
-	for(size_t i=2;i<size;++i){
-		len_args+=sizeof(char);
-		if (CLEVER_ARG_IS_INT(i)) {
-			len_args+=sizeof(int);
-		} else if (CLEVER_ARG_IS_BOOL(i)) {
-			len_args+=sizeof(char);
-		} else if (CLEVER_ARG_IS_STR(i)) {
-			len_args+=sizeof(int);
-			len_args+=CLEVER_ARG_STR(i).size();
-		} else if (CLEVER_ARG_IS_BYTE(i)) {
-			len_args+=sizeof(char);
-		} else if (CLEVER_ARG_IS_DOUBLE(i)) {
-			len_args+=sizeof(double);
-		} else if ( CLEVER_ARG_IS_INTERNAL(i) ) {
-		}
-	}
+	int len_args;
+	char* buffer = pack_call_args(args, 2, len_args);
 
-	char* buffer = static_cast<char*>(malloc(len_args+1));
+	rv->sendProcessCall(id_process,fname,buffer,len_fname,n_args,len_args);
+	free(buffer);
+}
 
-	len_args=0;
-	for(size_t i=2;i<size;++i){
-		if (CLEVER_ARG_IS_INT(i)) {
-			buffer[len_args]='i';
-			len_args+=sizeof(char);
+/**
+ * RPCFuture RPC::callAsync(String fname, ...), sends the call and
+ * returns without waiting for its result
+ */
+CLEVER_METHOD(RPC::callAsync) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	size_t size = CLEVER_NUM_ARGS();
+	const char* fname = CLEVER_ARG_STR(0).c_str();
+	int len_fname = CLEVER_ARG_STR(0).size();
+	int n_args = size-1;
+	int len_args;
+	char* buffer = pack_call_args(args, 1, len_args);
+	RPCFutureValue* future = new RPCFutureValue;
 
-			int vi = CLEVER_ARG_INT(i);
+	future->id = rv->sendAsyncCall(fname,buffer,len_fname,n_args,len_args);
+	free(buffer);
 
-			memcpy(buffer+len_args,&vi,sizeof(int));
-			len_args+=sizeof(int);
+	future->client = rv;
+	rv->addRef();
 
-		} else if (CLEVER_ARG_IS_BOOL(i)) {
-			buffer[len_args]='b';
-			len_args+=sizeof(char);
+	CLEVER_RETURN_DATA_VALUE(future);
+}
 
-			char vb = CLEVER_ARG_BOOL(i);
+/**
+ * Collects the ids of the futures whose result was not taken from the
+ * connection yet. Returns the index of the first one taken, or -1
+ */
+static int pending_futures(RPCValue* rv, ValueVector* futures,
+		::std::vector<int>& ids, ::std::vector<size_t>& index) {
+	int taken = -1;
 
-			memcpy(buffer+len_args,&vb,sizeof(char));
-			len_args+=sizeof(char);
+	for (size_t i = 0; i < futures->size(); ++i) {
+		RPCFutureValue* f = CLEVER_GET_VALUE(RPCFutureValue*, futures->at(i));
 
-		} else if (CLEVER_ARG_IS_STR(i)) {
-			buffer[len_args]='s';
-			len_args+=sizeof(char);
+		if (f == NULL || f->client == NULL) {
+			clever_fatal("[RPC] Waiting for a future that was not returned by callAsync()!");
+		}
 
-			int len=(int)(CLEVER_ARG_STR(i).size());
-			const char* s=CLEVER_ARG_STR(i).c_str();
+		if (f->client != rv) {
+			clever_fatal("[RPC] Waiting for a future of another connection!");
+		}
 
-			memcpy(buffer+len_args,&len,sizeof(int));
+		if (f->result) {
+			if (taken < 0) {
+				taken = i;
+			}
+			continue;
+		}
 
-			len_args+=sizeof(int);
+		ids.push_back(f->id);
+		index.push_back(i);
+	}
 
-			memcpy(buffer+len_args,s,len);
-			len_args+=len;
+	return taken;
+}
 
-		} else if (CLEVER_ARG_IS_BYTE(i)) {
-			buffer[len_args]='c';
-			len_args+=sizeof(char);
+/**
+ * Int RPC::waitAny(Array<RPCFuture> futures [, Double timeout]), the
+ * index of a future whose result arrived, -1 if none did in timeout
+ * seconds
+ */
+CLEVER_METHOD(RPC::waitAny) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	double timeout = CLEVER_NUM_ARGS() > 1 ? CLEVER_ARG_DOUBLE(1) : -1;
+	::std::vector<int> ids;
+	::std::vector<size_t> index;
+	int taken = pending_futures(rv, CLEVER_ARG_ARRAY(0), ids, index);
+
+	if (taken >= 0) {
+		CLEVER_RETURN_INT(taken);
+		return;
+	}
 
-			char vb = CLEVER_ARG_BOOL(i);
+	int found = rv->waitReplies(ids, false, timeout);
 
-			memcpy(buffer+len_args,&vb,sizeof(char));
-			len_args+=sizeof(char);
-		} else if (CLEVER_ARG_IS_DOUBLE(i)) {
-			buffer[len_args]='d';
-			len_args+=sizeof(char);
+	CLEVER_RETURN_INT(found < 0 ? -1 : int64_t(index[found]));
+}
 
-			double vd = CLEVER_ARG_DOUBLE(i);
+/**
+ * Bool RPC::waitAll(Array<RPCFuture> futures [, Double timeout]),
+ * false if some result did not arrive in timeout seconds
+ */
+CLEVER_METHOD(RPC::waitAll) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	double timeout = CLEVER_NUM_ARGS() > 1 ? CLEVER_ARG_DOUBLE(1) : -1;
+	::std::vector<int> ids;
+	::std::vector<size_t> index;
 
-			memcpy(buffer+len_args,&vd,sizeof(double));
-			len_args+=sizeof(double);
-		} else if ( CLEVER_ARG_IS_INTERNAL(i) ) {
-		}
-	}
+	pending_futures(rv, CLEVER_ARG_ARRAY(0), ids, index);
 
-	rv->sendProcessCall(id_process,fname,buffer,len_fname,n_args,len_args);
-	free(buffer);
+	CLEVER_RETURN_BOOL(rv->waitReplies(ids, true, timeout) == 0);
 }
 
 CLEVER_METHOD(RPC::waitResult) {
@@ -345,10 +403,306 @@ CLEVER_METHOD(RPC::recvMsgObject) {
 	CLEVER_RETURN_DATA_VALUE(rv->receiveObject(id_message, time_sleep));
 }
 
+/**
+ * Void RPC::sendMsgValue(Int id_message, object value), sends the binary
+ * encoding of a native value, see serialize()
+ */
+CLEVER_METHOD(RPC::sendMsgValue) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	::std::string data;
+
+	if (!CLEVER_ARG_IS_INT(0)) {
+		clever_fatal("[RPC] sendMsgValue(): the message id must be an Int!");
+	}
+	if (!Serializer::serialize(CLEVER_ARG(1), data)) {
+		clever_fatal("[RPC] sendMsgValue(): unable to serialize a value of type %S!",
+			CLEVER_ARG(1)->getTypePtr()->getName());
+	}
+
+	rv->sendObject(CLEVER_ARG_INT(0), data.data(), data.size());
+}
+
+/**
+ * Bool RPC::recvMsgValue(Int id_message, Double time_sleep, object output),
+ * decodes a message sent by sendMsgValue() into output straight from the
+ * received buffer. Returns false, leaving output untouched, when the message
+ * doesn't hold a value of the output's type
+ */
+CLEVER_METHOD(RPC::recvMsgValue) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+
+	if (!CLEVER_ARG_IS_INT(0) || !CLEVER_ARG(1)->isNumeric()) {
+		clever_fatal("[RPC] recvMsgValue(): expected an Int message id and a time to sleep!");
+	}
+
+	double time_sleep = CLEVER_ARG_IS_INT(1) ?
+		CLEVER_ARG_INT(1) : CLEVER_ARG_DOUBLE(1);
+	RPCObjectValue* obj = rv->receiveObject(CLEVER_ARG_INT(0), time_sleep);
+	bool ok = Serializer::deserialize(static_cast<const char*>(obj->pointer),
+		obj->size, CLEVER_ARG(2));
+
+	free(obj->pointer);
+	obj->delRef();
+
+	CLEVER_RETURN_BOOL(ok);
+}
+
+
+/**
+ * Packs the operand of a collective: an Int, Double or String, or an
+ * array of Int or Double. Returns the type of its elements
+ */
+static int pack_operand(Value* v, ::std::vector<char>& data) {
+	if (v->isInteger()) {
+		int64_t i = v->getInteger();
+
+		data.assign((char*)&i, (char*)&i + sizeof(i));
+		return 'i';
+	}
+
+	if (v->isDouble()) {
+		double d = v->getDouble();
+
+		data.assign((char*)&d, (char*)&d + sizeof(d));
+		return 'd';
+	}
+
+	if (v->isString()) {
+		data.assign(v->getString().begin(), v->getString().end());
+		return 's';
+	}
+
+	ValueVector* vv = CLEVER_GET_ARRAY(v);
+	bool ints = v->getTypePtr() == CLEVER_TPL_ARRAY(CLEVER_INT);
+
+	data.resize(vv->size() * 8);
+
+	for (size_t i = 0; i < vv->size(); ++i) {
+		if (ints) {
+			int64_t e = vv->at(i)->getInteger();
+			memcpy(&data[i * 8], &e, 8);
+		} else {
+			double e = vv->at(i)->getDouble();
+			memcpy(&data[i * 8], &e, 8);
+		}
+	}
+
+	return ints ? 'i' : 'd';
+}
+
+/**
+ * Returns the result of a collective in retval, as a single value or
+ * as an array of its elements
+ */
+static void unpack_result(Value* retval, int type, bool array,
+		const ::std::vector<char>& data) {
+	if (type == 's') {
+		CLEVER_RETURN_STR(CSTRING(::std::string(data.begin(), data.end())));
+		return;
+	}
+
+	if (!array) {
+		if (data.size() < 8) {
+			clever_fatal("[RPC] Empty collective result!");
+		}
+
+		if (type == 'i') {
+			int64_t i;
+			memcpy(&i, &data[0], 8);
+			CLEVER_RETURN_INT(i);
+		} else {
+			double d;
+			memcpy(&d, &data[0], 8);
+			CLEVER_RETURN_DOUBLE(d);
+		}
+		return;
+	}
+
+	ValueVector* vv = new ValueVector;
+
+	vv->reserve(data.size() / 8);
+
+	for (size_t i = 0; i + 8 <= data.size(); i += 8) {
+		Value* v = new Value();
+
+		if (type == 'i') {
+			int64_t e;
+			memcpy(&e, &data[i], 8);
+			v->setInteger(e);
+		} else {
+			double e;
+			memcpy(&e, &data[i], 8);
+			v->setDouble(e);
+		}
+		vv->push_back(v);
+	}
+
+	retval->setTypePtr(CLEVER_TPL_ARRAY(type == 'i' ? CLEVER_INT : CLEVER_DOUBLE));
+	CLEVER_RETURN_ARRAY(vv);
+}
+
+static bool is_array(Value* v) {
+	return !v->isInteger() && !v->isDouble() && !v->isString();
+}
+
+static int reduce_operator(const CString& op) {
+	if (op == "sum") {
+		return CLEVER_RPC_SUM;
+	} else if (op == "min") {
+		return CLEVER_RPC_MIN;
+	} else if (op == "max") {
+		return CLEVER_RPC_MAX;
+	}
+
+	clever_fatal("[RPC] Unknown reduction `%S', expected sum, min or max!", &op);
+	return 0;
+}
+
+/**
+ * Void RPC::joinGroup(Int rank, Int size [, Int group])
+ */
+CLEVER_METHOD(RPC::joinGroup) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+
+	rv->joinGroup(CLEVER_ARG_INT(0), CLEVER_ARG_INT(1),
+		CLEVER_NUM_ARGS() > 2 ? CLEVER_ARG_INT(2) : 0);
+}
+
+/**
+ * Void RPC::barrier()
+ */
+CLEVER_METHOD(RPC::barrier) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	::std::vector<char> result;
+
+	rv->collective(CLEVER_RPC_BARRIER, 0, 0, 'i', NULL, 0, result);
+}
+
+/**
+ * T RPC::broadcast(T value, Int root), only the root's value is sent
+ */
+CLEVER_METHOD(RPC::broadcast) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	int root = CLEVER_ARG_INT(1);
+	::std::vector<char> data, result;
+	int type = pack_operand(CLEVER_ARG(0), data);
+
+	if (rv->getRank() != root) {
+		data.clear();
+	}
+
+	rv->collective(CLEVER_RPC_BROADCAST, root, 0, type,
+		data.empty() ? NULL : &data[0], data.size(), result);
+
+	unpack_result(retval, type, is_array(CLEVER_ARG(0)), result);
+}
+
+/**
+ * Array<T> RPC::scatter(Array<T> values, Int root), the root's values
+ * are split in equal parts, one per rank in rank order
+ */
+CLEVER_METHOD(RPC::scatter) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	int root = CLEVER_ARG_INT(1);
+	::std::vector<char> data, result;
+	int type = pack_operand(CLEVER_ARG(0), data);
+
+	if (rv->getRank() != root) {
+		data.clear();
+	}
+
+	rv->collective(CLEVER_RPC_SCATTER, root, 0, type,
+		data.empty() ? NULL : &data[0], data.size(), result);
+
+	unpack_result(retval, type, true, result);
+}
+
+/**
+ * Array<T> RPC::gather(T value, Int root), the values of every rank in
+ * rank order at the root, an empty array elsewhere
+ * Array<T> RPC::allgather(T value), the same at every rank
+ */
+CLEVER_METHOD(RPC::gather) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	bool all = CLEVER_NUM_ARGS() == 1;
+	::std::vector<char> data, result;
+	int type = pack_operand(CLEVER_ARG(0), data);
+
+	rv->collective(all ? CLEVER_RPC_ALLGATHER : CLEVER_RPC_GATHER,
+		all ? 0 : CLEVER_ARG_INT(1), 0, type,
+		data.empty() ? NULL : &data[0], data.size(), result);
+
+	unpack_result(retval, type, true, result);
+}
+
+/**
+ * T RPC::reduce(T value, String op, Int root), op is sum, min or max,
+ * applied element by element to arrays. Ranks other than the root get
+ * their own value back
+ * T RPC::allreduce(T value, String op), the result at every rank
+ */
+CLEVER_METHOD(RPC::reduce) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	bool all = CLEVER_NUM_ARGS() == 2;
+	int root = all ? 0 : CLEVER_ARG_INT(2);
+	::std::vector<char> data, result;
+	int type = pack_operand(CLEVER_ARG(0), data);
+
+	rv->collective(all ? CLEVER_RPC_ALLREDUCE : CLEVER_RPC_REDUCE, root,
+		reduce_operator(CLEVER_ARG_STR(1)), type,
+		data.empty() ? NULL : &data[0], data.size(), result);
+
+	unpack_result(retval, type, is_array(CLEVER_ARG(0)),
+		all || rv->getRank() == root ? result : data);
+}
+
+/**
+ * Map<String, Map<String, Double>> RPC::stats(), per function counters:
+ * calls, bytes in and out, and the mean, p50, p99 and max in microseconds
+ * of the round trip on a client, of the queue wait and execution time on
+ * a server
+ */
+CLEVER_METHOD(RPC::stats) {
+	RPCValue* rv = CLEVER_GET_VALUE(RPCValue*, value);
+	const TemplatedType* map = static_cast<const TemplatedType*>(CLEVER_TYPE("Map"));
+	const Type* summary_type = map->getTemplatedType(CLEVER_STR, CLEVER_DOUBLE);
+	const Type* stats_type = map->getTemplatedType(CLEVER_STR, summary_type);
+	MapValue* result = static_cast<MapValue*>(stats_type->allocateValue());
+	StatsTable stats;
+
+	rv->getStats(stats);
+
+	for (size_t i = 0; i < stats.size(); ++i) {
+		MapValue* counters = static_cast<MapValue*>(summary_type->allocateValue());
+		Value* entry = new Value(summary_type);
+		StatsSummary summary;
+
+		summarize(stats[i].second, summary);
+
+		for (size_t j = 0; j < summary.size(); ++j) {
+			counters->getMap().insert(::std::make_pair(
+				new Value(CSTRINGT(summary[j].first)), new Value(summary[j].second)));
+		}
+
+		entry->setDataValue(counters);
+		result->getMap().insert(::std::make_pair(
+			new Value(CSTRINGT(stats[i].first)), entry));
+	}
+
+	retval->setTypePtr(stats_type);
+	CLEVER_RETURN_DATA_VALUE(result);
+}
 
 void RPC::init() {
 	const Type* rpcobj = CLEVER_TYPE("RPCClass");
 	const Type* rpcobjvalue = CLEVER_TYPE("RPCObject");
+	const Type* arr_int = CLEVER_TPL_ARRAY(CLEVER_INT);
+	const Type* arr_double = CLEVER_TPL_ARRAY(CLEVER_DOUBLE);
+	const Type* future = CLEVER_TYPE("RPCFuture");
+	const Type* arr_future = CLEVER_TPL_ARRAY(future);
+	const TemplatedType* map = static_cast<const TemplatedType*>(CLEVER_TYPE("Map"));
+	const Type* stats_type = map->getTemplatedType(CLEVER_STR,
+		map->getTemplatedType(CLEVER_STR, CLEVER_DOUBLE));
 
 	addMethod(new Method(CLEVER_CTOR_NAME,
 		(MethodPtr)&RPC::constructor, rpcobj));
@@ -370,6 +724,18 @@ void RPC::init() {
 		(new Method("server", (MethodPtr)&RPC::server, CLEVER_VOID))
 			->addArg("port", CLEVER_INT)
 			->addArg("nconnections", CLEVER_INT)
+			->addArg("workers", CLEVER_INT)
+			->addArg("queue", CLEVER_INT)
+			->setMinNumArgs(2)
+	);
+
+	addMethod(
+		(new Method("server", (MethodPtr)&RPC::server, CLEVER_VOID))
+			->addArg("address", CLEVER_STR)
+			->addArg("nconnections", CLEVER_INT)
+			->addArg("workers", CLEVER_INT)
+			->addArg("queue", CLEVER_INT)
+			->setMinNumArgs(2)
 	);
 
 	addMethod(
@@ -442,6 +808,21 @@ void RPC::init() {
 			->addArg("time_sleep", CLEVER_DOUBLE)
 	);
 
+	addMethod(
+		(new Method("sendMsgValue", (MethodPtr)&RPC::sendMsgValue, CLEVER_VOID))
+			->setVariadic()
+			->setMinNumArgs(2)
+	);
+
+	addMethod(
+		(new Method("recvMsgValue", (MethodPtr)&RPC::recvMsgValue, CLEVER_BOOL))
+			->setVariadic()
+			->setMinNumArgs(3)
+			->setOutputArg(2)
+	);
+
+	addMethod(new Method("stats", (MethodPtr)&RPC::stats, stats_type));
+
 	addMethod(
 		(new Method("sendKill", (MethodPtr)&RPC::sendKill, CLEVER_VOID))
 	);
@@ -450,6 +831,14 @@ void RPC::init() {
 		(new Method("sendInit", (MethodPtr)&RPC::sendInit, CLEVER_BOOL))
 	);
 
+	addMethod(
+		(new Method("beginBatch", (MethodPtr)&RPC::beginBatch, CLEVER_VOID))
+	);
+
+	addMethod(
+		(new Method("endBatch", (MethodPtr)&RPC::endBatch, CLEVER_VOID))
+	);
+
 	addMethod(
 		(new Method("callFunction", (MethodPtr)&RPC::callFunction, rpcobjvalue))
 			->setVariadic()
@@ -468,6 +857,92 @@ void RPC::init() {
 			->addArg("time_sleep", CLEVER_DOUBLE)
 	);
 
+	addMethod(
+		(new Method("callAsync", (MethodPtr)&RPC::callAsync, future))
+			->setVariadic()
+			->setMinNumArgs(1)
+	);
+
+	addMethod(
+		(new Method("waitAny", (MethodPtr)&RPC::waitAny, CLEVER_INT))
+			->addArg("futures", arr_future)
+			->addArg("timeout", CLEVER_DOUBLE)
+			->setMinNumArgs(1)
+	);
+
+	addMethod(
+		(new Method("waitAll", (MethodPtr)&RPC::waitAll, CLEVER_BOOL))
+			->addArg("futures", arr_future)
+			->addArg("timeout", CLEVER_DOUBLE)
+			->setMinNumArgs(1)
+	);
+
+	addMethod(
+		(new Method("joinGroup", (MethodPtr)&RPC::joinGroup, CLEVER_VOID))
+			->addArg("rank", CLEVER_INT)
+			->addArg("size", CLEVER_INT)
+			->addArg("group", CLEVER_INT)
+			->setMinNumArgs(2)
+	);
+
+	addMethod(
+		(new Method("barrier", (MethodPtr)&RPC::barrier, CLEVER_VOID))
+	);
+
+	// Collectives of Int, Double and arrays of them
+	const Type* operands[] = { CLEVER_INT, CLEVER_DOUBLE, arr_int, arr_double };
+	const Type* gathered[] = { arr_int, arr_double, arr_int, arr_double };
+
+	for (size_t i = 0; i < 4; ++i) {
+		addMethod(
+			(new Method("broadcast", (MethodPtr)&RPC::broadcast, operands[i]))
+				->addArg("value", operands[i])
+				->addArg("root", CLEVER_INT)
+		);
+
+		addMethod(
+			(new Method("gather", (MethodPtr)&RPC::gather, gathered[i]))
+				->addArg("value", operands[i])
+				->addArg("root", CLEVER_INT)
+		);
+
+		addMethod(
+			(new Method("allgather", (MethodPtr)&RPC::gather, gathered[i]))
+				->addArg("value", operands[i])
+		);
+
+		addMethod(
+			(new Method("reduce", (MethodPtr)&RPC::reduce, operands[i]))
+				->addArg("value", operands[i])
+				->addArg("op", CLEVER_STR)
+				->addArg("root", CLEVER_INT)
+		);
+
+		addMethod(
+			(new Method("allreduce", (MethodPtr)&RPC::reduce, operands[i]))
+				->addArg("value", operands[i])
+				->addArg("op", CLEVER_STR)
+		);
+	}
+
+	addMethod(
+		(new Method("broadcast", (MethodPtr)&RPC::broadcast, CLEVER_STR))
+			->addArg("value", CLEVER_STR)
+			->addArg("root", CLEVER_INT)
+	);
+
+	addMethod(
+		(new Method("scatter", (MethodPtr)&RPC::scatter, arr_int))
+			->addArg("values", arr_int)
+			->addArg("root", CLEVER_INT)
+	);
+
+	addMethod(
+		(new Method("scatter", (MethodPtr)&RPC::scatter, arr_double))
+			->addArg("values", arr_double)
+			->addArg("root", CLEVER_INT)
+	);
+
 }
 
 DataValue* RPC::allocateValue() const {
@@ -30,6 +30,7 @@
 #include "compiler/value.h"
 #include "compiler/module.h"
 #include "modules/std/rpc/rpcvalue.h"
+#include "modules/std/rpc/rpcfuturevalue.h"
 
 namespace clever { namespace packages { namespace std { namespace rpc {
 
@@ -54,9 +55,14 @@ public:
 	static CLEVER_METHOD(sendInteger);
 	static CLEVER_METHOD(sendKill);
 	static CLEVER_METHOD(sendInit);
+	static CLEVER_METHOD(beginBatch);
+	static CLEVER_METHOD(endBatch);
 	static CLEVER_METHOD(callFunction);
 	static CLEVER_METHOD(callProcess);
 	static CLEVER_METHOD(waitResult);
+	static CLEVER_METHOD(callAsync);
+	static CLEVER_METHOD(waitAny);
+	static CLEVER_METHOD(waitAll);
 
 	static CLEVER_METHOD(sendMsgInt);
 	static CLEVER_METHOD(recvMsgInt);
@@ -70,6 +76,18 @@ public:
 	static CLEVER_METHOD(sendMsgObject);
 	static CLEVER_METHOD(recvMsgObject);
 
+	static CLEVER_METHOD(sendMsgValue);
+	static CLEVER_METHOD(recvMsgValue);
+
+	static CLEVER_METHOD(joinGroup);
+	static CLEVER_METHOD(barrier);
+	static CLEVER_METHOD(broadcast);
+	static CLEVER_METHOD(scatter);
+	static CLEVER_METHOD(gather);
+	static CLEVER_METHOD(reduce);
+
+	static CLEVER_METHOD(stats);
+
 	~RPC(){}
 private:
 	DISALLOW_COPY_AND_ASSIGN(RPC);
@@ -0,0 +1,134 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "compiler/compiler.h"
+#include "compiler/cstring.h"
+#include "modules/std/rpc/rpc.h"
+#include "modules/std/rpc/rpcfuture.h"
+#include "types/nativetypes.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+/**
+ * RPCFuture::constructor()
+ */
+CLEVER_METHOD(RPCFuture::constructor) {
+	RPCFutureValue* fv = new RPCFutureValue;
+
+	CLEVER_RETURN_DATA_VALUE(fv);
+}
+
+/**
+ * Void RPCFuture::operator=(RPCFuture future)
+ */
+CLEVER_METHOD(RPCFuture::do_assign) {
+	CLEVER_THIS()->copy(CLEVER_ARG(0));
+}
+
+/**
+ * Bool RPCFuture::ready(), whether get() would return at once
+ */
+CLEVER_METHOD(RPCFuture::ready) {
+	RPCFutureValue* fv = CLEVER_GET_VALUE(RPCFutureValue*, value);
+
+	CLEVER_RETURN_BOOL(fv->result
+		|| (fv->client && fv->client->replyReady(fv->id)));
+}
+
+/**
+ * Bool RPCFuture::wait([Double timeout]), waits up to timeout seconds,
+ * or without limit, for the result. Returns whether it arrived
+ */
+CLEVER_METHOD(RPCFuture::wait) {
+	RPCFutureValue* fv = CLEVER_GET_VALUE(RPCFutureValue*, value);
+	double timeout = args ? CLEVER_ARG_DOUBLE(0) : -1;
+
+	if (fv->result || fv->client == NULL) {
+		CLEVER_RETURN_BOOL(fv->result != NULL);
+		return;
+	}
+
+	CLEVER_RETURN_BOOL(fv->client->waitReplies(
+		::std::vector<int>(1, fv->id), true, timeout) == 0);
+}
+
+/**
+ * RPCObject RPCFuture::get(), waits for the result and returns it
+ */
+CLEVER_METHOD(RPCFuture::get) {
+	RPCFutureValue* fv = CLEVER_GET_VALUE(RPCFutureValue*, value);
+
+	if (fv->client == NULL) {
+		clever_fatal("[RPC] RPCFuture was not returned by callAsync()!");
+	}
+
+	if (fv->result == NULL) {
+		fv->result = fv->client->receiveResult(fv->id);
+	}
+
+	fv->result->addRef();
+
+	CLEVER_RETURN_DATA_VALUE(fv->result);
+}
+
+void RPCFuture::init() {
+	const Type* future = CLEVER_TYPE("RPCFuture");
+	const Type* rpcobjvalue = CLEVER_TYPE("RPCObject");
+
+	addMethod(new Method(CLEVER_CTOR_NAME,
+		(MethodPtr)&RPCFuture::constructor, future));
+
+	addMethod(
+		(new Method(CLEVER_OPERATOR_ASSIGN, (MethodPtr)&RPCFuture::do_assign,
+			future, false))
+			->addArg("rvalue", future)
+	);
+
+	addMethod(
+		(new Method("ready", (MethodPtr)&RPCFuture::ready, CLEVER_BOOL))
+	);
+
+	addMethod(
+		(new Method("wait", (MethodPtr)&RPCFuture::wait, CLEVER_BOOL))
+	);
+
+	addMethod(
+		(new Method("wait", (MethodPtr)&RPCFuture::wait, CLEVER_BOOL))
+			->addArg("timeout", CLEVER_DOUBLE)
+	);
+
+	addMethod(
+		(new Method("get", (MethodPtr)&RPCFuture::get, rpcobjvalue))
+	);
+}
+
+DataValue* RPCFuture::allocateValue() const {
+	return new RPCFutureValue;
+}
+
+void RPCFuture::destructor(Value* value) const {
+}
+
+}}}} // clever::packages::std::rpc
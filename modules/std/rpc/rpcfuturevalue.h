@@ -0,0 +1,68 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_RPCFUTUREVALUE_H
+#define CLEVER_RPCFUTUREVALUE_H
+
+#include "compiler/datavalue.h"
+
+#include "modules/std/rpc/rpcvalue.h"
+#include "modules/std/rpc/rpcobjectvalue.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+/**
+ * Result of a call made by RPC::callAsync()
+ */
+class RPCFutureValue : public DataValue {
+public:
+	RPCFutureValue() : client(NULL), id(0), result(NULL) {}
+
+	~RPCFutureValue() {
+		if (client) {
+			if (result == NULL) {
+				client->discardReply(id);
+			}
+			client->delRef();
+		}
+		if (result) {
+			result->delRef();
+		}
+	}
+
+	bool valid() const {
+		return client != NULL;
+	}
+
+	// The connection the call went out on, and the id of the request
+	RPCValue* client;
+	int id;
+	// Set once get() took the result from the connection
+	RPCObjectValue* result;
+};
+
+}}}} // clever::packages::std::rpc
+
+#endif // CLEVER_RPCFUTUREVALUE_H
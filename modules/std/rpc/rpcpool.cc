@@ -0,0 +1,129 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include "modules/std/rpc/rpcpool.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+void WorkerPool::start(size_t nthreads, size_t capacity) {
+	if (m_threads) {
+		return;
+	}
+
+	if (nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = ncpus > 0 ? ncpus : 1;
+	}
+
+	m_nthreads = nthreads;
+	m_ring.assign(capacity ? capacity : 1, Task());
+	m_head = m_count = 0;
+	m_stop = false;
+	m_threads = new pthread_t[m_nthreads];
+
+	for (size_t i = 0; i < m_nthreads; ++i) {
+		pthread_create(&m_threads[i], NULL, &WorkerPool::worker, this);
+	}
+}
+
+bool WorkerPool::tryPush(WorkerJob job, void* arg) {
+	m_mutex.lock();
+
+	if (m_count == m_ring.size()) {
+		m_mutex.unlock();
+		return false;
+	}
+
+	m_ring[(m_head + m_count) % m_ring.size()] = Task(job, arg);
+	++m_count;
+
+	m_not_empty.signal();
+
+	m_mutex.unlock();
+
+	return true;
+}
+
+void WorkerPool::stop() {
+	if (m_threads == NULL) {
+		return;
+	}
+
+	m_mutex.lock();
+	m_stop = true;
+	m_not_empty.broadcast();
+	m_mutex.unlock();
+
+	for (size_t i = 0; i < m_nthreads; ++i) {
+		pthread_join(m_threads[i], NULL);
+	}
+
+	delete[] m_threads;
+
+	m_threads = NULL;
+	m_nthreads = 0;
+}
+
+void* WorkerPool::worker(void* pool) {
+	static_cast<WorkerPool*>(pool)->run();
+
+	return NULL;
+}
+
+void WorkerPool::run() {
+	while (true) {
+		m_mutex.lock();
+
+		while (m_count == 0 && !m_stop) {
+			m_not_empty.wait(m_mutex);
+		}
+
+		if (m_count == 0) {
+			m_mutex.unlock();
+			return;
+		}
+
+		Task task = m_ring[m_head];
+		bool was_full = m_count == m_ring.size();
+
+		m_head = (m_head + 1) % m_ring.size();
+		--m_count;
+
+		m_mutex.unlock();
+
+		if (was_full && m_wakeup >= 0) {
+			char byte = 0;
+			ssize_t res = write(m_wakeup, &byte, 1);
+
+			(void) res;
+		}
+
+		task.job(task.arg);
+	}
+}
+
+}}}} // clever::packages::std::rpc
@@ -0,0 +1,106 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_RPCPOOL_H
+#define CLEVER_RPCPOOL_H
+
+#include <vector>
+#include <pthread.h>
+#include "modules/std/rpc/rpcsync.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+typedef void (*WorkerJob)(void*);
+
+/**
+ * Fixed set of threads running jobs taken from a bounded FIFO queue
+ */
+class WorkerPool {
+
+public:
+	WorkerPool()
+		: m_threads(NULL), m_nthreads(0), m_head(0), m_count(0),
+			m_stop(false), m_wakeup(-1) {}
+
+	~WorkerPool() {
+		stop();
+	}
+
+	/**
+	 * Starts nthreads workers (one per CPU when 0), at most capacity
+	 * jobs can wait in the queue
+	 */
+	void start(size_t nthreads, size_t capacity);
+
+	/**
+	 * Queues a job, returns false without blocking when the queue is full
+	 */
+	bool tryPush(WorkerJob job, void* arg);
+
+	/**
+	 * Lets the workers drain the queue and joins them
+	 */
+	void stop();
+
+	/**
+	 * A byte is written to fd whenever a job leaves a full queue, so
+	 * a producer turned away by tryPush() knows when to retry
+	 */
+	void setWakeup(int fd) { m_wakeup = fd; }
+
+	size_t size() const { return m_nthreads; }
+
+private:
+	struct Task {
+		Task(WorkerJob job=NULL, void* arg=NULL) : job(job), arg(arg) {}
+
+		WorkerJob job;
+		void* arg;
+	};
+
+	static void* worker(void* pool);
+
+	void run();
+
+	pthread_t* m_threads;
+	size_t m_nthreads;
+
+	// Ring buffer of m_count jobs starting at m_head
+	::std::vector<Task> m_ring;
+	size_t m_head;
+	size_t m_count;
+
+	bool m_stop;
+	int m_wakeup;
+
+	Mutex m_mutex;
+	Condition m_not_empty;
+
+	DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}}}} // clever::packages::std::rpc
+
+#endif // CLEVER_RPCPOOL_H
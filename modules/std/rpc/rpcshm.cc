@@ -0,0 +1,493 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+#include "modules/std/rpc/rpcshm.h"
+
+// Marks a segment whose header is initialized
+#define CLEVER_RPC_SHM_MAGIC 0x52505343
+// Milliseconds between checks that the other end is still there
+#define CLEVER_RPC_SHM_POLL 100
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+static void futex_wait(volatile unsigned int* addr, unsigned int value, int timeout) {
+#ifdef __linux__
+	struct timespec ts;
+
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000L;
+
+	syscall(SYS_futex, const_cast<unsigned int*>(addr), FUTEX_WAIT, value, &ts, NULL, 0);
+#else
+	if (*addr == value) {
+		usleep(100);
+	}
+#endif
+}
+
+static void futex_wake(volatile unsigned int* addr) {
+#ifdef __linux__
+	syscall(SYS_futex, const_cast<unsigned int*>(addr), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+static bool process_alive(int pid) {
+	// A pid not published yet counts as alive
+	return pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+static ::std::string shm_path(const char* name) {
+	return ::std::string("/clever-rpc-") + name;
+}
+
+static void ring_bell(ShmHeader* header) {
+	__sync_fetch_and_add(&header->doorbell, 1);
+	__sync_synchronize();
+
+	if (header->bell_waiting) {
+		futex_wake(&header->doorbell);
+	}
+}
+
+void ShmRing::reset() {
+	head = tail = 0;
+	reader_waiting = writer_waiting = 0;
+}
+
+size_t ShmRing::peek(const char** buffer) const {
+	unsigned int t = tail;
+	size_t n = head - t;
+	size_t offset = t % CLEVER_RPC_SHM_RING;
+
+	// The bytes are read only after head said they are there
+	__sync_synchronize();
+
+	if (n > CLEVER_RPC_SHM_RING - offset) {
+		n = CLEVER_RPC_SHM_RING - offset;
+	}
+
+	*buffer = data + offset;
+
+	return n;
+}
+
+void ShmRing::consume(size_t n) {
+	__sync_synchronize();
+	tail += n;
+	__sync_synchronize();
+
+	if (writer_waiting) {
+		futex_wake(&tail);
+	}
+}
+
+size_t ShmRing::write(const char* buffer, size_t n) {
+	unsigned int h = head;
+	size_t space = CLEVER_RPC_SHM_RING - (h - tail);
+	size_t offset = h % CLEVER_RPC_SHM_RING;
+
+	__sync_synchronize();
+
+	if (n > space) {
+		n = space;
+	}
+
+	size_t first = n < CLEVER_RPC_SHM_RING - offset ? n : CLEVER_RPC_SHM_RING - offset;
+
+	memcpy(data + offset, buffer, first);
+	memcpy(data, buffer + first, n - first);
+
+	// Publish the bytes before the new head
+	__sync_synchronize();
+	head = h + n;
+	__sync_synchronize();
+
+	if (n > 0 && reader_waiting) {
+		futex_wake(&head);
+	}
+
+	return n;
+}
+
+size_t ShmRing::read(char* buffer, size_t n) {
+	size_t done = 0;
+
+	// Twice at most, when the buffered bytes wrap
+	while (done < n) {
+		const char* p;
+		size_t available = peek(&p);
+
+		if (available == 0) {
+			break;
+		}
+		if (available > n - done) {
+			available = n - done;
+		}
+
+		memcpy(buffer + done, p, available);
+		consume(available);
+		done += available;
+	}
+
+	return done;
+}
+
+void ShmRing::waitReadable(int timeout) {
+	unsigned int h = head;
+
+	reader_waiting = 1;
+	__sync_synchronize();
+
+	if (h == tail) {
+		futex_wait(&head, h, timeout);
+	}
+
+	reader_waiting = 0;
+}
+
+void ShmRing::waitWritable(int timeout) {
+	unsigned int t = tail;
+
+	writer_waiting = 1;
+	__sync_synchronize();
+
+	if (head - t == CLEVER_RPC_SHM_RING) {
+		futex_wait(&tail, t, timeout);
+	}
+
+	writer_waiting = 0;
+}
+
+bool shm_peer_alive(const ShmSlot* slot, int peer_pid) {
+	int state = slot->state;
+
+	return (state == SHM_OPEN || state == SHM_CONNECTING) && process_alive(peer_pid);
+}
+
+/**
+ * Writes every buffer to the ring, sleeping while it is full. The
+ * client rings the server's doorbell (bell) once the data is there
+ */
+static bool shm_writev(ShmSlot* slot, ShmRing& ring, const struct iovec* iov,
+		int n, int peer_pid, ShmHeader* bell) {
+	for (int i = 0; i < n; ++i) {
+		const char* p = static_cast<const char*>(iov[i].iov_base);
+		size_t left = iov[i].iov_len;
+
+		while (left > 0) {
+			size_t written = ring.write(p, left);
+
+			if (written > 0) {
+				p += written;
+				left -= written;
+				continue;
+			}
+
+			// Full: let the reader drain it
+			if (bell) {
+				ring_bell(bell);
+			}
+			if (!shm_peer_alive(slot, peer_pid)) {
+				return false;
+			}
+			ring.waitWritable(CLEVER_RPC_SHM_POLL);
+		}
+	}
+
+	if (bell) {
+		ring_bell(bell);
+	}
+
+	return true;
+}
+
+void shm_release(ShmSlot* slot) {
+	if (process_alive(slot->client_pid)
+		&& __sync_bool_compare_and_swap(&slot->state, SHM_OPEN, SHM_DROPPED)) {
+		// The client frees it when it detaches
+		return;
+	}
+
+	slot->request.reset();
+	slot->reply.reset();
+	slot->client_pid = 0;
+
+	__sync_synchronize();
+	slot->state = SHM_FREE;
+}
+
+bool ShmServer::create(const char* name, int nslots) {
+	if (nslots < 1) {
+		nslots = 1;
+	}
+
+	m_name = shm_path(name);
+	m_size = sizeof(ShmHeader) + nslots * sizeof(ShmSlot);
+
+	// Left behind by a server that did not shut down
+	shm_unlink(m_name.c_str());
+
+	int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	void* p = MAP_FAILED;
+
+	if (ftruncate(fd, m_size) == 0) {
+		p = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	::close(fd);
+
+	if (p == MAP_FAILED) {
+		shm_unlink(m_name.c_str());
+		return false;
+	}
+
+	// The pages come zeroed, every slot starts SHM_FREE
+	m_header = static_cast<ShmHeader*>(p);
+	m_header->ring_size = CLEVER_RPC_SHM_RING;
+	m_header->nslots = nslots;
+	m_header->server_pid = getpid();
+
+	__sync_synchronize();
+	m_header->magic = CLEVER_RPC_SHM_MAGIC;
+
+	return true;
+}
+
+ShmSlot* ShmServer::slot(int i) const {
+	return reinterpret_cast<ShmSlot*>(m_header + 1) + i;
+}
+
+void ShmServer::start(int fd) {
+	m_notify = fd;
+	m_running = true;
+
+	pthread_create(&m_thread, NULL, &ShmServer::bell, this);
+}
+
+void* ShmServer::bell(void* server) {
+	ShmServer* self = static_cast<ShmServer*>(server);
+	ShmHeader* header = self->m_header;
+	unsigned int seen = header->doorbell;
+	char byte = 0;
+
+	while (self->m_running) {
+		header->bell_waiting = 1;
+		__sync_synchronize();
+
+		if (header->doorbell == seen) {
+			futex_wait(&header->doorbell, seen, 1000);
+		}
+
+		header->bell_waiting = 0;
+		seen = header->doorbell;
+
+		ssize_t res = write(self->m_notify, &byte, 1);
+
+		(void) res;
+	}
+
+	return NULL;
+}
+
+void ShmServer::destroy() {
+	if (m_header == NULL) {
+		return;
+	}
+
+	if (m_running) {
+		m_running = false;
+		ring_bell(m_header);
+		pthread_join(m_thread, NULL);
+	}
+
+	// Clients still attached see the server gone
+	for (int i = 0; i < m_header->nslots; ++i) {
+		ShmSlot* s = slot(i);
+
+		if (!__sync_bool_compare_and_swap(&s->state, SHM_OPEN, SHM_DROPPED)) {
+			__sync_bool_compare_and_swap(&s->state, SHM_CONNECTING, SHM_DROPPED);
+		}
+	}
+
+	munmap(m_header, m_size);
+	shm_unlink(m_name.c_str());
+
+	m_header = NULL;
+}
+
+bool ShmClient::connect(const char* name) {
+	int fd = shm_open(shm_path(name).c_str(), O_RDWR, 0);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	void* p = MAP_FAILED;
+
+	if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(ShmHeader)) {
+		p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	::close(fd);
+
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	m_header = static_cast<ShmHeader*>(p);
+	m_size = st.st_size;
+
+	if (m_header->magic != CLEVER_RPC_SHM_MAGIC
+		|| m_header->ring_size != CLEVER_RPC_SHM_RING
+		|| m_size < sizeof(ShmHeader) + m_header->nslots * sizeof(ShmSlot)
+		|| !process_alive(m_header->server_pid)) {
+		close();
+		return false;
+	}
+
+	ShmSlot* slots = reinterpret_cast<ShmSlot*>(m_header + 1);
+
+	for (int i = 0; i < m_header->nslots; ++i) {
+		if (__sync_bool_compare_and_swap(&slots[i].state, SHM_FREE, SHM_CONNECTING)) {
+			slots[i].client_pid = getpid();
+			m_slot = &slots[i];
+
+			ring_bell(m_header);
+			return true;
+		}
+	}
+
+	// Every slot is taken
+	close();
+	return false;
+}
+
+void ShmClient::close() {
+	if (m_slot) {
+		if (!__sync_bool_compare_and_swap(&m_slot->state, SHM_OPEN, SHM_CLOSED)
+			&& !__sync_bool_compare_and_swap(&m_slot->state, SHM_CONNECTING, SHM_CLOSED)) {
+			// The server let go already
+			m_slot->request.reset();
+			m_slot->reply.reset();
+			m_slot->client_pid = 0;
+
+			__sync_synchronize();
+			m_slot->state = SHM_FREE;
+		}
+
+		ring_bell(m_header);
+		m_slot = NULL;
+	}
+
+	if (m_header) {
+		munmap(m_header, m_size);
+		m_header = NULL;
+	}
+}
+
+bool ShmClient::sendv(const struct iovec* iov, int n) {
+	return m_slot && shm_writev(m_slot, m_slot->request, iov, n,
+		m_header->server_pid, m_header);
+}
+
+bool ShmClient::send(const char* buffer, int length) {
+	struct iovec iov;
+
+	iov.iov_base = const_cast<char*>(buffer);
+	iov.iov_len = length;
+
+	return sendv(&iov, 1);
+}
+
+bool ShmClient::receiveAll(char* buffer, int length) {
+	size_t done = 0;
+
+	if (m_slot == NULL) {
+		return false;
+	}
+
+	while (done < (size_t) length) {
+		if (m_interrupted) {
+			return false;
+		}
+
+		size_t n = m_slot->reply.read(buffer + done, length - done);
+
+		if (n > 0) {
+			// The server has replies that did not fit, there is room now
+			if (m_slot->reply.writer_waiting) {
+				ring_bell(m_header);
+			}
+
+			done += n;
+			continue;
+		}
+
+		if (!shm_peer_alive(m_slot, m_header->server_pid)) {
+			// What the server wrote before leaving is still readable
+			n = m_slot->reply.read(buffer + done, length - done);
+
+			if (n == 0) {
+				return false;
+			}
+
+			done += n;
+			continue;
+		}
+
+		m_slot->reply.waitReadable(CLEVER_RPC_SHM_POLL);
+	}
+
+	return true;
+}
+
+void ShmClient::interrupt() {
+	m_interrupted = true;
+	__sync_synchronize();
+
+	if (m_slot) {
+		futex_wake(&m_slot->reply.head);
+	}
+}
+
+}}}} // clever::packages::std::rpc
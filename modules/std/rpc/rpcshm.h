@@ -0,0 +1,215 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_RPCSHM_H
+#define CLEVER_RPCSHM_H
+
+#include <cstddef>
+#include <string>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "compiler/clever.h"
+
+// Address prefix selecting the shared memory transport
+#define CLEVER_RPC_SHM_PREFIX "shm://"
+// Bytes buffered in each direction of a shared memory connection
+#define CLEVER_RPC_SHM_RING (1 << 20)
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+/**
+ * Byte ring in shared memory with one writer and one reader. head and
+ * tail count the bytes written and read, their difference is what is
+ * buffered. A side about to sleep raises its waiting flag so the other
+ * side only makes the wake up call when it is needed. The server never
+ * sleeps on a reply ring, it raises writer_waiting while it has replies
+ * queued and the client rings the doorbell when it reads
+ */
+struct ShmRing {
+	volatile unsigned int head;
+	volatile unsigned int tail;
+	volatile int reader_waiting;
+	volatile int writer_waiting;
+	char data[CLEVER_RPC_SHM_RING];
+
+	void reset();
+
+	size_t buffered() const { return head - tail; }
+
+	/**
+	 * Points data at the bytes that can be read without wrapping and
+	 * returns how many they are
+	 */
+	size_t peek(const char** data) const;
+	void consume(size_t n);
+
+	/**
+	 * Copies as much as fits (or is buffered), never blocks
+	 */
+	size_t write(const char* buffer, size_t n);
+	size_t read(char* buffer, size_t n);
+
+	/**
+	 * Sleeps until the reader (or writer) made progress or the timeout
+	 * in milliseconds expires
+	 */
+	void waitReadable(int timeout);
+	void waitWritable(int timeout);
+};
+
+enum ShmSlotState {
+	SHM_FREE,
+	// Claimed by a client, not seen by the server yet
+	SHM_CONNECTING,
+	SHM_OPEN,
+	// The client detached, the server still has to let go
+	SHM_CLOSED,
+	// The server let go, the client still has to detach
+	SHM_DROPPED
+};
+
+/**
+ * Connection of one client: its requests and the server's replies
+ */
+struct ShmSlot {
+	volatile int state;
+	volatile int client_pid;
+	ShmRing request;
+	ShmRing reply;
+};
+
+/**
+ * Start of the segment, the slots follow it
+ */
+struct ShmHeader {
+	int magic;
+	int ring_size;
+	int nslots;
+	volatile int server_pid;
+	// Bumped by a client whenever it wrote to its request ring
+	volatile unsigned int doorbell;
+	volatile int bell_waiting;
+};
+
+/**
+ * Writes every buffer to the ring, sleeping while it is full. Fails
+ * when the connection is closed or the process at the other end died
+ */
+bool shm_writev(ShmSlot* slot, ShmRing& ring, const struct iovec* iov, int n, int peer_pid);
+
+/**
+ * Whether the slot is still connected and the peer process alive
+ */
+bool shm_peer_alive(const ShmSlot* slot, int peer_pid);
+
+/**
+ * The server's end of a shared memory connection lets go of it
+ */
+void shm_release(ShmSlot* slot);
+
+/**
+ * Segment serving the shared memory clients of one server. A thread
+ * turns the clients' doorbell into a byte written to a descriptor the
+ * server reactor polls, so these connections share the TCP loop
+ */
+class ShmServer {
+
+public:
+	ShmServer()
+		: m_header(NULL), m_size(0), m_notify(-1), m_running(false) {}
+
+	~ShmServer() {
+		destroy();
+	}
+
+	bool create(const char* name, int nslots);
+
+	/**
+	 * Starts writing to fd when clients ring, and at least once a second
+	 * so that clients that died are noticed
+	 */
+	void start(int fd);
+
+	void destroy();
+
+	int slots() const { return m_header ? m_header->nslots : 0; }
+	ShmSlot* slot(int i) const;
+
+private:
+	static void* bell(void* server);
+
+	ShmHeader* m_header;
+	size_t m_size;
+	::std::string m_name;
+
+	int m_notify;
+	volatile bool m_running;
+	pthread_t m_thread;
+
+	DISALLOW_COPY_AND_ASSIGN(ShmServer);
+};
+
+/**
+ * A client's end of a shared memory connection, with the subset of the
+ * CSocket interface RPCValue uses
+ */
+class ShmClient {
+
+public:
+	ShmClient()
+		: m_header(NULL), m_size(0), m_slot(NULL), m_interrupted(false) {}
+
+	~ShmClient() {
+		close();
+	}
+
+	/**
+	 * Attaches to the segment of a running server and claims a slot
+	 */
+	bool connect(const char* name);
+	void close();
+
+	bool sendv(const struct iovec* iov, int n);
+	bool send(const char* buffer, int length);
+	bool receiveAll(char* buffer, int length);
+
+	/**
+	 * Makes receiveAll() fail from now on, a thread blocked in it
+	 * returns
+	 */
+	void interrupt();
+
+private:
+	ShmHeader* m_header;
+	size_t m_size;
+	ShmSlot* m_slot;
+	volatile bool m_interrupted;
+
+	DISALLOW_COPY_AND_ASSIGN(ShmClient);
+};
+
+}}}} // clever::packages::std::rpc
+
+#endif // CLEVER_RPCSHM_H
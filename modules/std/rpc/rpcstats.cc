@@ -0,0 +1,202 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include "modules/std/rpc/rpcstats.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+uint64_t monotonic_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+LatencyHistogram::LatencyHistogram()
+	: m_count(0), m_total(0), m_max(0) {
+	memset(m_counts, 0, sizeof(m_counts));
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+	if (value < SUB_BUCKETS) {
+		return value;
+	}
+
+	int exp = 63 - __builtin_clzll(value);
+	size_t sub = (value >> (exp - SUB_BITS)) - SUB_BUCKETS;
+
+	return (exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::highestOf(size_t bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+
+	int shift = bucket / SUB_BUCKETS - 1;
+	uint64_t lowest = uint64_t(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+
+	return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+	++m_counts[bucketOf(value)];
+	++m_count;
+	m_total += value;
+
+	if (value > m_max) {
+		m_max = value;
+	}
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		m_counts[i] += other.m_counts[i];
+	}
+
+	m_count += other.m_count;
+	m_total += other.m_total;
+
+	if (other.m_max > m_max) {
+		m_max = other.m_max;
+	}
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+	if (m_count == 0) {
+		return 0;
+	}
+
+	uint64_t rank = uint64_t(::ceil(p / 100.0 * m_count));
+	uint64_t seen = 0;
+
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		seen += m_counts[i];
+
+		if (seen >= rank) {
+			uint64_t value = highestOf(i);
+
+			return value < m_max ? value : m_max;
+		}
+	}
+
+	return m_max;
+}
+
+static void summarize_histogram(const char* name, const LatencyHistogram& h,
+		StatsSummary& summary) {
+	if (h.count() == 0) {
+		return;
+	}
+
+	::std::string prefix(name);
+
+	summary.push_back(::std::make_pair(prefix + "_mean_us",
+		h.total() / 1e3 / h.count()));
+	summary.push_back(::std::make_pair(prefix + "_p50_us", h.percentile(50) / 1e3));
+	summary.push_back(::std::make_pair(prefix + "_p99_us", h.percentile(99) / 1e3));
+	summary.push_back(::std::make_pair(prefix + "_max_us", h.max() / 1e3));
+}
+
+void summarize(const CallCounters& counters, StatsSummary& summary) {
+	summary.push_back(::std::make_pair(::std::string("calls"), double(counters.calls)));
+	summary.push_back(::std::make_pair(::std::string("bytes_in"), double(counters.bytes_in)));
+	summary.push_back(::std::make_pair(::std::string("bytes_out"), double(counters.bytes_out)));
+
+	summarize_histogram("queue_wait", counters.queue_wait, summary);
+	summarize_histogram("exec", counters.exec, summary);
+	summarize_histogram("latency", counters.latency, summary);
+}
+
+void dump_stats(const char* title, const StatsTable& stats) {
+	bool any = false;
+
+	for (size_t i = 0; i < stats.size(); ++i) {
+		if (stats[i].second.calls == 0) {
+			continue;
+		}
+
+		if (!any) {
+			fprintf(stderr, "%s\n", title);
+			any = true;
+		}
+
+		StatsSummary summary;
+
+		summarize(stats[i].second, summary);
+
+		fprintf(stderr, "  %s:", stats[i].first.c_str());
+
+		for (size_t j = 0; j < summary.size(); ++j) {
+			fprintf(stderr, " %s=%.*f", summary[j].first.c_str(),
+				j < 3 ? 0 : 1, summary[j].second);
+		}
+		fprintf(stderr, "\n");
+	}
+}
+
+void CallStats::recordCall(size_t bytes_in, size_t bytes_out, uint64_t queue_ns,
+		uint64_t exec_ns) {
+	m_mutex.lock();
+	++m_counters.calls;
+	m_counters.bytes_in += bytes_in;
+	m_counters.bytes_out += bytes_out;
+	m_counters.queue_wait.record(queue_ns);
+	m_counters.exec.record(exec_ns);
+	m_mutex.unlock();
+}
+
+void CallStats::recordRequest(size_t bytes_out) {
+	m_mutex.lock();
+	++m_counters.calls;
+	m_counters.bytes_out += bytes_out;
+	m_mutex.unlock();
+}
+
+void CallStats::recordReply(size_t bytes_in, uint64_t latency_ns) {
+	m_mutex.lock();
+	m_counters.bytes_in += bytes_in;
+	m_counters.latency.record(latency_ns);
+	m_mutex.unlock();
+}
+
+CallCounters CallStats::snapshot() {
+	m_mutex.lock();
+	CallCounters counters = m_counters;
+	m_mutex.unlock();
+
+	return counters;
+}
+
+}}}} // clever::packages::std::rpc
@@ -0,0 +1,135 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_RPCSTATS_H
+#define CLEVER_RPCSTATS_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "modules/std/rpc/rpcsync.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+/**
+ * Nanoseconds from a fixed point, for measuring intervals
+ */
+uint64_t monotonic_ns();
+
+/**
+ * Latency histogram with HDR-style buckets: values are grouped by their
+ * power of two and each group is split in 16 linear buckets, so every
+ * value is recorded with at most 1/16 of error whatever its magnitude
+ */
+class LatencyHistogram {
+public:
+	enum {
+		SUB_BITS = 4,
+		SUB_BUCKETS = 1 << SUB_BITS,
+		BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS
+	};
+
+	LatencyHistogram();
+
+	void record(uint64_t value);
+	void merge(const LatencyHistogram& other);
+
+	uint64_t count() const { return m_count; }
+	uint64_t total() const { return m_total; }
+	uint64_t max() const { return m_max; }
+
+	/**
+	 * Highest value of the bucket holding the given percentile
+	 */
+	uint64_t percentile(double p) const;
+private:
+	static size_t bucketOf(uint64_t value);
+	static uint64_t highestOf(size_t bucket);
+
+	uint64_t m_counts[BUCKETS];
+	uint64_t m_count;
+	uint64_t m_total;
+	uint64_t m_max;
+};
+
+/**
+ * What a side of the connection measured for a function. A server
+ * fills the queue wait and the execution time, a client the round trip
+ * of its calls. Bytes are those of the request and reply bodies, without
+ * framing, from the side's point of view
+ */
+struct CallCounters {
+	CallCounters()
+		: calls(0), bytes_in(0), bytes_out(0) {}
+
+	uint64_t calls;
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	LatencyHistogram queue_wait;
+	LatencyHistogram exec;
+	LatencyHistogram latency;
+};
+
+typedef ::std::vector< ::std::pair< ::std::string, double> > StatsSummary;
+typedef ::std::vector< ::std::pair< ::std::string, CallCounters> > StatsTable;
+
+/**
+ * The counters as (name, value) pairs, times in microseconds; the
+ * histograms nothing was recorded in are left out
+ */
+void summarize(const CallCounters& counters, StatsSummary& summary);
+
+/**
+ * Writes the summary of each function to stderr
+ */
+void dump_stats(const char* title, const StatsTable& stats);
+
+/**
+ * Counters of a function shared by several threads
+ */
+class CallStats {
+public:
+	CallStats() {}
+
+	/* Server side: a call received, run and answered */
+	void recordCall(size_t bytes_in, size_t bytes_out, uint64_t queue_ns,
+		uint64_t exec_ns);
+
+	/* Client side: a call sent, and later its reply */
+	void recordRequest(size_t bytes_out);
+	void recordReply(size_t bytes_in, uint64_t latency_ns);
+
+	CallCounters snapshot();
+private:
+	Mutex m_mutex;
+	CallCounters m_counters;
+
+	DISALLOW_COPY_AND_ASSIGN(CallStats);
+};
+
+}}}} // clever::packages::std::rpc
+
+#endif // CLEVER_RPCSTATS_H
@@ -0,0 +1,120 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_RPCSYNC_H
+#define CLEVER_RPCSYNC_H
+
+#include <pthread.h>
+#include <sys/time.h>
+#include "compiler/clever.h"
+
+namespace clever { namespace packages { namespace std { namespace rpc {
+
+class Mutex {
+
+public:
+	Mutex() {
+		pthread_mutex_init (&mut, NULL);
+	}
+
+	~Mutex() {
+		pthread_mutex_destroy (&mut);
+	}
+
+	void init() {
+		pthread_mutex_init (&mut, NULL);
+	}
+
+	void lock() {
+		pthread_mutex_lock (&mut);
+	}
+
+	void unlock() {
+		pthread_mutex_unlock (&mut);
+	}
+
+private:
+	pthread_mutex_t mut;
+
+	friend class Condition;
+
+	DISALLOW_COPY_AND_ASSIGN(Mutex);
+};
+
+/**
+ * Condition variable bound to a Mutex held by the caller
+ */
+class Condition {
+
+public:
+	Condition() {
+		pthread_cond_init(&cond, NULL);
+	}
+
+	~Condition() {
+		pthread_cond_destroy(&cond);
+	}
+
+	/**
+	 * Waits until signaled or until timeout seconds have passed,
+	 * a timeout <= 0 waits without limit
+	 */
+	void wait(Mutex& m, double timeout=0) {
+		if (timeout <= 0) {
+			pthread_cond_wait(&cond, &m.mut);
+			return;
+		}
+
+		struct timeval now;
+		struct timespec abstime;
+
+		gettimeofday(&now, NULL);
+
+		long long nsec = now.tv_usec * 1000LL
+			+ (long long)((timeout - (long)timeout) * 1e9);
+
+		abstime.tv_sec = now.tv_sec + (long)timeout + nsec / 1000000000LL;
+		abstime.tv_nsec = nsec % 1000000000LL;
+
+		pthread_cond_timedwait(&cond, &m.mut, &abstime);
+	}
+
+	void signal() {
+		pthread_cond_signal(&cond);
+	}
+
+	void broadcast() {
+		pthread_cond_broadcast(&cond);
+	}
+
+private:
+	pthread_cond_t cond;
+
+	DISALLOW_COPY_AND_ASSIGN(Condition);
+};
+
+}}}} // clever::packages::std::rpc
+
+#endif // CLEVER_RPCSYNC_H
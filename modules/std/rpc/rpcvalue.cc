@@ -29,12 +29,28 @@
 #include "modules/std/rpc/rpc.h"
 #include "modules/std/rpc/rpcclass.h"
 #include "modules/std/rpc/rpcobject.h"
+#include "modules/std/rpc/rpcsync.h"
+#include "modules/std/rpc/rpcpool.h"
+#include "modules/std/rpc/rpcshm.h"
+#include "modules/std/rpc/rpcstats.h"
 #include "compiler/compiler.h"
 #include "compiler/cstring.h"
 #include "types/nativetypes.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
+#include <fcntl.h>
 #include <unistd.h>
 #include <map>
+#include <set>
+#include <vector>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+#else
+# include <poll.h>
+#endif
 
 #ifndef __APPLE__
 # include <ffi.h>
@@ -56,11 +72,44 @@ extern "C" {
 
 #ifndef CLEVER_WIN32
 	ExtMap ext_mod_map;
-	FuncMap ext_func_map;
-	FuncMap ext_ret_map;
 #endif
 
+// Sockets the server reactor reports per wakeup
+#define CLEVER_RPC_MAX_EVENTS 64
+// Bytes read from a client socket at once
+#define CLEVER_RPC_READ_CHUNK 65536
+// Calls waiting for a worker before the reactor stops reading
+#define CLEVER_RPC_QUEUE_SIZE 1024
+// Threads running callProcess() requests when the server does not say
+#define CLEVER_RPC_PROCESS_WORKERS 8
+
+// Largest frame payload accepted from a client
+#define CLEVER_RPC_MAX_FRAME (1 << 30)
+// Replies queued for a client before the reactor stops reading from it
+#define CLEVER_RPC_MAX_OUTPUT (16 << 20)
+
+/**
+ * Where a reply goes: the socket, and for framed connections the id of
+ * the request it answers
+ */
+struct ReplyTo {
+	ReplyTo(int fd=0, int id=0, bool framed=false)
+		: fd(fd), id(id), framed(framed) {}
+
+	int fd;
+	int id;
+	bool framed;
+};
+
 bool send(int m_socket, const char *buffer, int length);
+bool send_vector(int fd, struct iovec* iov, int n);
+void send_reply(const ReplyTo& to, int type, int size, const char* b);
+
+void append(::std::vector<char>& buffer, const void* data, size_t length) {
+	const char* p = static_cast<const char*>(data);
+
+	buffer.insert(buffer.end(), p, p + length);
+}
 
 ffi_type* _find_rpc_type(const char* tn) {
 	switch (tn[0]) {
@@ -75,29 +124,56 @@ ffi_type* _find_rpc_type(const char* tn) {
 	return NULL;
 }
 
-class Mutex {
+Mutex g_mutex, time_mutex;
 
-public:
-	Mutex() {}
+/**
+ * Call interface prepared for one list of argument types
+ */
+struct RPCSignature {
+	RPCSignature(const ::std::string& tags)
+		: tags(tags), types(new ffi_type*[tags.size() + 1]), next(NULL) {}
 
-	void init() {
-		pthread_mutex_init (&mut,&mattr);
+	~RPCSignature() {
+		delete[] types;
 	}
 
-	void lock() {
-		pthread_mutex_lock (&mut);
-	}
+	::std::string tags;
+	ffi_cif cif;
+	ffi_type** types;
+	RPCSignature* next;
+};
+
+/**
+ * Function registered by addFunction(), its symbol is resolved once
+ */
+struct RPCFunction {
+	RPCFunction(const char* libname, ffi_call_func symbol, char rt)
+		: libname(libname), symbol(symbol), rt(rt),
+			rtype(_find_rpc_type(&rt)), signatures(NULL) {}
+
+	~RPCFunction() {
+		while (signatures) {
+			RPCSignature* next = signatures->next;
 
-	void unlock() {
-		pthread_mutex_unlock (&mut);
+			delete signatures;
+			signatures = next;
+		}
 	}
 
-private:
-	pthread_mutex_t mut;
-	pthread_mutexattr_t mattr;
+	::std::string libname;
+	ffi_call_func symbol;
+	char rt;
+	ffi_type* rtype;
+	// Only ever prepended to, so callers can walk it without a lock
+	RPCSignature* volatile signatures;
+	// Calls served, see RPCClass::stats()
+	CallStats stats;
 };
 
-Mutex g_mutex, send_mutex, time_mutex;
+typedef ::std::map< ::std::string, RPCFunction*> FunctionTable;
+
+// Filled before the server starts and only read while it runs
+FunctionTable rpc_functions;
 
 class WaitProcess {
 
@@ -120,21 +196,19 @@ public:
 
 	void dec(){
 		mut.lock();
-		np--;
+		if (--np == 0) {
+			done.broadcast();
+		}
 		mut.unlock();
 	}
 
 	void wait(){
-		while(true) {
-
-			sleep(1);
-			
-			mut.lock();
-			int p=np;
-			mut.unlock();
-			if(p==0) return;
+		mut.lock();
+		while (np > 0) {
+			done.wait(mut);
 		}
-	} 
+		mut.unlock();
+	}
 
 
 private:
@@ -142,6 +216,7 @@ private:
 	int np;
 
 	Mutex mut;
+	Condition done;
 };
 
 class SecurePrint{
@@ -219,55 +294,76 @@ public:
 			free(ret_map[client_socket_id][id].buffer);
 		}
 		ret_map[client_socket_id][id]= RPCData(client_socket_id,type,size,b);
+
+		::std::map< ::std::pair<int,int>, ReplyTo>::iterator it =
+			pending.find(::std::make_pair(client_socket_id, id));
+
+		if (it != pending.end()) {
+			send_reply(it->second, type, size, b);
+			pending.erase(it);
+		}
 		mut.unlock();
 	}
 
-	void sendData(int client_socket_id, int id, double timeout=0.1) {
-		RPCData r;
+	/**
+	 * Sends the result of the process id, or parks the request until
+	 * insert() delivers it
+	 */
+	void sendData(const ReplyTo& to, int id) {
 		::std::map<int, ::std::map<int,RPCData> >::iterator it;
 		::std::map<int,RPCData>::iterator it2;
-		bool ok=false;
-
-		while(true){
-			mut.lock();
-			it=ret_map.find(client_socket_id);
-			if(it != ret_map.end()) {
-				it2 = it->second.find(id);
-				if(it2!=it->second.end()) {
-					r=it2->second;
-					ok=true;
-				}
-			}
-			
-			if(ok) {
-				int client_socket_id = r.client_socket_id;
-				int type = r.type;
-				char f_rt = (char) (type);
-				int size = r.size;	
-				char* b = r.buffer;
-
-				send(client_socket_id,(char*)(&type),sizeof(type));
-				if(f_rt != 'v'){
-					if(f_rt == 's' || f_rt == 'p') send(client_socket_id,(char*)(&size),sizeof(size));
-					if(size>0){
-						send(client_socket_id,b,size);
-					}
-				}
 
+		mut.lock();
+		it=ret_map.find(to.fd);
+		if(it != ret_map.end()) {
+			it2 = it->second.find(id);
+			if(it2!=it->second.end()) {
+				RPCData& r = it2->second;
+
+				send_reply(to, r.type, r.size, r.buffer);
 				mut.unlock();
 
 				return;
 			}
-			mut.unlock();
+		}
+
+		pending[::std::make_pair(to.fd, id)] = to;
+		mut.unlock();
+	}
 
-			sleep(timeout);
+	/**
+	 * Drops the results and the parked requests of a closed connection
+	 */
+	void cancel(int client_socket_id) {
+		mut.lock();
+
+		::std::map<int, ::std::map<int,RPCData> >::iterator it=ret_map.find(client_socket_id);
+
+		if (it != ret_map.end()) {
+			::std::map<int,RPCData>::iterator it2=it->second.begin(), end2=it->second.end();
+
+			while (it2!=end2) {
+				free(it2->second.buffer);
+				++it2;
+			}
+			ret_map.erase(it);
 		}
+
+		::std::map< ::std::pair<int,int>, ReplyTo>::iterator it3 =
+			pending.lower_bound(::std::make_pair(client_socket_id, INT_MIN));
+
+		while (it3 != pending.end() && it3->first.first == client_socket_id) {
+			pending.erase(it3++);
+		}
+
+		mut.unlock();
 	}
 
 
 private:
 
 	::std::map<int, ::std::map<int,RPCData> > ret_map;
+	::std::map< ::std::pair<int,int>, ReplyTo> pending;
 
 	Mutex mut;
 
@@ -302,421 +398,852 @@ public:
 			}
 		}
 		data_map[id]= RPCData(client_socket_id,type,size,b);
+
+		::std::map<int, ::std::vector<ReplyTo> >::iterator waiting=pending.find(id);
+
+		if (waiting != pending.end()) {
+			for (size_t i = 0; i < waiting->second.size(); ++i) {
+				send_reply(waiting->second[i], type, size, b);
+			}
+			pending.erase(waiting);
+		}
 		mut.unlock();
 	}
 
-	void sendData(int client_socket_id, int id, double timeout=0.1) {
-		RPCData r;
+	/**
+	 * Sends the message id, or parks the request until insert()
+	 * delivers it
+	 */
+	void sendData(const ReplyTo& to, int id) {
 		::std::map<int,RPCData>::iterator it;
-		bool ok=false;
-
-		while(true){
-			mut.lock();
-			it=data_map.find(id);
-			if(it != data_map.end()) {
-				r=it->second;
-				ok=true;
-			}
-			
-			if(ok) {
-				int type = r.type;
-				char f_rt = (char) (type);
-				int size = r.size;
-				char* b = r.buffer;
-
-				send(client_socket_id,(char*)(&type),sizeof(int));
-				if(f_rt != 'v'){
-					if(f_rt == 's' || f_rt == 'p') {
-						send(client_socket_id,(char*)(&size),sizeof(int));
-					}
 
-					if(size>0) {
-						send(client_socket_id,b,size);
-					}
-				}
-				mut.unlock();
+		mut.lock();
+		it=data_map.find(id);
+		if(it != data_map.end()) {
+			send_reply(to, it->second.type, it->second.size, it->second.buffer);
+		} else {
+			pending[id].push_back(to);
+		}
+		mut.unlock();
+	}
 
-				return;
-			}
-			mut.unlock();
+	/**
+	 * Drops the parked requests of a closed connection
+	 */
+	void cancel(int client_socket_id) {
+		::std::map<int, ::std::vector<ReplyTo> >::iterator it, end;
+
+		mut.lock();
+		it=pending.begin(), end=pending.end();
+
+		while (it != end) {
+			::std::vector<ReplyTo>& waiting = it->second;
 
-			sleep(timeout);
+			for (size_t i = waiting.size(); i-- > 0; ) {
+				if (waiting[i].fd == client_socket_id) {
+					waiting.erase(waiting.begin() + i);
+				}
+			}
 
+			if (waiting.empty()) {
+				pending.erase(it++);
+			} else {
+				++it;
+			}
 		}
+		mut.unlock();
 	}
 
 
 private:
 
 	::std::map<int, RPCData> data_map;
+	::std::map<int, ::std::vector<ReplyTo> > pending;
 
 	Mutex mut;
 
 };
 
+/**
+ * A collective operation waiting for the ranks of its group
+ */
+struct Collective {
 
-struct FCallArgs {
-
-	int len_fname;
-	char* fname;
-	int n_args;
-	int size_args;
-	char* args;
-
-	FCallArgs(int len_fname=0, char* fname=0, int n_args=0, int size_args=0, char* args=0):
-		len_fname(len_fname), fname(fname), n_args(n_args), size_args(size_args), args(args) {
+	Collective(const RPCCollectiveHeader& info)
+		: info(info), arrived(0), failed(false),
+			to(info.size), state(info.size, RANK_MISSING) {
+		if (info.op == CLEVER_RPC_GATHER || info.op == CLEVER_RPC_ALLGATHER) {
+			parts.resize(info.size);
+		}
 	}
 
-	void receive (int client_socket_id) {
-		
-		recv (client_socket_id, &len_fname, sizeof (len_fname), 0);
-		
+	enum RankState {
+		RANK_MISSING,
+		RANK_WAITING,
+		// Contributed, then closed its connection
+		RANK_GONE
+	};
+
+	// As sent by the first rank, the others must agree on it
+	RPCCollectiveHeader info;
+	int arrived;
+	bool failed;
+	::std::vector<ReplyTo> to;
+	::std::vector<char> state;
+	// The root's data, or the reduction of the contributions so far
+	::std::vector<char> data;
+	// Contributions of a gather, by rank
+	::std::vector< ::std::vector<char> > parts;
+};
 
-		g_mutex.lock();
+/**
+ * Collective operations in progress, by group and sequence number.
+ * Each rank sends its contribution once and waits for its part of the
+ * result: reductions are folded as the contributions arrive and the
+ * results go out when the last rank arrives, so a rank pays a single
+ * round trip whatever the size of the group
+ */
+class CollectiveMap {
 
-		fname = (char*) malloc ((len_fname+1)*sizeof(char));
+public:
 
-		fname[len_fname]='\0';
+	CollectiveMap() {
+		mut.init();
+	}
 
-		g_mutex.unlock();
+	void clear() {
+		ops.clear();
+	}
 
-		
-		recv (client_socket_id, fname, len_fname, 0);
-		recv (client_socket_id, &n_args, sizeof(n_args), 0);
-		
+	void contribute(const ReplyTo& to, const RPCCollectiveHeader& h, const char* data) {
+		if (!valid(h)) {
+			send_reply(to, 'v', 0, NULL);
+			return;
+		}
 
-		if(n_args>0){
-			
-			recv (client_socket_id, &size_args, sizeof(size_args), 0);
-			
+		mut.lock();
 
-			g_mutex.lock();
+		Key key(h.group, h.seq);
+		::std::map<Key, Collective>::iterator it = ops.find(key);
 
-			args = (char*) malloc(size_args*sizeof(char));
+		if (it == ops.end()) {
+			it = ops.insert(::std::make_pair(key, Collective(h))).first;
+		}
 
-			g_mutex.unlock();
+		Collective& op = it->second;
 
-			
-			recv (client_socket_id, args, size_args, 0);
-			
+		if (h.size != op.info.size || h.rank >= op.info.size
+			|| op.state[h.rank] != Collective::RANK_MISSING) {
+			mut.unlock();
+			send_reply(to, 'v', 0, NULL);
+			return;
 		}
 
+		op.to[h.rank] = to;
+		op.state[h.rank] = Collective::RANK_WAITING;
+		++op.arrived;
 
-	}
+		if (h.op != op.info.op || h.root != op.info.root
+			|| h.reduce != op.info.reduce || h.type != op.info.type) {
+			op.failed = true;
+		} else if (!op.failed) {
+			add(op, h, data);
+		}
 
-	~FCallArgs() {}
-};
+		if (op.arrived == op.info.size) {
+			finish(op);
+			ops.erase(it);
+		}
+		mut.unlock();
+	}
 
+	/**
+	 * Stops sending results to a closed connection
+	 */
+	void cancel(int client_socket_id) {
+		::std::map<Key, Collective>::iterator it, end;
 
-DataMap data_map;
-RetMap ret_map;
-SecurePrint printer;
-WaitProcess wait_process;
+		mut.lock();
+		for (it = ops.begin(), end = ops.end(); it != end; ++it) {
+			Collective& op = it->second;
 
-bool send(int m_socket, const char *buffer, int length) {
-	int sent = 0;
+			for (int i = 0; i < op.info.size; ++i) {
+				if (op.state[i] == Collective::RANK_WAITING
+					&& op.to[i].fd == client_socket_id) {
+					op.state[i] = Collective::RANK_GONE;
+				}
+			}
+		}
+		mut.unlock();
+	}
 
-	// Loop the send() because it might happen to not send all data once.
-	do {
-		send_mutex.lock();
+private:
 
-		int res = ::send(m_socket, (&buffer[sent]), (length - sent), 0);
+	typedef ::std::pair<int, int> Key;
 
-		send_mutex.unlock();
+	static size_t element_size(int type) {
+		return type == 's' ? 1 : 8;
+	}
 
-		if (res >= 0) {
-			sent += res;
-		} else {
+	static bool valid(const RPCCollectiveHeader& h) {
+		if (h.size <= 0 || h.rank < 0 || h.rank >= h.size
+			|| h.root < 0 || h.root >= h.size || h.length < 0) {
 			return false;
 		}
-	} while (sent < length);
-
-	return true;
-}
-
-bool function_call(FCallArgs* f_call_args, int client_socket_id, bool send_result=true, int id_process=0){
-
-	int n_args = f_call_args->n_args;
-	char f_rt;
-	char* fname = f_call_args->fname;
-	char* buffer = f_call_args->args;
-	int ibuffer;
-
-	delete f_call_args;
-
-	void* fpf;
-	ffi_call_func pf;
-
-	ffi_cif cif;
 
-	ffi_type* ffi_rt;
-	ffi_type** ffi_args = 0;
-
-	void** ffi_values = 0;
+		if (h.type != 'i' && h.type != 'd' && h.type != 's') {
+			return false;
+		}
 
+		if (h.length % element_size(h.type)) {
+			return false;
+		}
 
-	g_mutex.lock();
-	fpf = dlsym(ext_mod_map[ext_func_map[fname]], fname);
+		switch (h.op) {
+			case CLEVER_RPC_BARRIER: case CLEVER_RPC_BROADCAST:
+			case CLEVER_RPC_GATHER: case CLEVER_RPC_ALLGATHER:
+				return true;
 
-	if (fpf == NULL) {
-		clever_fatal("[RPC] function `%s' not found at `%s'!",
-			fname, ext_func_map[fname].c_str());
-		free (fname);
-		close (client_socket_id);
-		wait_process.dec();
+			case CLEVER_RPC_SCATTER:
+				return h.type != 's';
 
-		g_mutex.unlock();
+			case CLEVER_RPC_REDUCE: case CLEVER_RPC_ALLREDUCE:
+				return h.type != 's' && h.reduce >= CLEVER_RPC_SUM
+					&& h.reduce <= CLEVER_RPC_MAX;
+		}
 
 		return false;
 	}
 
-	f_rt = ext_ret_map[fname].c_str()[0];
-
+	template <typename T>
+	static void fold(char* acc, const char* data, size_t n, int reduce) {
+		T* a = reinterpret_cast<T*>(acc);
 
-	ffi_rt = _find_rpc_type(&f_rt);
+		// The contribution is read where it was received, maybe unaligned
+		for (size_t i = 0; i < n; ++i) {
+			T v;
 
-	pf = reinterpret_cast<ffi_call_func>(fpf);
-	g_mutex.unlock();
+			memcpy(&v, data + i * sizeof(T), sizeof(T));
 
-	if(n_args>0){
-		g_mutex.lock();
-		ffi_args = (ffi_type**) malloc(n_args*sizeof(ffi_type*));
-		ffi_values = (void**) malloc(n_args*sizeof(void*));
-		g_mutex.unlock();
+			switch (reduce) {
+				case CLEVER_RPC_SUM: a[i] += v; break;
+				case CLEVER_RPC_MIN: if (v < a[i]) a[i] = v; break;
+				case CLEVER_RPC_MAX: if (v > a[i]) a[i] = v; break;
+			}
+		}
 	}
 
-	ibuffer=0;
-
-	for( int i = 0; i < n_args; ++i){
-		char type_arg;
-		type_arg = buffer[ibuffer]; 
-		ibuffer+=sizeof(char);
-
-		ffi_args[i] = _find_rpc_type(&type_arg);
-
-		switch(type_arg) {
-			case 'i': 
-				{
-					g_mutex.lock();
-					int* pi = (int*)malloc(sizeof(int));
-					g_mutex.unlock();
-
-					*pi = * ((int*)(buffer+ibuffer));
-					ibuffer+=sizeof(int);
-
-					ffi_values[i] = pi;
+	void add(Collective& op, const RPCCollectiveHeader& h, const char* data) {
+		switch (h.op) {
+			case CLEVER_RPC_BROADCAST:
+				if (h.rank == h.root) {
+					op.data.assign(data, data + h.length);
 				}
 			break;
 
-			case 'd': 
-				{
-					g_mutex.lock();
-					double* pd = (double*)malloc(sizeof(double));
-					g_mutex.unlock();
-
-					*pd = * ((double*)(buffer+ibuffer));
-					ibuffer+=sizeof(double);
-
-					ffi_values[i] = pd;
+			case CLEVER_RPC_SCATTER:
+				if (h.rank == h.root) {
+					if (h.length % (h.size * element_size(h.type))) {
+						op.failed = true;
+					} else {
+						op.data.assign(data, data + h.length);
+					}
 				}
 			break;
 
-			case 'c': case 'b':
-				{
-					g_mutex.lock();
-					char* pc = (char*)malloc(sizeof(char));
-					g_mutex.unlock();
-
-					*pc = * ((char*)(buffer+ibuffer));
-					ibuffer+=sizeof(char);
+			case CLEVER_RPC_GATHER: case CLEVER_RPC_ALLGATHER:
+				op.parts[h.rank].assign(data, data + h.length);
+			break;
 
-					ffi_values[i] = pc;
+			case CLEVER_RPC_REDUCE: case CLEVER_RPC_ALLREDUCE:
+				if (op.arrived == 1) {
+					op.data.assign(data, data + h.length);
+				} else if (op.data.size() != size_t(h.length)) {
+					op.failed = true;
+				} else if (h.type == 'i') {
+					fold<int64_t>(&op.data[0], data, h.length / 8, h.reduce);
+				} else {
+					fold<double>(&op.data[0], data, h.length / 8, h.reduce);
 				}
 			break;
+		}
+	}
 
-			case 'p': case 's':
-				{
-					int len_s;
-					len_s = * ((int*)(buffer+ibuffer));
-					ibuffer+=sizeof(int);
+	void finish(Collective& op) {
+		const RPCCollectiveHeader& info = op.info;
+		const char* data = op.data.empty() ? NULL : &op.data[0];
+		size_t chunk = op.data.size() / info.size;
 
-					g_mutex.lock();
-					char** s = (char**)malloc(sizeof(char*));
+		if (!op.failed && op.parts.size()) {
+			for (int i = 0; i < info.size; ++i) {
+				op.data.insert(op.data.end(), op.parts[i].begin(), op.parts[i].end());
+			}
+			data = op.data.empty() ? NULL : &op.data[0];
+		}
 
-					if(type_arg == 'p') {
-						*s = (char*)malloc(len_s*sizeof(char));
-					} else {
-						*s = (char*)malloc((1+len_s)*sizeof(char));
-						(*s)[len_s]='\0';
-					}
-					g_mutex.unlock();
+		for (int i = 0; i < info.size; ++i) {
+			if (op.state[i] != Collective::RANK_WAITING) {
+				continue;
+			}
 
-					memcpy((*s),buffer+ibuffer,len_s);
-					ibuffer+=len_s;
+			if (op.failed) {
+				send_reply(op.to[i], 'v', 0, NULL);
+				continue;
+			}
 
-					ffi_values[i] = s;
-				}
-			break;
+			switch (info.op) {
+				case CLEVER_RPC_BARRIER:
+					send_reply(op.to[i], 'p', 0, NULL);
+				break;
+
+				case CLEVER_RPC_SCATTER:
+					send_reply(op.to[i], 'p', chunk, data + i * chunk);
+				break;
 
+				// Only the root receives the result
+				case CLEVER_RPC_GATHER: case CLEVER_RPC_REDUCE:
+					send_reply(op.to[i], 'p', i == info.root ? op.data.size() : 0, data);
+				break;
+
+				default:
+					send_reply(op.to[i], 'p', op.data.size(), data);
+			}
 		}
 	}
 
-	if (ffi_prep_cif(&cif, FFI_DEFAULT_ABI, n_args, ffi_rt, ffi_args) != FFI_OK) {
-		clever_fatal("[RPC] failed to call function `%s'!",
-			fname);
+	::std::map<Key, Collective> ops;
 
-		g_mutex.lock();
+	Mutex mut;
 
-		free (fname);
+};
 
-		if(n_args>0){
-			free (buffer);
-			free(ffi_values);
-			free(ffi_args);
+/**
+ * Cursor over a received byte buffer, a read fails and consumes
+ * nothing when the buffer does not hold the whole field
+ */
+class RequestReader {
+
+public:
+	RequestReader(const char* data, size_t size)
+		: data(data), size(size), pos(0) {}
+
+	bool read(void* out, size_t len) {
+		if (len > size - pos) {
+			return false;
 		}
+		memcpy(out, data + pos, len);
+		pos += len;
+		return true;
+	}
 
-		g_mutex.unlock();
+	bool readInt(int& v) {
+		return read(&v, sizeof(v));
+	}
 
-		wait_process.dec();
+	bool readDouble(double& v) {
+		return read(&v, sizeof(v));
+	}
 
-		return false;
+	/**
+	 * Returns the next len bytes where they are, NULL when the buffer
+	 * does not hold them
+	 */
+	const char* take(size_t len) {
+		if (len > size - pos) {
+			return NULL;
+		}
+		pos += len;
+		return data + pos - len;
 	}
 
-	/*call function*/
-	int if_rt;
-	
-	if_rt = (int) (f_rt);
+	bool skip(size_t len) {
+		if (len > size - pos) {
+			return false;
+		}
+		pos += len;
+		return true;
+	}
 
-	switch ( f_rt ) {
-			case 'i': 
-				{
-					int vi;
-					ffi_call(&cif, pf, &vi, ffi_values);
+	size_t offset() const {
+		return pos;
+	}
 
-					if (send_result) {
-						if_rt = (int) (f_rt);
-						send(client_socket_id,(char*)(&if_rt),sizeof(if_rt));
-						send(client_socket_id,(char*)(&vi),sizeof(vi));
-					} else {
-						g_mutex.lock();
+private:
+	const char* data;
+	size_t size;
+	size_t pos;
+};
 
-						char* b = (char*) malloc (sizeof(int));
-						memcpy(b,&vi,sizeof(int));
 
-						g_mutex.unlock();
-						if_rt = (int) (f_rt);
-						ret_map.insert(client_socket_id, id_process, if_rt, sizeof(int),b);
-					}
-				}
-			break;
+struct FCallArgs {
 
-			case 'd': 
-				{
-					double vd;
-					ffi_call(&cif, pf, &vd, ffi_values);
-					if (send_result) {
-						if_rt = (int) (f_rt);
-						send(client_socket_id,(char*)(&if_rt),sizeof(int));
-						send(client_socket_id,(char*)(&vd),sizeof(double));
-					} else {
-						g_mutex.lock();
+	int len_fname;
+	char* fname;
+	int n_args;
+	int size_args;
+	char* args;
+	// When the call was queued for a worker
+	uint64_t queued;
 
-						char* b = (char*) malloc (sizeof(double));
-						memcpy(b,&vd,sizeof(double));
+	FCallArgs(int len_fname=0, char* fname=0, int n_args=0, int size_args=0, char* args=0):
+		len_fname(len_fname), fname(fname), n_args(n_args), size_args(size_args), args(args),
+		queued(0) {
+	}
 
-						g_mutex.unlock();
-						if_rt = (int) (f_rt);
-						ret_map.insert(client_socket_id, id_process, if_rt, sizeof(double),b);
-					}
-				}
-			break;
+	/**
+	 * Size of the request as it was received
+	 */
+	size_t requestSize() const {
+		return sizeof(len_fname) + len_fname + sizeof(n_args)
+			+ (n_args > 0 ? sizeof(size_args) + size_args : 0);
+	}
 
-			case 'c': case 'b':
-				{
-					char vc;
-					ffi_call(&cif, pf, &vc, ffi_values);
+	/**
+	 * Decodes the call from a complete request (see request_length)
+	 */
+	void decode(RequestReader& r) {
+		r.readInt(len_fname);
 
-					if (send_result) {
-						if_rt = (int) (f_rt);
-						send(client_socket_id,(char*)(&if_rt),sizeof(int));
-						send(client_socket_id,(char*)(&vc),sizeof(char));
-					} else {
-						g_mutex.lock();
+		fname = (char*) malloc ((len_fname+1)*sizeof(char));
+		fname[len_fname]='\0';
 
-						char* b = (char*) malloc (sizeof(char));
-						memcpy(b,&vc,sizeof(char));
+		r.read(fname, len_fname);
+		r.readInt(n_args);
 
-						g_mutex.unlock();
-						if_rt = (int) (f_rt);
-						ret_map.insert(client_socket_id, id_process, if_rt, sizeof(char),b);
-					}
-				}
-			break;
+		if(n_args>0){
+			r.readInt(size_args);
 
-			case 'p': case 's':
-				{
-					char* vs[1];
-					int size_vs;
+			args = (char*) malloc(size_args*sizeof(char));
 
-					ffi_call(&cif, pf, &vs, ffi_values);
+			r.read(args, size_args);
+		}
+	}
 
-					 size_vs = * ((int*) vs[0]);
+	~FCallArgs() {}
+};
 
-					if (send_result) {
-						if_rt = (int) (f_rt);
-						send(client_socket_id,(char*)(&if_rt),sizeof(int));
-						send(client_socket_id,(char*)(&size_vs),sizeof(int));
-						send(client_socket_id,(char*)(vs[0]+sizeof(int)), size_vs);
-					} else {
 
-						g_mutex.lock();
+DataMap data_map;
+RetMap ret_map;
+CollectiveMap collective_map;
+SecurePrint printer;
+WaitProcess wait_process;
 
-						char* b = (char*) malloc (size_vs*sizeof(char));
-						memcpy(b,(char*)(vs[0]+sizeof(int)),size_vs);
+// Segment of a server listening on a shm:// address
+ShmServer shm_server;
 
-						g_mutex.unlock();
-						if_rt = (int) (f_rt);
-						ret_map.insert(client_socket_id, id_process, if_rt, size_vs*sizeof(char),b);
-					}
-					free(vs[0]);
+/**
+ * Replies to a connection that its socket (or ring) did not take yet.
+ * Each connection has its own, so a client that stops reading only
+ * holds back its own replies
+ */
+struct Outbox {
+	Outbox(int fd, ShmSlot* shm)
+		: fd(fd), shm(shm), sent(0), watched(false), failed(false) {}
+
+	int fd;
+	ShmSlot* shm;
+	// Queued bytes begin at data[sent]
+	::std::vector<char> data;
+	size_t sent;
+	// The reactor was told to write the rest
+	bool watched;
+	// The client is gone, replies are dropped
+	bool failed;
+	// Held while a reply is written, so replies never interleave
+	Mutex mut;
+};
 
-				}
-			break;
+// The outboxes by descriptor. Its lock is taken before an outbox's own
+Mutex outbox_mutex;
+::std::map<int, Outbox*> outboxes;
 
-			case 'v':
-				{
-					ffi_call(&cif, pf, NULL, ffi_values);
+// Outboxes the reactor has to write, and the descriptor waking it up
+Mutex blocked_mutex;
+::std::vector<int> blocked_outboxes;
+int outbox_wakeup = -1;
 
-					if (send_result) {
-						if_rt = (int) (f_rt);
-						send(client_socket_id,(char*)(&if_rt),sizeof(int));
-					} else {
-						if_rt = (int) (f_rt);
-						ret_map.insert(client_socket_id, id_process, if_rt, 0,0);
-					}
-				}
-			break;
+Outbox* outbox_open(int fd, ShmSlot* shm) {
+	Outbox* o = new Outbox(fd, shm);
+
+	outbox_mutex.lock();
+	outboxes[fd] = o;
+	outbox_mutex.unlock();
+
+	return o;
+}
+
+/**
+ * Drops the outbox of a connection being closed, what it still holds
+ * is never sent
+ */
+void outbox_close(Outbox* o) {
+	outbox_mutex.lock();
+	outboxes.erase(o->fd);
+
+	// Waits for a reply being written
+	o->mut.lock();
+	if (o->shm) {
+		o->shm->reply.writer_waiting = 0;
 	}
+	o->mut.unlock();
 
-	/*free memory*/
+	outbox_mutex.unlock();
 
-	ibuffer = 0;
-	for( int i = 0; i < n_args; ++i){
-		char type_arg;
-		type_arg = buffer[ibuffer]; ibuffer+=sizeof(char);
+	delete o;
+}
+
+/**
+ * Advances iov past done bytes
+ */
+static void skip_sent(struct iovec*& iov, int& n, size_t done) {
+	while (n > 0 && done >= iov->iov_len) {
+		done -= iov->iov_len;
+		++iov;
+		--n;
+	}
+
+	if (n > 0) {
+		iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+		iov->iov_len -= done;
+	}
+}
+
+/**
+ * Writes what the socket (or ring) takes without blocking, iov is
+ * advanced past it. Fails when the client is gone
+ */
+static bool write_some(Outbox* o, struct iovec*& iov, int& n) {
+	if (o->shm) {
+		ShmRing& ring = o->shm->reply;
+
+		while (n > 0) {
+			size_t len = iov->iov_len;
+			size_t written = ring.write(static_cast<const char*>(iov->iov_base), len);
+
+			skip_sent(iov, n, written);
+
+			// Full
+			if (written < len) {
+				return shm_peer_alive(o->shm, o->shm->client_pid);
+			}
+		}
+		return true;
+	}
+
+	int flags = MSG_DONTWAIT;
+
+#ifdef MSG_NOSIGNAL
+	// A client that went away must not kill the server with SIGPIPE
+	flags |= MSG_NOSIGNAL;
+#endif
+
+	while (n > 0) {
+		struct msghdr msg;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
+
+		ssize_t res = sendmsg(o->fd, &msg, flags);
+
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		skip_sent(iov, n, res);
+	}
+
+	return true;
+}
+
+/**
+ * Asks the reactor to write what the outbox holds once the client
+ * reads. A shared memory client rings the doorbell when it reads while
+ * the reply ring's writer waits
+ */
+static void outbox_watch(Outbox* o) {
+	o->watched = true;
+
+	if (o->shm) {
+		o->shm->reply.writer_waiting = 1;
+		__sync_synchronize();
+	}
+
+	blocked_mutex.lock();
+	blocked_outboxes.push_back(o->fd);
+	blocked_mutex.unlock();
+
+	char byte = 0;
+	ssize_t res = write(outbox_wakeup, &byte, 1);
+
+	(void) res;
+}
+
+/**
+ * Writes what the outbox holds, returns whether some is still left
+ */
+bool outbox_flush(Outbox* o) {
+	o->mut.lock();
+
+	if (!o->failed && o->sent < o->data.size()) {
+		struct iovec iov;
+		struct iovec* p = &iov;
+		int n = 1;
+
+		iov.iov_base = &o->data[o->sent];
+		iov.iov_len = o->data.size() - o->sent;
+
+		if (write_some(o, p, n)) {
+			o->sent = o->data.size() - (n > 0 ? p->iov_len : 0);
+		} else {
+			o->failed = true;
+		}
+	}
+
+	if (o->failed || o->sent == o->data.size()) {
+		o->data.clear();
+		o->sent = 0;
+		o->watched = false;
+
+		if (o->shm) {
+			o->shm->reply.writer_waiting = 0;
+		}
+	} else if (o->sent >= CLEVER_RPC_READ_CHUNK && o->sent * 2 >= o->data.size()) {
+		o->data.erase(o->data.begin(), o->data.begin() + o->sent);
+		o->sent = 0;
+	}
+
+	bool left = o->watched;
+
+	o->mut.unlock();
+
+	return left;
+}
+
+/**
+ * Bytes of replies the outbox holds
+ */
+size_t outbox_queued(Outbox* o) {
+	o->mut.lock();
+	size_t queued = o->data.size() - o->sent;
+	o->mut.unlock();
+
+	return queued;
+}
+
+/**
+ * Sends the buffers to a client, or queues what its socket (or ring)
+ * does not take at once. Never blocks, fails when the client is gone.
+ * Negative descriptors are shared memory connections (see shm_scan)
+ */
+bool send_vector(int fd, struct iovec* iov, int n) {
+	outbox_mutex.lock();
+
+	::std::map<int, Outbox*>::iterator it = outboxes.find(fd);
+
+	if (it == outboxes.end()) {
+		outbox_mutex.unlock();
+		return false;
+	}
+
+	Outbox* o = it->second;
+
+	o->mut.lock();
+	outbox_mutex.unlock();
+
+	// Nothing may overtake the replies already queued
+	if (!o->failed && o->sent == o->data.size() && !write_some(o, iov, n)) {
+		o->failed = true;
+	}
+
+	if (o->failed) {
+		o->mut.unlock();
+		return false;
+	}
+
+	for (; n > 0; ++iov, --n) {
+		append(o->data, iov->iov_base, iov->iov_len);
+	}
+
+	if (o->sent < o->data.size() && !o->watched) {
+		outbox_watch(o);
+	}
+
+	o->mut.unlock();
+
+	return true;
+}
+
+bool send(int m_socket, const char *buffer, int length) {
+	struct iovec iov;
+
+	iov.iov_base = const_cast<char*>(buffer);
+	iov.iov_len = length;
+
+	return send_vector(m_socket, &iov, 1);
+}
+
+/**
+ * Sends a typed result as one message: the type, the size for string
+ * and object payloads, then the payload itself. Framed connections get
+ * it in a reply frame carrying the request id
+ */
+void send_reply(const ReplyTo& to, int type, int size, const char* b) {
+	char f_rt = (char) (type);
+	RPCFrameHeader header;
+	char prefix[sizeof(header) + 2 * sizeof(int)];
+	size_t len = to.framed ? sizeof(header) : 0;
+	size_t payload = 0;
+
+	memcpy(prefix + len, &type, sizeof(type));
+	len += sizeof(type);
+
+	if (f_rt != 'v') {
+		if (f_rt == 's' || f_rt == 'p') {
+			memcpy(prefix + len, &size, sizeof(size));
+			len += sizeof(size);
+		}
+		if (size > 0) {
+			payload = size;
+		}
+	}
+
+	if (to.framed) {
+		header.length = len - sizeof(header) + payload;
+		header.type = type;
+		header.id = to.id;
+		header.flags = CLEVER_RPC_FLAG_REPLY;
+
+		memcpy(prefix, &header, sizeof(header));
+	}
+
+	// The payload goes out from where it is, without being copied
+	struct iovec iov[2];
+
+	iov[0].iov_base = prefix;
+	iov[0].iov_len = len;
+	iov[1].iov_base = const_cast<char*>(b);
+	iov[1].iov_len = payload;
+
+	send_vector(to.fd, iov, 2);
+}
+
+/**
+ * Thread's reusable storage for decoding call arguments
+ */
+struct CallScratch {
+	union Arg {
+		int i;
+		double d;
+		char c;
+		char* p;
+	};
+
+	::std::string tags;
+	::std::vector<Arg> args;
+	::std::vector<void*> values;
+	::std::vector<char> strings;
+};
+
+pthread_key_t scratch_key;
+pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+void delete_call_scratch(void* scratch) {
+	delete static_cast<CallScratch*>(scratch);
+}
 
-		ffi_args[i] = _find_rpc_type(&type_arg);
+void create_scratch_key() {
+	pthread_key_create(&scratch_key, &delete_call_scratch);
+}
+
+CallScratch* get_call_scratch() {
+	pthread_once(&scratch_once, &create_scratch_key);
+
+	CallScratch* scratch = static_cast<CallScratch*>(pthread_getspecific(scratch_key));
+
+	if (scratch == NULL) {
+		scratch = new CallScratch;
+		pthread_setspecific(scratch_key, scratch);
+	}
+
+	return scratch;
+}
+
+/**
+ * Returns the call interface of func for the argument types in tags,
+ * preparing and publishing it on first use
+ */
+RPCSignature* prepare_signature(RPCFunction* func, const ::std::string& tags) {
+	RPCSignature* sig = func->signatures;
 
-		g_mutex.lock();
+	__sync_synchronize();
 
-		if(type_arg == 's' || type_arg == 'p'){
-			free(* ((char**)ffi_values[i]));
+	for (; sig != NULL; sig = sig->next) {
+		if (sig->tags == tags) {
+			return sig;
 		}
+	}
+
+	sig = new RPCSignature(tags);
+
+	for (size_t i = 0; i < tags.size(); ++i) {
+		sig->types[i] = _find_rpc_type(&tags[i]);
+	}
+
+	if (ffi_prep_cif(&sig->cif, FFI_DEFAULT_ABI, tags.size(), func->rtype,
+			sig->types) != FFI_OK) {
+		delete sig;
+		return NULL;
+	}
 
-		free(ffi_values[i]);
+	// Two threads preparing the same types both publish, which only
+	// leaves a duplicate entry behind
+	do {
+		sig->next = func->signatures;
+	} while (!__sync_bool_compare_and_swap(&func->signatures, sig->next, sig));
+
+	return sig;
+}
+
+bool function_call(FCallArgs* f_call_args, const ReplyTo& to, bool send_result=true, int id_process=0){
+
+	uint64_t start = monotonic_ns();
+	uint64_t queue_wait = start - f_call_args->queued;
+	size_t request_size = f_call_args->requestSize();
+	int n_args = f_call_args->n_args;
+	char* fname = f_call_args->fname;
+	char* buffer = f_call_args->args;
+	int ibuffer;
+	size_t strings = 0;
+
+	delete f_call_args;
+
+	// The table is complete before the server starts, no lock needed
+	FunctionTable::const_iterator it = rpc_functions.find(fname);
+	RPCFunction* func = it != rpc_functions.end() ? it->second : NULL;
+
+	if (func == NULL || func->symbol == NULL) {
+		clever_fatal("[RPC] function `%s' not found at `%s'!",
+			fname, func ? func->libname.c_str() : "");
+		free (fname);
+
+		return false;
+	}
+
+	CallScratch* scratch = get_call_scratch();
+
+	scratch->tags.resize(n_args);
 
-		g_mutex.unlock();
+	ibuffer=0;
+	for( int i = 0; i < n_args; ++i){
+		char type_arg = buffer[ibuffer];
+		ibuffer+=sizeof(char);
 
+		scratch->tags[i] = type_arg;
 
 		switch(type_arg) {
 			case 'i': ibuffer+=sizeof(int); break;
@@ -725,494 +1252,1756 @@ bool function_call(FCallArgs* f_call_args, int client_socket_id, bool send_resul
 			case 'p': case 's':
 				{
 					int len_s;
-					len_s = * ((int*)(buffer+ibuffer));
+					memcpy(&len_s, buffer+ibuffer, sizeof(int));
+					ibuffer+=sizeof(int);
+					ibuffer+=len_s;
+					strings+=len_s+1;
+				}
+			break;
+		}
+	}
+
+	RPCSignature* sig = prepare_signature(func, scratch->tags);
+
+	if (sig == NULL) {
+		clever_fatal("[RPC] failed to call function `%s'!",
+			fname);
+
+		free (fname);
+
+		if(n_args>0){
+			free (buffer);
+		}
+
+		return false;
+	}
+
+	scratch->args.resize(n_args);
+	scratch->values.resize(n_args);
+	scratch->strings.resize(strings);
+
+	ibuffer=0;
+	strings=0;
+	for( int i = 0; i < n_args; ++i){
+		CallScratch::Arg& arg = scratch->args[i];
+
+		ibuffer+=sizeof(char);
+
+		switch(scratch->tags[i]) {
+			case 'i':
+				memcpy(&arg.i, buffer+ibuffer, sizeof(int));
+				ibuffer+=sizeof(int);
+			break;
+
+			case 'd':
+				memcpy(&arg.d, buffer+ibuffer, sizeof(double));
+				ibuffer+=sizeof(double);
+			break;
+
+			case 'c': case 'b':
+				arg.c = buffer[ibuffer];
+				ibuffer+=sizeof(char);
+			break;
+
+			case 'p': case 's':
+				{
+					int len_s;
+					memcpy(&len_s, buffer+ibuffer, sizeof(int));
 					ibuffer+=sizeof(int);
+
+					arg.p = &scratch->strings[strings];
+					memcpy(arg.p, buffer+ibuffer, len_s);
+					arg.p[len_s]='\0';
+
 					ibuffer+=len_s;
+					strings+=len_s+1;
 				}
 			break;
+		}
+
+		scratch->values[i] = &arg;
+	}
 
+	/*call function*/
+	union {
+		ffi_arg i;
+		double d;
+		void* p;
+	} rvalue;
+
+	start = monotonic_ns();
+
+	ffi_call(&sig->cif, func->symbol, &rvalue,
+		n_args > 0 ? &scratch->values[0] : NULL);
+
+	uint64_t exec = monotonic_ns() - start;
+
+	int if_rt = (int) (func->rt);
+	int vi;
+	char vc;
+	int size = 0;
+	const char* data = NULL;
+
+	switch (func->rt) {
+		case 'i':
+			vi = (int) rvalue.i;
+			size = sizeof(vi);
+			data = (const char*)(&vi);
+		break;
+
+		case 'd':
+			size = sizeof(double);
+			data = (const char*)(&rvalue.d);
+		break;
+
+		case 'c': case 'b':
+			vc = (char) rvalue.i;
+			size = sizeof(vc);
+			data = &vc;
+		break;
+
+		// The function returns its size followed by the data, in a
+		// buffer the caller frees
+		case 'p': case 's':
+			memcpy(&size, rvalue.p, sizeof(int));
+			data = static_cast<const char*>(rvalue.p) + sizeof(int);
+		break;
+	}
+
+	if (send_result) {
+		send_reply(to, if_rt, size, data);
+	} else {
+		char* b = NULL;
+
+		if (size > 0) {
+			b = (char*) malloc (size);
+			memcpy(b, data, size);
 		}
+
+		ret_map.insert(to.fd, id_process, if_rt, size, b);
 	}
 
-	g_mutex.lock();
+	func->stats.recordCall(request_size,
+		sizeof(if_rt) + (func->rt == 'p' || func->rt == 's' ? sizeof(size) : 0) + size,
+		queue_wait, exec);
+
+	if (func->rt == 'p' || func->rt == 's') {
+		free(rvalue.p);
+	}
+
+	/*free memory*/
 
 	if(n_args>0){
-		free(ffi_args);
-		free(ffi_values);
 		free(buffer);
 	}
 
 	free(fname);
 
-	g_mutex.unlock();
-
 	return true;
 }
 
-struct ProcessArgs {
-	FCallArgs* f_call_args;
-	int client_socket_id;
-	int id_process;
+/**
+ * Client connection of the server. The reactor and every job that may
+ * still reply on it hold a reference, the last release closes the socket
+ */
+struct Connection {
+	Connection(int fd, ShmSlot* shm=NULL)
+		: fd(fd), refs(1), shm(shm), out(outbox_open(fd, shm)), ready(false),
+			framed(false), killer(false), paused(false), eof(false), start(0),
+			batch_pos(0) {}
+
+	// Negative for shared memory connections
+	int fd;
+	int refs;
+	// Slot of a shared memory connection, requests are read in place
+	ShmSlot* shm;
+	// Replies not written yet
+	Outbox* out;
+	// INIT received
+	bool ready;
+	// INIT2 received, requests come in frames
+	bool framed;
+	// KILL received, the rest of the input is discarded
+	bool killer;
+	// A worker queue was full, the socket is not read until it drains
+	bool paused;
+	// The client closed its end, what was received is still run
+	bool eof;
+	// Bytes received and not parsed yet begin at input[start]
+	::std::vector<char> input;
+	size_t start;
+	// Requests of the batch frame at input[start] already dispatched
+	size_t batch_pos;
+};
+
+Mutex conn_mutex;
+// Function calls, and the callProcess() requests kept apart so that
+// long running processes cannot starve the calls
+WorkerPool worker_pool, process_pool;
+
+void conn_acquire(Connection* c) {
+	conn_mutex.lock();
+	++c->refs;
+	conn_mutex.unlock();
+}
+
+void conn_release(Connection* c) {
+	conn_mutex.lock();
+	int refs = --c->refs;
+	conn_mutex.unlock();
+
+	if (refs > 0) {
+		return;
+	}
+
+	data_map.cancel(c->fd);
+	ret_map.cancel(c->fd);
+	collective_map.cancel(c->fd);
+	outbox_close(c->out);
+
+	if (c->shm) {
+		shm_release(c->shm);
+	} else {
+		close(c->fd);
+	}
+	wait_process.dec();
+
+	delete c;
+}
+
+struct CallArgs {
+	FCallArgs* f_call_args;
+	Connection* conn;
+	int id_process;
+	int id_request;
+
+	CallArgs(FCallArgs* f_call_args=0, Connection* c=0, int id=0, int request=0):
+		f_call_args(f_call_args), conn(c), id_process(id), id_request(request) {}
+
+	ReplyTo replyTo() const {
+		return ReplyTo(conn->fd, id_request, conn->framed);
+	}
+};
+
+void call_function_job(void* args) {
+	CallArgs* m_args = static_cast<CallArgs*>(args);
+
+	function_call(m_args->f_call_args, m_args->replyTo());
+
+	conn_release(m_args->conn);
+	delete m_args;
+}
+
+void call_process_job(void* args) {
+	CallArgs* m_args = static_cast<CallArgs*>(args);
+
+	function_call(m_args->f_call_args, m_args->replyTo(), false, m_args->id_process);
+
+	conn_release(m_args->conn);
+	delete m_args;
+}
+
+/**
+ * Queues a call on the pool holding a reference to the connection.
+ * When the queue is full nothing is kept and false is returned
+ */
+bool queue_call(WorkerPool& pool, WorkerJob job, FCallArgs* f_call_args,
+		Connection* c, int id_process, int id_request) {
+	CallArgs* args = new CallArgs(f_call_args, c, id_process, id_request);
+
+	conn_acquire(c);
+
+	f_call_args->queued = monotonic_ns();
+
+	if (pool.tryPush(job, args)) {
+		return true;
+	}
+
+	conn_release(c);
+	delete args;
+
+	free(f_call_args->fname);
+	free(f_call_args->args);
+	delete f_call_args;
+
+	return false;
+}
+
+/**
+ * Checks that r holds the whole body of a request of the given type,
+ * len is left negative when a length field is malformed
+ */
+bool request_complete(int type, RequestReader& r, int& len) {
+	int n_args = 0;
+
+	switch (type) {
+		case CLEVER_RPC_RI:
+			return r.skip(sizeof(int) + sizeof(int));
+
+		case CLEVER_RPC_RD:
+		case CLEVER_RPC_SI: case CLEVER_RPC_SD: case CLEVER_RPC_SS: case CLEVER_RPC_SO:
+		case CLEVER_RPC_GR:
+			return r.skip(sizeof(int) + sizeof(double));
+
+		case CLEVER_RPC_RS: case CLEVER_RPC_RO:
+			return r.skip(sizeof(int)) && r.readInt(len)
+				&& len >= 0 && r.skip(len);
+
+		case CLEVER_RPC_PI:
+			return r.skip(sizeof(int));
+
+		case CLEVER_RPC_CO:
+			return r.skip(sizeof(RPCCollectiveHeader) - sizeof(int))
+				&& r.readInt(len) && len >= 0 && r.skip(len);
+
+		case CLEVER_RPC_PS:
+			return r.readInt(len) && len >= 0 && r.skip(len);
+
+		case CLEVER_RPC_PC:
+		case CLEVER_RPC_FC:
+			return (type == CLEVER_RPC_FC || r.skip(sizeof(int)))
+				&& r.readInt(len) && len >= 0 && r.skip(len)
+				&& r.readInt(n_args)
+				&& (n_args <= 0 || (r.readInt(len) && len >= 0 && r.skip(len)));
+	}
+
+	// Unknown codes are skipped
+	return true;
+}
+
+/**
+ * Returns the size of the v1 request at the start of data, 0 when it
+ * was not completely received yet and -1 when it is malformed
+ */
+long request_length(const char* data, size_t size) {
+	RequestReader r(data, size);
+	int type = 0, len = 0;
+
+	if (!r.readInt(type)) {
+		return 0;
+	}
+
+	bool complete = request_complete(type, r, len);
+
+	if (len < 0) {
+		return -1;
+	}
+
+	return complete ? r.offset() : 0;
+}
+
+/**
+ * Same as request_length() for a frame of the v2 protocol
+ */
+long frame_length(const char* data, size_t size) {
+	RPCFrameHeader header;
+
+	if (size < sizeof(header)) {
+		return 0;
+	}
+
+	memcpy(&header, data, sizeof(header));
+
+	if (header.length < 0 || header.length > CLEVER_RPC_MAX_FRAME) {
+		return -1;
+	}
+
+	size_t length = sizeof(header) + header.length;
+
+	return size >= length ? length : 0;
+}
+
+/**
+ * Runs a complete request received on the connection. Messages and
+ * waits are handled right here, calls go to the worker threads.
+ * Returns false, without running it, when the call queue is full
+ */
+bool dispatch_request(Connection* c, int type, RequestReader& r, int id_request) {
+	int id_message=0, len_message=0, vi_message=0;
+	double vd_message=0;
+	char* buffer;
+	FCallArgs* f_call_args;
+	ReplyTo to(c->fd, id_request, c->framed);
+
+	switch (type) {
+
+		case CLEVER_RPC_RI:
+
+			r.readInt(id_message);
+			r.readInt(vi_message);
+
+			buffer = (char*) malloc (sizeof(vi_message));
+			memcpy(buffer,&vi_message,sizeof(vi_message));
+
+			data_map.insert(c->fd, id_message, 'i', sizeof(vi_message),buffer);
+		break;
+
+		case CLEVER_RPC_RD:
+
+			r.readInt(id_message);
+			r.readDouble(vd_message);
+
+			buffer = (char*) malloc (sizeof(vd_message));
+			memcpy(buffer,&vd_message,sizeof(vd_message));
+
+			data_map.insert(c->fd, id_message, 'd', sizeof(vd_message),buffer);
+		break;
+
+		case CLEVER_RPC_RS: case CLEVER_RPC_RO:
+
+			r.readInt(id_message);
+			r.readInt(len_message);
+
+			buffer = (char*) malloc (len_message);
+			r.read(buffer, len_message);
+
+			data_map.insert(c->fd, id_message, type == CLEVER_RPC_RS ? 's' : 'p',
+				len_message, buffer);
+		break;
+
+		// The client's polling interval that follows the id is not
+		// needed anymore, the reply is sent as soon as the data arrives
+		case CLEVER_RPC_SI: case CLEVER_RPC_SD: case CLEVER_RPC_SS: case CLEVER_RPC_SO:
+
+			r.readInt(id_message);
+
+			data_map.sendData(to, id_message);
+		break;
+
+		/*get result process*/
+		case CLEVER_RPC_GR:
+
+			r.readInt(id_message);
+
+			ret_map.sendData(to, id_message);
+		break;
+
+		case CLEVER_RPC_CO: {
+			RPCCollectiveHeader header;
+
+			r.read(&header, sizeof(header));
+
+			collective_map.contribute(to, header, r.take(header.length));
+		}
+		break;
+
+		case CLEVER_RPC_PI:
+
+			r.readInt(vi_message);
+
+			printer.printInt(vi_message);
+		break;
+
+		case CLEVER_RPC_PS:
+
+			r.readInt(len_message);
+
+			buffer = (char*) malloc (len_message+1);
+			buffer[len_message]='\0';
+			r.read(buffer, len_message);
+
+			printer.printStr(buffer);
+			free(buffer);
+		break;
+
+		/* function call*/
+		case CLEVER_RPC_FC:
+
+			f_call_args = new FCallArgs;
+			f_call_args->decode(r);
+
+			return queue_call(worker_pool, &call_function_job, f_call_args,
+				c, 0, id_request);
+
+		/* process call */
+		case CLEVER_RPC_PC:
+
+			r.readInt(id_message);
+
+			f_call_args = new FCallArgs;
+			f_call_args->decode(r);
+
+			return queue_call(process_pool, &call_process_job, f_call_args,
+				c, id_message, 0);
+	}
+
+	return true;
+}
+
+/**
+ * Outcome of running the input of a connection
+ */
+enum DispatchStatus {
+	DISPATCH_DONE,
+	// A worker queue is full, the rest is run once it drains
+	DISPATCH_BLOCKED,
+	DISPATCH_MALFORMED
+};
+
+/**
+ * Runs a complete frame, the requests of a batch frame in order. When
+ * a batch is blocked, c->batch_pos tells where to resume it
+ */
+DispatchStatus dispatch_frame(Connection* c, const char* data) {
+	RPCFrameHeader header;
+	const char* payload = data + sizeof(header);
+	int len = 0;
+
+	memcpy(&header, data, sizeof(header));
+
+	if (header.type == CLEVER_RPC_BATCH) {
+		while (c->batch_pos < (size_t) header.length) {
+			const char* inner_data = payload + c->batch_pos;
+			long sub = frame_length(inner_data, header.length - c->batch_pos);
+
+			if (sub <= 0) {
+				return DISPATCH_MALFORMED;
+			}
+
+			RPCFrameHeader inner;
+
+			memcpy(&inner, inner_data, sizeof(inner));
+
+			if (inner.type == CLEVER_RPC_BATCH) {
+				return DISPATCH_MALFORMED;
+			}
+
+			DispatchStatus status = dispatch_frame(c, inner_data);
+
+			if (status != DISPATCH_DONE) {
+				return status;
+			}
+
+			c->batch_pos += sub;
+		}
+
+		c->batch_pos = 0;
+
+		return DISPATCH_DONE;
+	}
+
+	RequestReader check(payload, header.length);
+
+	if (!request_complete(header.type, check, len) || len < 0) {
+		return DISPATCH_MALFORMED;
+	}
+
+	RequestReader r(payload, header.length);
+
+	return dispatch_request(c, header.type, r, header.id)
+		? DISPATCH_DONE : DISPATCH_BLOCKED;
+}
+
+/**
+ * Reads what is available on the connection, c->eof is set when the
+ * client closed it or the socket failed
+ */
+void receive_requests(Connection* c) {
+	char chunk[CLEVER_RPC_READ_CHUNK];
+
+	// Nothing on the server blocks on a client, see send_vector()
+	while (true) {
+		ssize_t n = recv(c->fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+
+		if (n > 0) {
+			c->input.insert(c->input.end(), chunk, chunk + n);
+
+			if ((size_t) n < sizeof(chunk)) {
+				break;
+			}
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else {
+			c->eof = !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+			break;
+		}
+	}
+}
+
+/**
+ * Runs every complete request at the start of data, stopping at the
+ * first one the worker queues cannot take. Returns the bytes used
+ */
+size_t run_buffer(Connection* c, const char* data, size_t size, bool& kill_me,
+		DispatchStatus& status) {
+	size_t used = 0;
+
+	status = DISPATCH_DONE;
+
+	while (used < size) {
+		const char* p = data + used;
+		size_t left = size - used;
+
+		if (c->killer) {
+			return size;
+		}
+
+		// The first word of a connection is either INIT, INIT2 or KILL
+		if (!c->ready) {
+			int type_call;
+
+			if (left < sizeof(type_call)) {
+				break;
+			}
+
+			memcpy(&type_call, p, sizeof(type_call));
+			used += sizeof(type_call);
+
+			if (type_call == CLEVER_RPC_KILL) {
+				printer.printMsg("Server died...\n");
+
+				c->killer = true;
+				kill_me = true;
+			} else {
+				printer.printMsg("Client connected...\n");
+
+				c->framed = type_call == CLEVER_RPC_INIT2;
+
+				int ok = c->framed ? CLEVER_RPC_OK2 : CLEVER_RPC_OK;
+				send(c->fd,(char*)(&ok),sizeof(ok));
+
+				c->ready = true;
+			}
+			continue;
+		}
+
+		long len = c->framed ? frame_length(p, left) : request_length(p, left);
+
+		if (len < 0) {
+			status = DISPATCH_MALFORMED;
+			break;
+		}
+		if (len == 0) {
+			break;
+		}
+
+		if (c->framed) {
+			status = dispatch_frame(c, p);
+		} else {
+			RequestReader r(p, len);
+			int type;
+
+			r.readInt(type);
+			status = dispatch_request(c, type, r, 0)
+				? DISPATCH_DONE : DISPATCH_BLOCKED;
+		}
+
+		if (status != DISPATCH_DONE) {
+			break;
+		}
+		used += len;
+	}
+
+	return used;
+}
+
+/**
+ * Runs the requests received on a socket connection
+ */
+DispatchStatus run_requests(Connection* c, bool& kill_me) {
+	DispatchStatus status = DISPATCH_DONE;
+
+	if (c->start < c->input.size()) {
+		c->start += run_buffer(c, &c->input[c->start],
+			c->input.size() - c->start, kill_me, status);
+	}
+
+	if (c->start == c->input.size()) {
+		c->input.clear();
+		c->start = 0;
+	} else if (c->start >= CLEVER_RPC_READ_CHUNK) {
+		c->input.erase(c->input.begin(), c->input.begin() + c->start);
+		c->start = 0;
+	}
+
+	return status;
+}
+
+/**
+ * Runs the requests of a shared memory connection where the client
+ * wrote them. Only a request split by the end of the ring, or larger
+ * than it, is put together in c->input first
+ */
+DispatchStatus run_shm_requests(Connection* c, bool& kill_me) {
+	ShmRing& ring = c->shm->request;
+	DispatchStatus status = DISPATCH_DONE;
+	int state = c->shm->state;
+
+	while (status == DISPATCH_DONE) {
+		const char* data;
+		size_t size = ring.peek(&data);
+
+		if (size == 0) {
+			break;
+		}
+
+		if (!c->input.empty()) {
+			c->input.insert(c->input.end(), data, data + size);
+			ring.consume(size);
+
+			status = run_requests(c, kill_me);
+			continue;
+		}
+
+		size_t used = run_buffer(c, data, size, kill_me, status);
+
+		if (status == DISPATCH_DONE && used < size) {
+			c->input.assign(data + used, data + size);
+			used = size;
+		}
+
+		// Blocked requests stay in the ring, the client waits for room
+		ring.consume(used);
+	}
+
+	// The client writes everything before it detaches
+	if (state != SHM_OPEN && ring.buffered() == 0) {
+		c->eof = true;
+	}
+
+	return status;
+}
+
+// What the reactor waits for on a socket
+#define CLEVER_RPC_POLL_READ 0x1
+#define CLEVER_RPC_POLL_WRITE 0x2
+
+/**
+ * Readiness notification for the server sockets, epoll on Linux and
+ * poll() elsewhere. Shared memory connections have negative descriptors
+ * and are left out, the doorbell reports them
+ */
+class Poller {
+
+public:
+	void add(int fd) {
+		watch(fd, CLEVER_RPC_POLL_READ);
+	}
+
+	void remove(int fd) {
+		watch(fd, 0);
+	}
+
+#ifdef __linux__
+	Poller() {
+		m_epoll = epoll_create(CLEVER_RPC_MAX_EVENTS);
+	}
+
+	~Poller() {
+		close(m_epoll);
+	}
+
+	/**
+	 * Waits for the events (CLEVER_RPC_POLL_*) on fd, none to stop
+	 * polling it
+	 */
+	void watch(int fd, int events) {
+		if (fd < 0) {
+			return;
+		}
+
+		::std::map<int, int>::iterator it = m_events.find(fd);
+		int op;
+
+		if (it == m_events.end()) {
+			if (events == 0) {
+				return;
+			}
+			op = EPOLL_CTL_ADD;
+			m_events[fd] = events;
+		} else if (it->second == events) {
+			return;
+		} else if (events == 0) {
+			op = EPOLL_CTL_DEL;
+			m_events.erase(it);
+		} else {
+			op = EPOLL_CTL_MOD;
+			it->second = events;
+		}
+
+		struct epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = (events & CLEVER_RPC_POLL_READ ? EPOLLIN : 0)
+			| (events & CLEVER_RPC_POLL_WRITE ? EPOLLOUT : 0);
+		ev.data.fd = fd;
+
+		epoll_ctl(m_epoll, op, fd, &ev);
+	}
+
+	/**
+	 * Blocks until some sockets are ready, stores up to max of them in
+	 * fds and returns how many
+	 */
+	int wait(int* fds, int max) {
+		struct epoll_event events[CLEVER_RPC_MAX_EVENTS];
+		int n;
+
+		if (max > CLEVER_RPC_MAX_EVENTS) {
+			max = CLEVER_RPC_MAX_EVENTS;
+		}
+
+		do {
+			n = epoll_wait(m_epoll, events, max, -1);
+		} while (n < 0 && errno == EINTR);
+
+		for (int i = 0; i < n; ++i) {
+			fds[i] = events[i].data.fd;
+		}
+
+		return n < 0 ? 0 : n;
+	}
+
+private:
+	int m_epoll;
+	::std::map<int, int> m_events;
+#else
+	Poller() {}
+
+	~Poller() {}
+
+	void watch(int fd, int events) {
+		if (fd < 0) {
+			return;
+		}
+
+		for (size_t i = 0; i < m_fds.size(); ++i) {
+			if (m_fds[i].fd != fd) {
+				continue;
+			}
+
+			if (events == 0) {
+				m_fds.erase(m_fds.begin() + i);
+			} else {
+				m_fds[i].events = poll_events(events);
+			}
+			return;
+		}
+
+		if (events == 0) {
+			return;
+		}
+
+		struct pollfd p;
+
+		p.fd = fd;
+		p.events = poll_events(events);
+		p.revents = 0;
+
+		m_fds.push_back(p);
+	}
+
+	int wait(int* fds, int max) {
+		int n = 0;
+
+		if (::poll(&m_fds[0], m_fds.size(), -1) <= 0) {
+			return 0;
+		}
+
+		for (size_t i = 0; i < m_fds.size() && n < max; ++i) {
+			if (m_fds[i].revents) {
+				fds[n++] = m_fds[i].fd;
+			}
+		}
+
+		return n;
+	}
+
+private:
+	static short poll_events(int events) {
+		return (events & CLEVER_RPC_POLL_READ ? POLLIN : 0)
+			| (events & CLEVER_RPC_POLL_WRITE ? POLLOUT : 0);
+	}
+
+	::std::vector<struct pollfd> m_fds;
+#endif
+
+	DISALLOW_COPY_AND_ASSIGN(Poller);
+};
+
+/**
+ * Polls a socket connection for what the reactor waits on: requests,
+ * unless it is paused or has too many replies queued, and room for
+ * the replies it has queued
+ */
+void watch_connection(Poller& poller, Connection* c) {
+	size_t queued = outbox_queued(c->out);
+	int events = 0;
+
+	if (!c->paused && queued < CLEVER_RPC_MAX_OUTPUT) {
+		events |= CLEVER_RPC_POLL_READ;
+	}
+	if (queued > 0) {
+		events |= CLEVER_RPC_POLL_WRITE;
+	}
+
+	poller.watch(c->fd, events);
+}
+
+/**
+ * Accepts the shared memory clients that claimed a slot and collects
+ * the connections the doorbell may be about. Once a second (alive)
+ * the clients are also checked for having died
+ */
+void shm_scan(::std::map<int, Connection*>& clients,
+		::std::vector<Connection*>& runnable, bool accepting, bool alive) {
+	for (int i = 0; i < shm_server.slots(); ++i) {
+		ShmSlot* slot = shm_server.slot(i);
+		int fd = -(i + 1);
+		::std::map<int, Connection*>::iterator it = clients.find(fd);
+
+		if (it != clients.end()) {
+			Connection* c = it->second;
+
+			if (alive && !shm_peer_alive(slot, slot->client_pid)) {
+				c->eof = true;
+			}
+			// Requests are left in the ring while too many replies are queued
+			if (!c->paused && outbox_queued(c->out) < CLEVER_RPC_MAX_OUTPUT
+				&& (slot->request.buffered() || slot->state != SHM_OPEN || c->eof)) {
+				runnable.push_back(c);
+			}
+			continue;
+		}
+
+		int state = slot->state;
+
+		if ((state == SHM_CLOSED && slot->request.buffered() == 0)
+			|| (state == SHM_DROPPED && alive)) {
+			// Left before being accepted, or died after the server let go
+			shm_release(slot);
+			continue;
+		}
+
+		// What a client wrote before detaching is still run
+		if (accepting && (state == SHM_CLOSED
+			|| (state == SHM_CONNECTING
+				&& __sync_bool_compare_and_swap(&slot->state, SHM_CONNECTING, SHM_OPEN)))) {
+			printer.printMsg("New client...\n");
+
+			wait_process.inc();
+			clients[fd] = new Connection(fd, slot);
+			runnable.push_back(clients[fd]);
+		}
+	}
+}
+
+/**
+ * Snapshot of the calls served by the registered functions
+ */
+void server_stats(StatsTable& stats) {
+	FunctionTable::const_iterator it = rpc_functions.begin(),
+		end = rpc_functions.end();
+
+	for (; it != end; ++it) {
+		stats.push_back(::std::make_pair(it->first, it->second->stats.snapshot()));
+	}
+}
+
+/**
+ * The server loop: one thread multiplexes every connection, it only
+ * blocks on the poller and hands the calls to the worker pools.
+ * listener is the TCP socket, or -1 when serving shm_server
+ */
+void serve(int listener, int workers, int queue_size) {
+	bool kill_me = false;
+	int ready[CLEVER_RPC_MAX_EVENTS];
+	::std::map<int, Connection*> clients;
+	// Connections whose requests wait for room in a worker queue
+	::std::vector<Connection*> paused;
+	Poller poller;
+	int wakeup[2];
+	time_t last_check = time(NULL);
+
+	if (workers <= 0) {
+		workers = CLEVER_RPC_PROCESS_WORKERS;
+	}
+	if (queue_size <= 0) {
+		queue_size = CLEVER_RPC_QUEUE_SIZE;
+	}
+
+	pipe(wakeup);
+	fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+
+	wait_process.init();
+
+	worker_pool.setWakeup(wakeup[1]);
+	worker_pool.start(0, queue_size);
+	process_pool.setWakeup(wakeup[1]);
+	process_pool.start(workers, queue_size);
+	outbox_wakeup = wakeup[1];
+
+	// The shared memory doorbell comes through the same pipe
+	if (listener < 0) {
+		shm_server.start(wakeup[1]);
+	}
+
+	poller.add(listener);
+	poller.add(wakeup[0]);
+
+	printer.printMsg("Waiting client...\n");
+
+	while (!kill_me || !clients.empty()) {
+		int n = poller.wait(ready, CLEVER_RPC_MAX_EVENTS);
+
+		for (int i = 0; i < n; ++i) {
+			int fd = ready[i];
+			::std::vector<Connection*> runnable;
+
+			if (fd == listener) {
+				if (kill_me) {
+					continue;
+				}
+
+				int client_socket_id = accept (listener, NULL, NULL);
+
+				if (client_socket_id < 0) {
+					continue;
+				}
+
+				// Replies are written whole, do not hold them back
+				int on = 1;
+
+				setsockopt(client_socket_id, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+				printer.printMsg("New client...\n");
+
+				wait_process.inc();
+				clients[client_socket_id] = new Connection(client_socket_id);
+				poller.add(client_socket_id);
+				continue;
+			}
+
+			if (fd == wakeup[0]) {
+				char drain[64];
+
+				while (read(wakeup[0], drain, sizeof(drain)) > 0) {
+				}
+
+				runnable.swap(paused);
+
+				// Replies that did not fit in a socket (or ring) at once
+				::std::vector<int> blocked;
+
+				blocked_mutex.lock();
+				blocked.swap(blocked_outboxes);
+				blocked_mutex.unlock();
+
+				for (size_t j = 0; j < blocked.size(); ++j) {
+					::std::map<int, Connection*>::iterator it = clients.find(blocked[j]);
+
+					if (it != clients.end()) {
+						outbox_flush(it->second->out);
+						watch_connection(poller, it->second);
+					}
+				}
+
+				if (listener < 0) {
+					time_t now = time(NULL);
+					::std::map<int, Connection*>::iterator it = clients.begin();
+
+					// The clients ring when they read, see outbox_watch()
+					for (; it != clients.end(); ++it) {
+						outbox_flush(it->second->out);
+					}
+
+					shm_scan(clients, runnable, !kill_me, now != last_check);
+					last_check = now;
+				}
+			} else {
+				::std::map<int, Connection*>::iterator it = clients.find(fd);
+
+				if (it == clients.end()) {
+					continue;
+				}
+
+				Connection* c = it->second;
+
+				outbox_flush(c->out);
+
+				// Not read while too many replies wait for the client
+				if (c->paused || outbox_queued(c->out) >= CLEVER_RPC_MAX_OUTPUT) {
+					watch_connection(poller, c);
+					continue;
+				}
+
+				receive_requests(c);
+				runnable.push_back(c);
+			}
+
+			bool killed = kill_me;
+
+			for (size_t j = 0; j < runnable.size(); ++j) {
+				Connection* c = runnable[j];
+				DispatchStatus status = c->shm
+					? run_shm_requests(c, kill_me) : run_requests(c, kill_me);
+
+				if (status == DISPATCH_BLOCKED) {
+					// Backpressure: the client's socket buffer (or ring)
+					// fills up while the workers catch up
+					c->paused = true;
+					paused.push_back(c);
+					watch_connection(poller, c);
+				} else if (status == DISPATCH_MALFORMED || c->eof) {
+					poller.remove(c->fd);
+					clients.erase(c->fd);
+					conn_release(c);
+				} else {
+					c->paused = false;
+					watch_connection(poller, c);
+				}
+			}
+
+			// Stop accepting, the server ends when the clients are gone
+			if (kill_me && !killed && listener >= 0) {
+				poller.remove(listener);
+				close (listener);
+			}
+		}
+	}
+
+	wait_process.wait();
+	worker_pool.stop();
+	process_pool.stop();
+	outbox_wakeup = -1;
+
+	close(wakeup[0]);
+	close(wakeup[1]);
+
+	StatsTable stats;
+
+	server_stats(stats);
+	dump_stats("RPC server stats:", stats);
+}
+
+RPCValue::~RPCValue() { 
+	if (m_reader_running) {
+		if (socket) {
+			socket->shutdown();
+		} else {
+			m_shm->interrupt();
+		}
+		pthread_join(m_reader, NULL);
+	}
+
+	if (!m_call_stats.empty()) {
+		StatsTable stats;
+
+		getStats(stats);
+		dump_stats("RPC client stats:", stats);
+
+		CallStatsMap::const_iterator it = m_call_stats.begin(),
+			end = m_call_stats.end();
+
+		for (; it != end; ++it) {
+			delete it->second;
+		}
+	}
+
+	if(socket) delete socket; 
+	if(m_shm) delete m_shm;
+
+	ExtMap::const_iterator it = ext_mod_map.begin(),
+		end = ext_mod_map.end();
+
+	while (it != end) {
+		if (it->second != NULL) {
+			dlclose(it->second);
+		}
+		++it;
+	}
+	ext_mod_map.clear();
+
+	FunctionTable::const_iterator fit = rpc_functions.begin(),
+		fend = rpc_functions.end();
+
+	while (fit != fend) {
+		delete fit->second;
+		++fit;
+	}
+	rpc_functions.clear();
+
+	ret_map.clear();
+	data_map.clear();
+	collective_map.clear();
+}
+
+void RPCValue::addFunction(const char* libname, const char* funcname, const char* rettype){
+	if (rpc_functions.find(funcname) != rpc_functions.end()) {
+		return;
+	}
+
+	loadLibrary(libname);
+
+	g_mutex.lock();
+	void* fpf = dlsym(ext_mod_map[libname], funcname);
+	g_mutex.unlock();
+
+	// A missing symbol is reported when it is called
+	rpc_functions[funcname] = new RPCFunction(libname,
+		reinterpret_cast<ffi_call_func>(fpf), rettype[0]);
+}
+
+void RPCValue::loadLibrary(const char* libname) {
+	g_mutex.lock();
+	if(ext_mod_map.find(libname)==ext_mod_map.end()){
+		void* m = dlopen(libname, RTLD_NOW);
+
+		ext_mod_map[libname] = m;
+		if (m == NULL) {
+			clever_fatal("[RPC] Shared library `%s' not loaded!\n Error: \n %s",
+				libname, dlerror());
+			return;
+		}
+	}
+	g_mutex.unlock();
+}
+
+
+void RPCValue::createServer(int port, int connections, int workers, int queue_size) {
+	sockaddr_in sa;
+
+	memset(&sa, 0, sizeof(sa));
+
+	sa.sin_family = PF_INET;
+	sa.sin_port = htons(port);
+	int m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+
+	bind(m_socket, (sockaddr *)&sa, sizeof(sockaddr_in));
+	
+	listen(m_socket, connections);
 
-	ProcessArgs(FCallArgs* f_call_args=0, int c=0, int id=0):
-		f_call_args(f_call_args), client_socket_id(c), id_process(id) {}
-};
+	serve(m_socket, workers, queue_size);
+}
 
-void* call_process_thread(void* args) {
-	ProcessArgs* m_args = reinterpret_cast<ProcessArgs*> (args);
+void RPCValue::createServer(const char* address, int connections, int workers, int queue_size) {
+	size_t prefix = strlen(CLEVER_RPC_SHM_PREFIX);
 
-	int id_process = m_args->id_process;
-	int client_socket_id = m_args->client_socket_id;
-	FCallArgs* f_call_args = m_args->f_call_args;
+	if (strncmp(address, CLEVER_RPC_SHM_PREFIX, prefix) != 0) {
+		createServer(atoi(address), connections, workers, queue_size);
+		return;
+	}
 
-	delete m_args;
+	// One slot per connection
+	if (!shm_server.create(address + prefix, connections)) {
+		clever_fatal("[RPC] Shared memory segment `%s' not created!", address);
+		return;
+	}
 
-	function_call(f_call_args, client_socket_id, false, id_process);
+	serve(-1, workers, queue_size);
 
-	return NULL;
+	shm_server.destroy();
 }
 
-void call_process (FCallArgs* f_call_args, int client_socket_id, int id_process){
-	//Create thread to manage connection
-	
-	pthread_attr_t attr;
-	pthread_t thread;
-
-	pthread_attr_init (&attr);
-	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+bool RPCValue::createClient(const char* host, const int port, const int time) {
+	size_t prefix = strlen(CLEVER_RPC_SHM_PREFIX);
+	bool shm = strncmp(host, CLEVER_RPC_SHM_PREFIX, prefix) == 0;
 
-	g_mutex.lock();
+	if (shm) {
+		m_shm = new ShmClient;
+	} else {
+		socket = new CSocket;
 
-	ProcessArgs* args = new ProcessArgs(f_call_args, client_socket_id, id_process); 
+		socket->setHost(host);
+		socket->setPort(port);
+		socket->setTimeout(time);
+	}
 
-	g_mutex.unlock();
+	int t=0;
 
-	pthread_create (&thread, &attr, &call_process_thread, (void*)(args));
-	
+	fprintf(stderr,"Connecting.");
+	while (t<time) {
+		if (shm ? m_shm->connect(host + prefix) : socket->connect()) {
+			fprintf(stderr,"\n");
 
-	pthread_attr_destroy (&attr);
+			// Requests are written whole, several may be in flight
+			if (socket) {
+				socket->setNoDelay();
+			}
+			return true;
+		}
+		fprintf(stderr,".");
+		sleep(1);
+		++t;
+	}
+	clever_fatal("[RPC] Failed to connect with RPC server!");
+	return false;
+}
 
+/**
+ * Sends a request, as a frame when the framed protocol is in use.
+ * Returns the request id to wait for when reply is true
+ */
+int RPCValue::sendRequest(int type, const ::std::vector<char>& payload, bool reply) {
+	const char* body = payload.empty() ? NULL : &payload[0];
 
-}
+	if (!m_framed) {
+		struct iovec iov[2];
 
+		iov[0].iov_base = &type;
+		iov[0].iov_len = sizeof(type);
+		iov[1].iov_base = const_cast<char*>(body);
+		iov[1].iov_len = payload.size();
 
-void* process(void* args) {
+		transmit(iov, 2);
+		return 0;
+	}
 
-	wait_process.inc();
-	int client_socket_id; 
-	int type_call=0;
-	int len_fname=0;
-	int len_message=0;
-	int id_message=0;
-	int vi_message=0;
-	double vd_message=0;
-	int t_message=0;
-	int id_process=0;
-	double time_sleep;
-	char *fname, *buffer;
-	FCallArgs* f_call_args;
+	RPCFrameHeader header;
 
-	client_socket_id = * (reinterpret_cast<int*>(args));
-	free(args);
+	header.length = payload.size();
+	header.type = type;
+	header.id = ++m_next_id;
+	header.flags = 0;
 
+	if (reply) {
+		m_last_id = header.id;
+	}
 
-	while (true) {
-		
-		/* First, read the length of the text message from the socket. If
-		read returns zero, the client closed the connection. */
-		
-		if (recv (client_socket_id, &type_call, sizeof (type_call), 0) == 0){
-			close (client_socket_id);
-			wait_process.dec();
-			
-			return NULL;
-		}
-		
+	if (m_batching && !reply) {
+		append(m_batch, &header, sizeof(header));
+		append(m_batch, body, payload.size());
+	} else {
+		writeFrame(&header, body);
+	}
 
-		switch (type_call) {
+	return header.id;
+}
 
-			case CLEVER_RPC_RI:
+/**
+ * Writes the queued batch, if any, followed by the frame header (when
+ * not NULL) with a single writev()
+ */
+bool RPCValue::writeFrame(RPCFrameHeader* header, const char* payload) {
+	RPCFrameHeader batch;
+	struct iovec iov[4];
+	int n = 0;
+
+	if (!m_batch.empty()) {
+		batch.length = m_batch.size();
+		batch.type = CLEVER_RPC_BATCH;
+		batch.id = ++m_next_id;
+		batch.flags = 0;
+
+		iov[n].iov_base = &batch;
+		iov[n++].iov_len = sizeof(batch);
+		iov[n].iov_base = &m_batch[0];
+		iov[n++].iov_len = m_batch.size();
+	}
 
-				recv (client_socket_id, &id_message, sizeof (id_message), 0);
-				recv (client_socket_id, &vi_message, sizeof (vi_message), 0);
+	if (header) {
+		iov[n].iov_base = header;
+		iov[n++].iov_len = sizeof(*header);
+		iov[n].iov_base = const_cast<char*>(payload);
+		iov[n++].iov_len = header->length;
+	}
 
-				t_message = 'i';
+	bool ok = n == 0 || transmit(iov, n);
 
-				g_mutex.lock();
-				buffer = (char*) malloc (sizeof(vi_message));
-				g_mutex.unlock();
+	m_batch.clear();
 
-				memcpy(buffer,&vi_message,sizeof(vi_message));
+	return ok;
+}
 
-				data_map.insert(client_socket_id, id_message, t_message, sizeof(vi_message),buffer);
-			break;
+bool RPCValue::transmit(struct iovec* iov, int n) {
+	return m_shm ? m_shm->sendv(iov, n) : socket->sendv(iov, n);
+}
 
-			case CLEVER_RPC_SI: case CLEVER_RPC_SD: case CLEVER_RPC_SS: case CLEVER_RPC_SO:
+bool RPCValue::transmit(const char* buffer, int length) {
+	return m_shm ? m_shm->send(buffer, length) : socket->send(buffer, length);
+}
 
-				recv (client_socket_id, &id_message, sizeof (id_message), 0);
-				recv (client_socket_id, &time_sleep, sizeof (time_sleep), 0);
+bool RPCValue::receiveAll(char* buffer, int length) {
+	return m_shm ? m_shm->receiveAll(buffer, length) : socket->receiveAll(buffer, length);
+}
 
-				data_map.sendData(client_socket_id, id_message, time_sleep);
-			break;
+/**
+ * Makes the reply to request id the source of receive(); replies to
+ * other requests read meanwhile are kept until asked for. The awaited
+ * reply itself stays in the transport and receive() reads it straight
+ * into the caller's buffers
+ */
+bool RPCValue::waitReply(int id) {
+	if (!m_framed) {
+		return true;
+	}
 
-			case CLEVER_RPC_RD:
+	m_reply.clear();
+	m_reply_pos = 0;
 
-				recv (client_socket_id, &id_message, sizeof (id_message), 0);
-				recv (client_socket_id, &vd_message, sizeof (vd_message), 0);
+	if (m_reader_running) {
+		ReplyMap::iterator it;
 
-				t_message = 'd';
+		m_reply_mutex.lock();
+		while ((it = m_replies.find(id)) == m_replies.end() && !m_reader_done) {
+			m_reply_arrived.wait(m_reply_mutex);
+		}
 
-				g_mutex.lock();
-				buffer = (char*) malloc (sizeof(vd_message));
-				g_mutex.unlock();
+		bool found = it != m_replies.end();
 
-				memcpy(buffer,&vd_message,sizeof(vd_message));
+		if (found) {
+			m_reply.swap(it->second);
+			m_replies.erase(it);
+		}
+		m_reply_mutex.unlock();
 
-				data_map.insert(client_socket_id, id_message, t_message, sizeof(vd_message),buffer);
-			break;
+		return found;
+	}
 
-			case CLEVER_RPC_RS:
+	if (!skipReply()) {
+		return false;
+	}
 
-				recv (client_socket_id, &id_message, sizeof (id_message), 0);
-				recv (client_socket_id, &len_message, sizeof (len_message), 0);
+	ReplyMap::iterator it = m_replies.find(id);
 
-				t_message = 's';
+	if (it != m_replies.end()) {
+		m_reply.swap(it->second);
+		m_replies.erase(it);
+		return true;
+	}
 
-				g_mutex.lock();
-				buffer = (char*) malloc (len_message);
-				g_mutex.unlock();
+	while (true) {
+		RPCFrameHeader header;
+		::std::vector<char> body;
 
-				recv (client_socket_id, buffer, len_message, 0);
+		if (!receiveAll((char*)(&header), sizeof(header)) || header.length < 0) {
+			return false;
+		}
 
-				data_map.insert(client_socket_id, id_message, t_message, len_message,buffer);
-			break;
+		replyArrived(header.id, header.length);
 
-			case CLEVER_RPC_RO:
+		if (header.id == id) {
+			m_reply_left = header.length;
+			return true;
+		}
 
-				recv (client_socket_id, &id_message, sizeof (id_message), 0);
-				recv (client_socket_id, &len_message, sizeof (len_message), 0);
+		body.resize(header.length);
 
-				t_message = 'p';
+		if (header.length > 0 && !receiveAll(&body[0], header.length)) {
+			return false;
+		}
 
-				g_mutex.lock();
-				buffer = (char*) malloc (len_message);
-				g_mutex.unlock();
+		m_replies[header.id].swap(body);
+	}
+}
 
-				recv (client_socket_id, buffer, len_message, 0);
+/**
+ * Reads and drops whatever the caller left of the previous reply
+ */
+bool RPCValue::skipReply() {
+	while (m_reply_left > 0) {
+		char skip[256];
+		int n = m_reply_left < sizeof(skip) ? m_reply_left : sizeof(skip);
 
-				data_map.insert(client_socket_id, id_message, t_message, len_message,buffer);
-			break;
+		if (!receiveAll(skip, n)) {
+			return false;
+		}
+		m_reply_left -= n;
+	}
 
+	return true;
+}
 
-			case CLEVER_RPC_PI:
+bool RPCValue::receive(char* buffer, int length) {
+	if (!m_framed) {
+		return receiveAll(buffer, length);
+	}
 
-				recv (client_socket_id, &len_fname, sizeof (len_fname), 0);
+	if (m_reply_left > 0) {
+		if ((size_t) length > m_reply_left) {
+			return false;
+		}
 
-				printer.printInt(len_fname);
-			break;
+		m_reply_left -= length;
 
-			case CLEVER_RPC_PS:
+		return receiveAll(buffer, length);
+	}
 
-				
-				recv (client_socket_id, &len_fname, sizeof (len_fname), 0);
-				
+	if ((size_t) length > m_reply.size() - m_reply_pos) {
+		return false;
+	}
 
-				g_mutex.lock();
+	memcpy(buffer, &m_reply[m_reply_pos], length);
+	m_reply_pos += length;
 
-				fname = (char*) malloc ((len_fname+1));
-				fname[len_fname]='\0';
+	return true;
+}
 
-				g_mutex.unlock();
+void RPCValue::sendString(const char* s, int len) {
+	::std::vector<char> payload;
 
-				
-				recv (client_socket_id, fname, len_fname, 0);
-				
+	append(payload, &len, sizeof(len));
+	append(payload, s, len);
 
-				printer.printStr(fname);
-				free(fname);
-			break;
+	sendRequest(CLEVER_RPC_PS, payload, false);
+}
 
-			/* function call*/
-			case CLEVER_RPC_FC:
+void RPCValue::sendInteger(int v) {
+	::std::vector<char> payload;
 
-				g_mutex.lock();
+	append(payload, &v, sizeof(v));
 
-				f_call_args = new FCallArgs;
+	sendRequest(CLEVER_RPC_PI, payload, false);
+}
 
-				g_mutex.unlock();
+void RPCValue::sendKill() {
+	int id=CLEVER_RPC_KILL;
 
-				f_call_args->receive(client_socket_id);
+	transmit((char*)(&id),sizeof(id));
+}
 
-				if (!function_call(f_call_args, client_socket_id)) {
-					return NULL;
-				}
-			break;
+bool RPCValue::sendInit() {
+	int id=CLEVER_RPC_INIT2;
 
-			/* process call */
-			case CLEVER_RPC_PC:
-				
-				recv (client_socket_id, &id_process, sizeof (id_process), 0);
-				
+	transmit((char*)(&id),sizeof(id));
 
-				g_mutex.lock();
+	int ok;
 
-				f_call_args = new FCallArgs;
+	if(!receiveAll((char*)(&ok),sizeof(ok))) {
+		return false;
+	}
 
-				g_mutex.unlock();
+	// Servers without the framed protocol take any first word as INIT
+	m_framed = ok == CLEVER_RPC_OK2;
 
-				f_call_args->receive(client_socket_id);
+	return true;
+}
 
-				call_process (f_call_args, client_socket_id, id_process);
-			break;
+void RPCValue::beginBatch() {
+	m_batching = true;
+}
 
-			/*get result process*/
-			case CLEVER_RPC_GR:
-				
-				recv (client_socket_id, &id_process, sizeof(id_process), 0);
-				recv (client_socket_id, &time_sleep, sizeof(time_sleep), 0);
-				
+void RPCValue::endBatch() {
+	m_batching = false;
 
-				ret_map.sendData(client_socket_id, id_process, time_sleep);
-			break;
-		}
+	if (m_framed) {
+		writeFrame(NULL, NULL);
 	}
-
-	close (client_socket_id);
-	wait_process.dec();
-	
-	return NULL;
 }
 
-RPCValue::~RPCValue() { 
-	if(socket) delete socket; 
+void RPCValue::sendFunctionCall(const char* fname, const char* args, int len_fname, int n_args, int len_args){
+	sendCall(fname, args, len_fname, n_args, len_args);
+}
 
-	ExtMap::const_iterator it = ext_mod_map.begin(),
-		end = ext_mod_map.end();
+int RPCValue::sendAsyncCall(const char* fname, const char* args, int len_fname, int n_args, int len_args){
+	if (!m_framed) {
+		clever_fatal("[RPC] callAsync() needs the framed protocol, see sendInit()!\n");
+	}
 
-	while (it != end) {
-		if (it->second != NULL) {
-			dlclose(it->second);
+	if (!m_reader_running) {
+		// The reader starts at a frame boundary
+		if (!skipReply()) {
+			clever_fatal("[RPC] Failed to receive object!\n");
 		}
-		++it;
+
+		m_reader_running = true;
+		pthread_create(&m_reader, NULL, &RPCValue::readReplies, this);
 	}
 
-	ret_map.clear();
-	data_map.clear();
-}
+	sendCall(fname, args, len_fname, n_args, len_args);
 
-void RPCValue::addFunction(const char* libname, const char* funcname, const char* rettype){
-	g_mutex.lock();
-	if(ext_func_map.find(funcname)==ext_func_map.end()){
-		ext_func_map[funcname] = libname;
-		ext_ret_map[funcname] = rettype;
-	}
-	g_mutex.unlock();
+	return m_last_id;
 }
 
-void RPCValue::loadLibrary(const char* libname) {
-	g_mutex.lock();
-	if(ext_mod_map.find(libname)==ext_mod_map.end()){
-		void* m = dlopen(libname, RTLD_NOW);
+void RPCValue::sendCall(const char* fname, const char* args, int len_fname, int n_args, int len_args){
+	::std::vector<char> payload;
+	CallStats*& stats = m_call_stats[::std::string(fname, len_fname)];
 
-		ext_mod_map[libname] = m;
-		if (m == NULL) {
-			clever_fatal("[RPC] Shared library `%s' not loaded!\n Error: \n %s",
-				libname, dlerror());
-			return;
-		}
+	if (stats == NULL) {
+		stats = new CallStats;
 	}
-	g_mutex.unlock();
-}
 
+	append(payload, &len_fname, sizeof(len_fname));
+	append(payload, fname, len_fname);
+	append(payload, &n_args, sizeof(n_args));
 
-void RPCValue::createConnection(int client_socket_id) {
-	//Create thread to manage connection
-
-	pthread_attr_t attr;
-	pthread_t thread;
+	if(n_args>0){
+		append(payload, &len_args, sizeof(len_args));
+		append(payload, args, len_args);
+	}
 
-	pthread_attr_init (&attr);
-	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+	// Filed before sending under the id sendRequest() is going to use,
+	// the reader thread may see the reply before sendRequest() returns
+	PendingCall pending = { stats, monotonic_ns() };
 
-	g_mutex.lock();
-	int * cp = (int*)malloc(sizeof(client_socket_id)); 
-	*cp = client_socket_id;
-	g_mutex.unlock();
+	m_reply_mutex.lock();
+	m_pending[m_framed ? m_next_id + 1 : 0] = pending;
+	m_reply_mutex.unlock();
 
-	pthread_create (&thread, &attr, &process, (void*)(cp));
+	stats->recordRequest(payload.size());
 
-	pthread_attr_destroy (&attr);
+	sendRequest(CLEVER_RPC_FC, payload, true);
 }
 
+/**
+ * Accounts the reply to request id, called by whoever reads it from the
+ * transport (with m_reply_mutex held when the reader thread runs)
+ */
+void RPCValue::replyArrived(int id, size_t bytes) {
+	::std::map<int, PendingCall>::iterator it = m_pending.find(id);
 
-void RPCValue::createServer(int port, int connections) {
-	sockaddr_in sa;
-
-	memset(&sa, 0, sizeof(sa));
+	if (it != m_pending.end()) {
+		it->second.stats->recordReply(bytes, monotonic_ns() - it->second.start);
+		m_pending.erase(it);
+	}
+}
 
-	sa.sin_family = PF_INET;
-	sa.sin_port = htons(port);
-	int m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+void RPCValue::getStats(StatsTable& stats) {
+	if (socket == NULL && m_shm == NULL) {
+		server_stats(stats);
+		return;
+	}
 
-	bind(m_socket, (sockaddr *)&sa, sizeof(sockaddr_in));
-	
-	listen(m_socket, connections);
+	CallStatsMap::const_iterator it = m_call_stats.begin(),
+		end = m_call_stats.end();
 
-	int kill_me=0;
+	for (; it != end; ++it) {
+		stats.push_back(::std::make_pair(it->first, it->second->snapshot()));
+	}
+}
 
-	wait_process.init();
+/**
+ * Body of the reader thread, files each reply under its id and wakes
+ * whoever waits for it
+ */
+void* RPCValue::readReplies(void* arg) {
+	RPCValue* rv = static_cast<RPCValue*>(arg);
 
-	do {
-		struct sockaddr client_name;
-		socklen_t client_name_len;
-		int client_socket_id;
-		int type_call;
-		type_call=client_name_len=0;
-
-		memset(&client_name, 0, sizeof(client_name));
-		
-		printer.printMsg("Waiting client...\n");
-
-		client_socket_id = accept (m_socket, &client_name, &client_name_len);
-		
-		printer.printMsg("New client...\n");
-		
-		
-		if (recv (client_socket_id, &type_call, sizeof (type_call), 0) == 0){
-			close (client_socket_id);
-			
-			continue;
-		}
-		
+	while (true) {
+		RPCFrameHeader header;
+		::std::vector<char> body;
 
-		if(type_call == CLEVER_RPC_KILL) {
-			printer.printMsg("Server died...\n");
-			
-			while(recv (client_socket_id, &type_call, sizeof (type_call), 0)!=0);
-			close (client_socket_id);
-			
-			kill_me = 1;
-		}else {
-			createConnection(client_socket_id);
-			printer.printMsg("Client connected...\n");
-			int ok=CLEVER_RPC_OK;
-			send(client_socket_id,(char*)(&ok),sizeof(ok));
+		if (!rv->receiveAll((char*)(&header), sizeof(header)) || header.length < 0) {
+			break;
 		}
-		
-	} while (!kill_me);
-
-	wait_process.wait();
-	close (m_socket);
-
-}
 
-bool RPCValue::createClient(const char* host, const int port, const int time) {
-	socket = new CSocket;
+		body.resize(header.length);
 
-	socket->setHost(host);
-	socket->setPort(port);
-	socket->setTimeout(time);
+		if (header.length > 0 && !rv->receiveAll(&body[0], header.length)) {
+			break;
+		}
 
-	int t=0;
+		rv->m_reply_mutex.lock();
+		rv->replyArrived(header.id, header.length);
 
-	fprintf(stderr,"Connecting.");
-	while (t<time) {
-		if (socket->connect()) {
-			fprintf(stderr,"\n");
-			return true;
+		if (rv->m_discarded.erase(header.id) == 0) {
+			rv->m_replies[header.id].swap(body);
+			rv->m_reply_arrived.broadcast();
 		}
-		fprintf(stderr,".");
-		sleep(1);
+		rv->m_reply_mutex.unlock();
 	}
-	clever_fatal("[RPC] Failed to connect with RPC server!");
-	return false;
-}
 
-void RPCValue::sendString(const char* s, int len) {
-	int id=CLEVER_RPC_PS;
+	rv->m_reply_mutex.lock();
+	rv->m_reader_done = true;
+	rv->m_reply_arrived.broadcast();
+	rv->m_reply_mutex.unlock();
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&len),sizeof(len));
-	socket->send(s,len);
+	return NULL;
 }
 
-void RPCValue::sendInteger(int v) {
-	int id=CLEVER_RPC_PI;
+bool RPCValue::replyReady(int id) {
+	m_reply_mutex.lock();
+	bool ready = m_replies.find(id) != m_replies.end();
+	m_reply_mutex.unlock();
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&v),sizeof(v));
+	return ready;
 }
 
-void RPCValue::sendKill() {
-	int id=CLEVER_RPC_KILL;
-
-	socket->send((char*)(&id),sizeof(id));
-}
+int RPCValue::waitReplies(const ::std::vector<int>& ids, bool all, double timeout) {
+	struct timeval start, now;
+	int found = -1;
 
-bool RPCValue::sendInit() {
-	int id=CLEVER_RPC_INIT;
+	if (ids.empty()) {
+		return all ? 0 : -1;
+	}
 
-	socket->send((char*)(&id),sizeof(id));
+	gettimeofday(&start, NULL);
 
-	int ok;
+	m_reply_mutex.lock();
+	while (true) {
+		size_t ready = 0;
+
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (m_replies.find(ids[i]) != m_replies.end()) {
+				++ready;
+				if (!all) {
+					found = i;
+					break;
+				}
+			}
+		}
 
-	if(!socket->receive((char*)(&ok),sizeof(ok))) {
-		return false;
-	}
+		if (all && ready == ids.size()) {
+			found = 0;
+		}
 
-	return true;
-}
+		if (found >= 0 || m_reader_done || !m_reader_running) {
+			break;
+		}
 
-void RPCValue::sendFunctionCall(const char* fname, const char* args, int len_fname, int n_args, int len_args){
-	int id=CLEVER_RPC_FC;
+		gettimeofday(&now, NULL);
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&len_fname),sizeof(len_fname));
-	socket->send(fname,len_fname);
-	socket->send((char*)(&n_args),sizeof(n_args));
+		double left = timeout - (now.tv_sec - start.tv_sec)
+			- (now.tv_usec - start.tv_usec) / 1e6;
 
-	if(n_args>0){
-		socket->send((char*)(&len_args),sizeof(len_args));
-		socket->send(args,len_args);
+		if (timeout < 0) {
+			m_reply_arrived.wait(m_reply_mutex);
+		} else if (left > 0) {
+			m_reply_arrived.wait(m_reply_mutex, left);
+		} else {
+			break;
+		}
 	}
+	m_reply_mutex.unlock();
 
+	return found;
+}
+
+void RPCValue::discardReply(int id) {
+	m_reply_mutex.lock();
+	if (m_replies.erase(id) == 0 && m_reader_running && !m_reader_done) {
+		m_discarded.insert(id);
+	}
+	m_reply_mutex.unlock();
 }
 
 void RPCValue::sendProcessCall(int id_process, const char* fname, const char* args, int len_fname, int n_args, int len_args){
-	int id = CLEVER_RPC_PC;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_process),sizeof(id_process));
-	socket->send((char*)(&len_fname),sizeof(len_fname));
-	socket->send(fname,len_fname);
-	socket->send((char*)(&n_args),sizeof(n_args));
+	append(payload, &id_process, sizeof(id_process));
+	append(payload, &len_fname, sizeof(len_fname));
+	append(payload, fname, len_fname);
+	append(payload, &n_args, sizeof(n_args));
 
 	if(n_args>0){
-		socket->send((char*)(&len_args),sizeof(len_args));
-		socket->send(args,len_args);
+		append(payload, &len_args, sizeof(len_args));
+		append(payload, args, len_args);
 	}
 
+	sendRequest(CLEVER_RPC_PC, payload, false);
 }
 
 void RPCValue::sendInteger(int id_message, int v) {
-	int id = CLEVER_RPC_RI;
+	::std::vector<char> payload;
+
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &v, sizeof(v));
 
-	socket->send((char*)(&id),sizeof(int));
-	socket->send((char*)(&id_message),sizeof(int));
-	socket->send((char*)(&v),sizeof(int));
+	sendRequest(CLEVER_RPC_RI, payload, false);
 }
 
 int RPCValue::receiveInt(int id_message, double time_sleep) {
-	int id = CLEVER_RPC_SI;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&time_sleep),sizeof(time_sleep));
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &time_sleep, sizeof(time_sleep));
 
 	int v;
 	int type;
 
-	if(!socket->receive((char*)(&type),sizeof(type))) {
+	if(!waitReply(sendRequest(CLEVER_RPC_SI, payload, true))
+		|| !receive((char*)(&type),sizeof(type))) {
 		clever_fatal("[RPC] Failed to receive int!\n");
 		return 0;
 	}
@@ -1222,30 +3011,31 @@ int RPCValue::receiveInt(int id_message, double time_sleep) {
 		return 0;
 	}
 
-	socket->receive((char*)(&v),sizeof(v));
+	receive((char*)(&v),sizeof(v));
 
 	return v;
 }
 
 void RPCValue::sendDouble(int id_message, double v) {
-	int id = CLEVER_RPC_RD;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&v),sizeof(v));
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &v, sizeof(v));
+
+	sendRequest(CLEVER_RPC_RD, payload, false);
 }
 
 double RPCValue::receiveDouble(int id_message, double time_sleep) {
-	int id = CLEVER_RPC_SD;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&time_sleep),sizeof(time_sleep));
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &time_sleep, sizeof(time_sleep));
 
 	double v;
 	int type;
 
-	if(!socket->receive((char*)(&type),sizeof(type))) {
+	if(!waitReply(sendRequest(CLEVER_RPC_SD, payload, true))
+		|| !receive((char*)(&type),sizeof(type))) {
 		clever_fatal("[RPC] Failed to receive double!\n");
 		return 0;
 	}
@@ -1255,33 +3045,34 @@ double RPCValue::receiveDouble(int id_message, double time_sleep) {
 		return 0;
 	}
 
-	socket->receive((char*)(&v),sizeof(v));
+	receive((char*)(&v),sizeof(v));
 
 	return v;
 }
 
 void RPCValue::sendString(int id_message, const char* s, int len) {
-	int id = CLEVER_RPC_RS;
+	::std::vector<char> payload;
+
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &len, sizeof(len));
+	append(payload, s, len);
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&len),sizeof(len));
-	socket->send(s,len);
+	sendRequest(CLEVER_RPC_RS, payload, false);
 }
 
 ::std::string RPCValue::receiveString(int id_message, double time_sleep) {
-	int id = CLEVER_RPC_SS;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&time_sleep),sizeof(time_sleep));
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &time_sleep, sizeof(time_sleep));
 
 	char* buffer;
 	::std::string v;
 	int len;
 	int type;
 
-	if(!socket->receive((char*)(&type),sizeof(type))) {
+	if(!waitReply(sendRequest(CLEVER_RPC_SS, payload, true))
+		|| !receive((char*)(&type),sizeof(type))) {
 		clever_fatal("[RPC] Failed to receive String!\n");
 		return 0;
 	}
@@ -1291,13 +3082,11 @@ void RPCValue::sendString(int id_message, const char* s, int len) {
 		return 0;
 	}
 
-	socket->receive((char*)(&len),sizeof(len));
+	receive((char*)(&len),sizeof(len));
 
-	g_mutex.lock();
 	buffer = (char*)malloc((len+1));
-	g_mutex.unlock();
 
-	socket->receive(buffer,len);
+	receive(buffer,len);
 	buffer[len]='\0';
 	v=buffer;
 	free(buffer);
@@ -1307,27 +3096,28 @@ void RPCValue::sendString(int id_message, const char* s, int len) {
 
 
 void RPCValue::sendObject(int id_message, const char* s, int len) {
-	int id = CLEVER_RPC_RO;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&len),sizeof(len));
-	socket->send(s,len);
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &len, sizeof(len));
+	append(payload, s, len);
+
+	sendRequest(CLEVER_RPC_RO, payload, false);
 }
 
 RPCObjectValue* RPCValue::receiveObject(int id_message, double time_sleep) {
-	int id = CLEVER_RPC_SO;
+	::std::vector<char> payload;
 
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_message),sizeof(id_message));
-	socket->send((char*)(&time_sleep),sizeof(time_sleep));
+	append(payload, &id_message, sizeof(id_message));
+	append(payload, &time_sleep, sizeof(time_sleep));
 
 	char* buffer;
 	RPCObjectValue* obj =  new RPCObjectValue;
 	int len;
 	int type;
 
-	if(!socket->receive((char*)(&type),sizeof(type))) {
+	if(!waitReply(sendRequest(CLEVER_RPC_SO, payload, true))
+		|| !receive((char*)(&type),sizeof(type))) {
 		clever_fatal("[RPC] Failed to receive Object!\n");
 		return 0;
 	}
@@ -1337,13 +3127,11 @@ RPCObjectValue* RPCValue::receiveObject(int id_message, double time_sleep) {
 		return 0;
 	}
 
-	socket->receive((char*)(&len),sizeof(len));
+	receive((char*)(&len),sizeof(len));
 
-	g_mutex.lock();
 	buffer = (char*)malloc(len);
-	g_mutex.unlock();
 
-	socket->receive(buffer,len);
+	receive(buffer,len);
 
 	obj->type = 'p';
 	obj->size = len;
@@ -1353,14 +3141,24 @@ RPCObjectValue* RPCValue::receiveObject(int id_message, double time_sleep) {
 }
 
 RPCObjectValue* RPCValue::getResultProcess(int id_process, double time_sleep) {
-	int id = CLEVER_RPC_GR;
-	socket->send((char*)(&id),sizeof(id));
-	socket->send((char*)(&id_process),sizeof(id_process));
-	socket->send((char*)(&time_sleep),sizeof(time_sleep));
+	::std::vector<char> payload;
+
+	append(payload, &id_process, sizeof(id_process));
+	append(payload, &time_sleep, sizeof(time_sleep));
+
+	sendRequest(CLEVER_RPC_GR, payload, true);
+
 	return receiveObject();
 }
 
+/**
+ * Reads the typed result of the last request expecting a reply
+ */
 RPCObjectValue* RPCValue::receiveObject(){
+	return receiveResult(m_last_id);
+}
+
+RPCObjectValue* RPCValue::receiveResult(int id){
 	RPCObjectValue* obj =  new RPCObjectValue;
 	int len, len_s;
 	len = sizeof(len);
@@ -1370,7 +3168,7 @@ RPCObjectValue* RPCValue::receiveObject(){
 	char* vc, *buffer;
 	double* vd;
 
-	if(!socket->receive((char*)type,len)){
+	if(!waitReply(id) || !receive((char*)type,len)){
 		clever_fatal("[RPC] Failed to receive object!\n");
 	}
 
@@ -1382,7 +3180,7 @@ RPCObjectValue* RPCValue::receiveObject(){
 		case 'i':
 			{
 				vi = (int*) malloc(sizeof(len));
-				socket->receive((char*)vi,sizeof(len));
+				receive((char*)vi,sizeof(len));
 				obj->size = sizeof(len);
 				obj->pointer=vi;
 			}
@@ -1391,7 +3189,7 @@ RPCObjectValue* RPCValue::receiveObject(){
 		case 'd':
 			{
 				vd = (double*) malloc(sizeof(double));
-				socket->receive((char*)vd,sizeof(double));
+				receive((char*)vd,sizeof(double));
 				obj->size = sizeof(double);
 				obj->pointer=vd;
 			}
@@ -1400,7 +3198,7 @@ RPCObjectValue* RPCValue::receiveObject(){
 		case 'c': case 'b':
 			{
 				vc = (char*) malloc(sizeof(char));
-				socket->receive((char*)vc,sizeof(char));
+				receive((char*)vc,sizeof(char));
 				obj->size = sizeof(char);
 				obj->pointer=vc;
 			}
@@ -1408,11 +3206,11 @@ RPCObjectValue* RPCValue::receiveObject(){
 
 		case 'p': case 's':
 			{
-				socket->receive((char*)(&len_s),sizeof(int));
+				receive((char*)(&len_s),sizeof(int));
 
 				buffer = (char*) malloc(len_s*sizeof(char));
 
-				socket->receive(buffer,len_s);
+				receive(buffer,len_s);
 
 				obj->size = len_s;
 				obj->pointer = buffer;
@@ -1420,11 +3218,72 @@ RPCObjectValue* RPCValue::receiveObject(){
 		break;
 	}
 
+	// Without frames the reply is only read here
+	if (!m_framed) {
+		replyArrived(id, sizeof(*type) + obj->size
+			+ (obj->type == 'p' || obj->type == 's' ? sizeof(len_s) : 0));
+	}
+
 	free(type);
 
 	return obj;
 }
 
-}}}} // clever::packages::std::rpc
+void RPCValue::joinGroup(int rank, int size, int group) {
+	if (size <= 0 || rank < 0 || rank >= size) {
+		clever_fatal("[RPC] Invalid rank %i in a group of %i!\n", rank, size);
+	}
+
+	m_rank = rank;
+	m_group_size = size;
+	m_group = group;
+	m_group_seq = 0;
+}
 
+void RPCValue::collective(int op, int root, int reduce, int type,
+		const char* data, int length, ::std::vector<char>& result) {
+	if (m_group_size == 0) {
+		clever_fatal("[RPC] joinGroup() must be called before a collective operation!\n");
+	}
+
+	RPCCollectiveHeader header;
+	::std::vector<char> payload;
+
+	header.op = op;
+	header.group = m_group;
+	header.seq = m_group_seq++;
+	header.rank = m_rank;
+	header.size = m_group_size;
+	header.root = root;
+	header.reduce = reduce;
+	header.type = type;
+	header.length = length;
+
+	payload.reserve(sizeof(header) + length);
+	append(payload, &header, sizeof(header));
+	append(payload, data, length);
+
+	int rtype;
+	int len;
+
+	if (!waitReply(sendRequest(CLEVER_RPC_CO, payload, true))
+		|| !receive((char*)(&rtype), sizeof(rtype))) {
+		clever_fatal("[RPC] Failed to receive the collective result!\n");
+	}
 
+	// 'v' when the ranks disagree on the operation
+	if (rtype != 'p') {
+		clever_fatal("[RPC] Collective operation %i of group %i failed!\n",
+			header.seq, m_group);
+	}
+
+	receive((char*)(&len), sizeof(len));
+
+	result.resize(len);
+
+	if (len > 0) {
+		receive(&result[0], len);
+	}
+}
+
+}}}} // clever::packages::std::rpc
@@ -30,9 +30,14 @@
 #include <string>
 #include <pthread.h>
 #include <map>
+#include <set>
+#include <vector>
 #include "compiler/datavalue.h"
 
 #include "modules/std/net/csocket.h"
+#include "modules/std/rpc/rpcshm.h"
+#include "modules/std/rpc/rpcstats.h"
+#include "modules/std/rpc/rpcsync.h"
 #include "modules/std/rpc/rpcobjectvalue.h"
 
 //Function call
@@ -69,6 +74,31 @@
 #define CLEVER_RPC_SO 0x16
 //Object received
 #define CLEVER_RPC_OR 0x17
+//Init command, framed protocol
+#define CLEVER_RPC_INIT2 0x18
+//Connection accepted, framed protocol
+#define CLEVER_RPC_OK2 0x19
+//Frame carrying a sequence of frames
+#define CLEVER_RPC_BATCH 0x20
+//Collective operation of a group of clients
+#define CLEVER_RPC_CO 0x21
+
+//Collective operations
+#define CLEVER_RPC_BARRIER 0x1
+#define CLEVER_RPC_BROADCAST 0x2
+#define CLEVER_RPC_SCATTER 0x3
+#define CLEVER_RPC_GATHER 0x4
+#define CLEVER_RPC_ALLGATHER 0x5
+#define CLEVER_RPC_REDUCE 0x6
+#define CLEVER_RPC_ALLREDUCE 0x7
+
+//Reduction operators
+#define CLEVER_RPC_SUM 0x1
+#define CLEVER_RPC_MIN 0x2
+#define CLEVER_RPC_MAX 0x3
+
+//Frame flag: reply to the request with the same id
+#define CLEVER_RPC_FLAG_REPLY 0x1
 
 namespace clever { namespace packages { namespace std { namespace rpc {
 
@@ -76,14 +106,63 @@ namespace clever { namespace packages { namespace std { namespace rpc {
 typedef ::std::map< ::std::string, void*> ExtMap;
 typedef ::std::map< ::std::string, ::std::string> FuncMap;
 
+/**
+ * Header of a framed (v2) message. The payload that follows holds the
+ * same fields a v1 request carries after its code; a reply holds the
+ * result as v1 sends it
+ */
+struct RPCFrameHeader {
+	int length;
+	int type;
+	int id;
+	int flags;
+};
+
+/**
+ * Payload of a collective request, the contribution of the rank
+ * follows. Elements are 'i' (64 bit integers), 'd' (doubles) or 's'
+ * (bytes of a string)
+ */
+struct RPCCollectiveHeader {
+	int op;
+	int group;
+	// Position of the operation among the group's collectives
+	int seq;
+	int rank;
+	int size;
+	int root;
+	int reduce;
+	int type;
+	int length;
+};
+
 class RPCValue : public DataValue {
 
 public:
 
-	RPCValue() { socket = NULL; }
+	RPCValue()
+		: socket(NULL), m_shm(NULL), m_framed(false), m_batching(false),
+			m_next_id(0), m_last_id(0), m_reply_pos(0), m_reply_left(0),
+			m_rank(0), m_group_size(0), m_group(0), m_group_seq(0),
+			m_reader_running(false), m_reader_done(false) {}
+
+	/**
+	 * Serves clients until a KILL arrives. workers threads run the
+	 * callProcess() requests and each worker queue holds queue_size
+	 * calls, 0 picks the defaults
+	 */
+	void createServer(int port, int connections, int workers=0, int queue_size=0);
 
-	void createServer(int port, int connections);
+	/**
+	 * Same, address is either a port or shm://name. A shared memory
+	 * server has room for connections clients of this host
+	 */
+	void createServer(const char* address, int connections, int workers=0, int queue_size=0);
 
+	/**
+	 * host may be shm://name to reach a server on this host through
+	 * shared memory, port is not used then
+	 */
 	bool createClient(const char* host, const int port, const int time);
 
 	void loadLibrary(const char* libname);
@@ -105,27 +184,127 @@ public:
 	void sendKill();
 	bool sendInit();
 
+	/* Requests that need no reply are queued until endBatch() or the
+	   next request waiting for a reply, then sent in a single frame */
+	void beginBatch();
+	void endBatch();
+
 	RPCObjectValue* getResultProcess(int id_process, double time_sleep);
 	RPCObjectValue* receiveObject();
 
+	/* Asynchronous calls: the request goes out at once and its id is
+	   returned. The first one starts a thread that reads every reply
+	   of the connection from then on */
+	int sendAsyncCall(const char* fname, const char* args, int len_fname, int n_args, int len_args);
+	bool replyReady(int id);
+
+	/**
+	 * Waits up to timeout seconds, without limit when negative, for
+	 * the replies to all the ids or to any of them. Returns the index
+	 * of a reply received, 0 when all were asked for, -1 otherwise
+	 */
+	int waitReplies(const ::std::vector<int>& ids, bool all, double timeout);
+
+	/* The result of the call id, receiveObject() returns the result
+	   of the last call */
+	RPCObjectValue* receiveResult(int id);
+
+	/* Nobody will ask for the reply to id */
+	void discardReply(int id);
+
 	/* Receive objects from another clients */
 	RPCObjectValue* receiveObject(int id_message, double time_sleep);
 	int receiveInt(int id_message, double time_sleep);
 	double receiveDouble(int id_message, double time_sleep);
 	::std::string receiveString(int id_message, double time_sleep);
 
+	/* Collectives: every rank of the group makes the same calls in the
+	   same order, the server combines the contributions and each rank
+	   receives its part of the result */
+	void joinGroup(int rank, int size, int group);
+	void collective(int op, int root, int reduce, int type,
+		const char* data, int length, ::std::vector<char>& result);
+
+	int getRank() const { return m_rank; }
+
+	/* Per function counters: of the calls made through this connection
+	   on a client, of the calls served by this process otherwise */
+	void getStats(StatsTable& stats);
+
 	CSocket* getSocket() { return this->socket; }
 
 	bool valid() const {
-		return socket != NULL;
+		return socket != NULL || m_shm != NULL;
 	}
 
 	~RPCValue();
 
 private:
 
+	typedef ::std::map<int, ::std::vector<char> > ReplyMap;
+	typedef ::std::map< ::std::string, CallStats*> CallStatsMap;
+
+	// A call whose reply has not arrived yet
+	struct PendingCall {
+		CallStats* stats;
+		uint64_t start;
+	};
+
+	int sendRequest(int type, const ::std::vector<char>& payload, bool reply);
+	bool writeFrame(RPCFrameHeader* header, const char* payload);
+	bool waitReply(int id);
+	bool skipReply();
+	bool receive(char* buffer, int length);
+
+	void sendCall(const char* fname, const char* args, int len_fname, int n_args, int len_args);
+	static void* readReplies(void* arg);
+	void replyArrived(int id, size_t bytes);
+
+	// The transport, a socket or a shared memory connection
+	bool transmit(struct iovec* iov, int n);
+	bool transmit(const char* buffer, int length);
+	bool receiveAll(char* buffer, int length);
+
 	CSocket* socket;
-	void createConnection(int client_socket_id);
+	ShmClient* m_shm;
+
+	// Framed protocol negotiated by sendInit()
+	bool m_framed;
+	bool m_batching;
+	::std::vector<char> m_batch;
+
+	int m_next_id;
+	// Id of the last request that expects a reply
+	int m_last_id;
+
+	// Replies received while waiting for another id
+	ReplyMap m_replies;
+	::std::vector<char> m_reply;
+	size_t m_reply_pos;
+	// Bytes of the reply being waited for still in the transport
+	size_t m_reply_left;
+
+	// Group joined by joinGroup() and the collectives it ran
+	int m_rank;
+	int m_group_size;
+	int m_group;
+	int m_group_seq;
+
+	// Reader thread started by the first asynchronous call, it keeps
+	// the replies in m_replies
+	pthread_t m_reader;
+	bool m_reader_running;
+	// The transport failed or was closed, no more replies will come
+	bool m_reader_done;
+	// Replies to drop as they arrive
+	::std::set<int> m_discarded;
+	Mutex m_reply_mutex;
+	Condition m_reply_arrived;
+
+	// Calls made by function name, and the calls in flight by id; the
+	// reader thread uses m_pending under m_reply_mutex
+	CallStatsMap m_call_stats;
+	::std::map<int, PendingCall> m_pending;
 };
 
 }}}} // clever::packages::std::rpc
@@ -26,6 +26,10 @@
 #include "types/type.h"
 #include "types/array.h"
 #include "types/arrayiteratorvalue.h"
+#include "types/streamvalue.h"
+#include "types/functionvalue.h"
+#include "types/workpool.h"
+#include "vm/callback.h"
 #include "compiler/compiler.h"
 
 namespace clever {
@@ -49,8 +53,11 @@ CLEVER_METHOD(Array::do_assign) {
  * Void Array<T>::push(T)
  */
 CLEVER_METHOD(Array::push) {
-	ValueVector* vec = CLEVER_GET_ARRAY(CLEVER_THIS());
 	ArrayValue* av = CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS());
+
+	av->detach();
+
+	ValueVector* vec = av->getArray();
 	
 	// Push changes the Array's version
 	av->changeVersion();
@@ -65,8 +72,11 @@ CLEVER_METHOD(Array::push) {
  * T Array<T>::pop()
  */
 CLEVER_METHOD(Array::pop) {
-	ValueVector* vec = CLEVER_GET_ARRAY(CLEVER_THIS());
 	ArrayValue* av = CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS());
+
+	av->detach();
+
+	ValueVector* vec = av->getArray();
 	
 	// Pop changes the Array's version
 	av->changeVersion();
@@ -111,8 +121,11 @@ CLEVER_METHOD(Array::isEmpty) {
  * Void Array<T>::clear()
  */
 CLEVER_METHOD(Array::clear) {
-	ValueVector* vec = CLEVER_GET_ARRAY(CLEVER_THIS());
 	ArrayValue* av = CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS());
+
+	av->detach();
+
+	ValueVector* vec = av->getArray();
 	
 	// Clear changes the Array's version
 	av->changeVersion();
@@ -165,7 +178,11 @@ CLEVER_METHOD(Array::at) {
  * Void Array<T>::set(Int, T)
  */
 CLEVER_METHOD(Array::set) {
-	ValueVector* vec = CLEVER_GET_ARRAY(CLEVER_THIS());
+	ArrayValue* av = CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS());
+
+	av->detach();
+
+	ValueVector* vec = av->getArray();
 	int64_t idx = CLEVER_ARG(0)->getInteger();
 	uint64_t uidx = static_cast<uint64_t>(idx);
 	int is_in_range = uidx < vec->max_size() && uidx < vec->size() && idx >= 0;
@@ -198,7 +215,11 @@ CLEVER_METHOD(Array::set) {
  * Void Array<T>::resize()
  */
 CLEVER_METHOD(Array::resize) {
-	ValueVector* vec = CLEVER_GET_ARRAY(CLEVER_THIS());
+	ArrayValue* av = CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS());
+
+	av->detach();
+
+	ValueVector* vec = av->getArray();
 	int64_t nsz = CLEVER_ARG(0)->getInteger();
 	size_t sz = vec->size();
 
@@ -247,6 +268,13 @@ CLEVER_METHOD(Array::slice) {
 		r_end = r_start + length;
 	}
 
+	// Slicing the whole Array just shares its elements
+	if (r_start == 0 && r_end == (int64_t) sz) {
+		CLEVER_RETURN_DATA_VALUE(
+			new ArrayValue(CLEVER_GET_VALUE(ArrayValue*, CLEVER_THIS())));
+		return;
+	}
+
 	ValueVector* n_vec = new ValueVector;
 
 	if (r_start >= (int64_t) sz) {
@@ -259,10 +287,10 @@ CLEVER_METHOD(Array::slice) {
 		Compiler::warningf("The length param value (%l) must be valid.", length);
 	}
 	else {
+		// Elements are replaced, never changed, so they can be shared
 		for (int64_t i = r_start; i < r_end; ++i) {
-			Value* val = new Value();
-			val->copy(vec->at(i));
-			n_vec->push_back(val);
+			vec->at(i)->addRef();
+			n_vec->push_back(vec->at(i));
 		}
 	}
 
@@ -301,7 +329,8 @@ CLEVER_METHOD(Array::find) {
 
 	// Gets the method
 	const Method* const method =
-		CLEVER_THIS_ARG(0)->getMethod(CSTRING(CLEVER_OPERATOR_EQUAL), &tv);
+		CLEVER_THIS_ARG(0)->getMethod(
+			CACHE_PTR(CLEVER_OP_EQUAL, CLEVER_OPERATOR_EQUAL), &tv);
 
 	Value ret;
 	int64_t pos = -1;
@@ -363,6 +392,86 @@ CLEVER_METHOD(Array::end) {
 	CLEVER_RETURN_DATA_VALUE(aiv);
 }
 
+/**
+ * Stream<T> Array<T>::stream()
+ * Returns a lazy map/filter pipeline over this array
+ */
+CLEVER_METHOD(Array::stream) {
+	CLEVER_RETURN_DATA_VALUE(new StreamValue(CLEVER_THIS()));
+}
+
+/**
+ * Elements per chunk handed to the work pool by parallelMap()
+ */
+#define CLEVER_PARALLEL_CHUNK 4096
+
+struct ParallelMap {
+	const Function* func;
+	const ValueVector* src;
+	ValueVector* dst;
+};
+
+/**
+ * Maps a slice of the source into the same slots of the result
+ */
+static void _parallel_map_range(size_t begin, size_t end, size_t worker,
+	void* data) {
+	ParallelMap* job = static_cast<ParallelMap*>(data);
+	ValueVector args(1);
+
+	for (size_t i = begin; i < end; ++i) {
+		Value* val = new Value;
+
+		args[0] = job->src->at(i);
+		job->func->call(&args, val);
+		(*job->dst)[i] = val;
+	}
+}
+
+/**
+ * Array<T> Array<T>::parallelMap(Function<T, T> func)
+ * Returns a new array with func applied to each element. Natives marked
+ * thread safe run across the work pool over Int, Double and Bool; anything
+ * else may report errors or need the VM, which is single-threaded, so it
+ * runs sequentially
+ */
+CLEVER_METHOD(Array::parallelMap) {
+	FunctionValue* fv = CLEVER_GET_VALUE(FunctionValue*, CLEVER_ARG(0));
+	const ValueVector* src = CLEVER_GET_ARRAY(CLEVER_THIS());
+	const Type* type = CLEVER_THIS_ARG(0);
+	ValueVector* dst = new ValueVector(src->size(), static_cast<Value*>(NULL));
+
+	if (!fv->valid()) {
+		Compiler::warningf("Passing an invalid %S to parallelMap.",
+			CLEVER_ARG(0)->getTypePtr()->getName());
+		dst->clear();
+		CLEVER_RETURN_ARRAY(dst);
+		return;
+	}
+
+	const Function* func = fv->getFunction();
+
+	if (func->isInternal() && func->isThreadSafe()
+		&& (type == CLEVER_INT || type == CLEVER_DOUBLE || type == CLEVER_BOOL)) {
+		ParallelMap job = { func, src, dst };
+
+		WorkPool::run(src->size(), CLEVER_PARALLEL_CHUNK, _parallel_map_range,
+			&job);
+	} else {
+		Callback callback(func);
+
+		for (size_t i = 0, j = src->size(); i < j; ++i) {
+			Value* val = new Value;
+
+			callback.setArg(0, src->at(i));
+			callback.call(val);
+			(*dst)[i] = val;
+		}
+	}
+
+	CLEVER_RETURN_ARRAY(dst);
+}
+
 /**
  * Array type initializator
  */
@@ -443,6 +552,17 @@ void Array::init() {
 	
 	addMethod(new Method("begin", &Array::begin, iter_type));
 	addMethod(new Method("end", &Array::end, iter_type));
+
+	addMethod(new Method("stream", &Array::stream,
+		static_cast<const TemplatedType*>(CLEVER_TYPE("Stream"))
+			->getTemplatedType(CLEVER_TPL_ARG(0))));
+
+	TemplateArgs map_args(2, CLEVER_TPL_ARG(0));
+
+	addMethod((new Method("parallelMap", &Array::parallelMap, arr_t))
+		->addArg("func", static_cast<const TemplatedType*>(
+			CLEVER_TYPE("Function"))->getTemplatedType(map_args))
+	);
 }
 
 DataValue* Array::allocateValue() const {
@@ -452,21 +572,25 @@ DataValue* Array::allocateValue() const {
 /**
  * Performs the shallow and deep copy
  */
+/**
+ * Copies share the elements until one of the Arrays is changed. A deep
+ * copy only needs its own elements when they aren't primitive values.
+ */
 DataValue* Array::copy(const Value* orig, bool deep) const {
+	ArrayValue* source = CLEVER_GET_VALUE(ArrayValue*, orig);
+
+	if (!deep || CLEVER_TPL_ARG(0)->getKind() == Type::PRIMITIVE) {
+		return static_cast<DataValue*>(new ArrayValue(source));
+	}
+
 	ArrayValue* array = new ArrayValue;
-	ValueVector* vec = CLEVER_GET_ARRAY(orig);
+	ValueVector* vec = source->getArray();
 	
 	for (size_t i = 0, j = vec->size(); i < j; ++i) {
-		if (deep) {
-			Value* val = new Value;
+		Value* val = new Value;
 
-			val->deepCopy(vec->at(i));
-			array->m_array->push_back(val);
-		} else {
-			Value* val = vec->at(i);
-			array->m_array->push_back(val);
-			val->addRef();
-		}
+		val->deepCopy(vec->at(i));
+		array->m_array->push_back(val);
 	}
 
 	return static_cast<DataValue*>(array);
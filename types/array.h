@@ -33,6 +33,7 @@
 #include "compiler/scope.h"
 #include "types/arrayvalue.h"
 #include "types/arrayiterator.h"
+#include "types/stream.h"
 
 #define CLEVER_RETURN_ARRAY(x) retval->setDataValue(new ArrayValue(x))
 #define CLEVER_GET_ARRAY(x)    static_cast<ArrayValue*>((x)->getDataValue())->m_array
@@ -50,6 +51,10 @@ public:
 		Type* array_iter = new ArrayIterator;
 		g_scope.pushType(CSTRING("ArrayIterator"), array_iter);
 		array_iter->init();
+
+		Type* stream = new Stream;
+		g_scope.pushType(CSTRING("Stream"), stream);
+		stream->init();
 	}
 
 	Array(const CString* name, const Type* arg_type) :
@@ -100,14 +105,8 @@ public:
 	DataValue* allocateValue() const;
 	DataValue* copy(const Value*, bool) const;
 
-	void destructor(Value* value) const {
-		ValueVector* vec = CLEVER_GET_ARRAY(value);
-
-		size_t sz = vec->size();
-		for (size_t i = 0; i < sz; ++i) {
-			vec->at(i)->delRef();
-		}
-	}
+	// The elements are released by ArrayData, which may be shared
+	void destructor(Value* value) const { }
 
 	/**
 	 * Type methods
@@ -129,6 +128,8 @@ public:
 	static CLEVER_METHOD(constructor);
 	static CLEVER_METHOD(begin);
 	static CLEVER_METHOD(end);
+	static CLEVER_METHOD(stream);
+	static CLEVER_METHOD(parallelMap);
 private:
 	DISALLOW_COPY_AND_ASSIGN(Array);
 };
@@ -67,8 +67,24 @@ struct ArrayIteratorValue : public DataValue {
 		return *m_iterator;
 	}
 	
+	/**
+	 * Replaces the current element, the Array gets its own elements
+	 * first when they are shared with a copy
+	 */
 	void setValue(Value* v) {
-		(*m_iterator)->copy(v);
+		if (m_array->isShared()) {
+			size_t offset = m_iterator - m_array->m_array->begin();
+
+			m_array->detach();
+			m_iterator = m_array->m_array->begin() + offset;
+			m_array_version = m_array->getVersion();
+		}
+
+		Value* value = new Value;
+
+		value->copy(v);
+		(*m_iterator)->delRef();
+		*m_iterator = value;
 	}
 	
 	void setIterator(ValueVector::iterator& it) {
@@ -30,14 +30,46 @@
 
 namespace clever {
 
+/**
+ * Array elements, shared by the copies of an Array until one of them is
+ * changed (copy-on-write)
+ */
+struct ArrayData : public RefCounted {
+	explicit ArrayData(ValueVector* array)
+		: RefCounted(1), m_array(array) {}
+
+	~ArrayData() {
+		for (size_t i = 0, j = m_array->size(); i < j; ++i) {
+			m_array->at(i)->delRef();
+		}
+		delete m_array;
+	}
+
+	ValueVector* m_array;
+private:
+	DISALLOW_COPY_AND_ASSIGN(ArrayData);
+};
+
 struct ArrayValue : public DataValue
 {
 	ValueVector* m_array;
 	uint32_t m_version;
 
-	ArrayValue() : m_array(new ValueVector), m_version(0) {}
-	ArrayValue(ValueVector* array) : m_array(array), m_version(0) {}
-	
+	ArrayValue()
+		: m_array(new ValueVector), m_version(0),
+			m_data(new ArrayData(m_array)) {}
+
+	ArrayValue(ValueVector* array)
+		: m_array(array), m_version(0), m_data(new ArrayData(array)) {}
+
+	/**
+	 * Creates an Array sharing the elements of another one
+	 */
+	explicit ArrayValue(ArrayValue* other)
+		: m_array(other->m_array), m_version(0), m_data(other->m_data) {
+		m_data->addRef();
+	}
+
 	ValueVector* getArray() const {
 		return m_array;
 	}
@@ -54,9 +86,40 @@ struct ArrayValue : public DataValue
 		m_version++;
 	}
 
+	bool isShared() const {
+		return m_data->refCount() > 1;
+	}
+
+	/**
+	 * Must be called before changing the elements, so that an Array
+	 * sharing them gets its own copy first
+	 */
+	void detach() {
+		if (EXPECTED(m_data->refCount() == 1)) {
+			return;
+		}
+
+		ValueVector* array = new ValueVector(*m_array);
+
+		for (size_t i = 0, j = array->size(); i < j; ++i) {
+			array->at(i)->addRef();
+		}
+
+		m_data->delRef();
+		m_data = new ArrayData(array);
+		m_array = array;
+
+		// Iterators on the shared elements are no longer valid
+		changeVersion();
+	}
+
 	~ArrayValue() {
-		delete m_array;
+		m_data->delRef();
 	}
+private:
+	ArrayData* m_data;
+
+	DISALLOW_COPY_AND_ASSIGN(ArrayValue);
 };
 
 } // clever
@@ -159,6 +159,8 @@ void Bool::init() {
 			->addArg("arg1", CLEVER_BOOL)
 			->addArg("arg2", CLEVER_BOOL)
 	);
+
+	setInfallibleMethods();
 }
 
 DataValue* Bool::allocateValue() const {
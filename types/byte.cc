@@ -315,6 +315,8 @@ void Char::init() {
 	);
 
 	addMethod(new Method("toString", &Char::toString, CLEVER_STR));
+
+	setInfallibleMethods();
 }
 
 DataValue* Char::allocateValue() const {
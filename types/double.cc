@@ -25,6 +25,7 @@
 
 #include <cmath>
 #include "compiler/cstring.h"
+#include "compiler/numconv.h"
 #include "types/type.h"
 #include "types/double.h"
 
@@ -48,7 +49,10 @@ CLEVER_METHOD(Double::constructor) {
  * Converts the number to string
  */
 CLEVER_METHOD(Double::toString) {
-	CLEVER_RETURN_STR(CSTRING(CLEVER_THIS()->toString()));
+	char buf[CLEVER_NUM_BUFSIZE];
+	size_t len = format_double(CLEVER_THIS()->getDouble(), buf);
+
+	CLEVER_RETURN_STR(CSTRINGT(std::string(buf, len)));
 }
 
 /**
@@ -311,6 +315,8 @@ void Double::init() {
 	addMethod(new Method("toString", &Double::toString, CLEVER_STR));
 
 	addMethod(new Method("sqrt", &Double::sqrt, CLEVER_DOUBLE));
+
+	setInfallibleMethods();
 }
 
 DataValue* Double::allocateValue() const {
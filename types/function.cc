@@ -82,17 +82,41 @@ CLEVER_METHOD(FunctionType::isValid) {
 }
 
 /**
- * String Function<>::call()
+ * Void Function<>::clearCache()
+ * Drops the cached results of a memoized function
  */
-CLEVER_METHOD(FunctionType::call) {
+CLEVER_METHOD(FunctionType::clearCache) {
+	FunctionValue* fv = CLEVER_GET_VALUE(FunctionValue*, value);
+
+	if (fv->valid() && fv->getFunction()->isMemoized()) {
+		fv->getFunction()->getMemo()->clear();
+	}
+}
+
+/**
+ * Int Function<>::cacheSize()
+ * Returns the number of cached results of a memoized function
+ */
+CLEVER_METHOD(FunctionType::cacheSize) {
 	FunctionValue* fv = CLEVER_GET_VALUE(FunctionValue*, value);
-	const Function* func = fv->getFunction();
 
+	if (fv->valid() && fv->getFunction()->isMemoized()) {
+		CLEVER_RETURN_INT(fv->getFunction()->getMemo()->size());
+	} else {
+		CLEVER_RETURN_INT(0);
+	}
+}
+
+/**
+ * Calls the function from native code
+ */
+void FunctionType::invoke(const Function* func, const ValueVector* args,
+	Value* retval, bool has_return) {
 	if (func->isUserDefined()) {
 		VM::run(func, args);
 
 		// If ReturnType isn't Void
-		if (CLEVER_THIS_ARG(0)) {
+		if (has_return) {
 			retval->copy(VM::getLastReturnValue());
 		}
 		else {
@@ -130,6 +154,15 @@ CLEVER_METHOD(FunctionType::call) {
 	}
 }
 
+/**
+ * String Function<>::call()
+ */
+CLEVER_METHOD(FunctionType::call) {
+	FunctionValue* fv = CLEVER_GET_VALUE(FunctionValue*, value);
+
+	invoke(fv->getFunction(), args, retval, CLEVER_THIS_ARG(0) != NULL);
+}
+
 
 /**
  * Function type initializator
@@ -161,6 +194,12 @@ void FunctionType::init() {
 	addMethod(new Method("isValid", 
 		&FunctionType::isValid, CLEVER_BOOL, true));
 
+	addMethod(new Method("clearCache",
+		&FunctionType::clearCache, CLEVER_VOID));
+
+	addMethod(new Method("cacheSize",
+		&FunctionType::cacheSize, CLEVER_INT, true));
+
 	Method* method = new Method("call", &FunctionType::call, return_t, true);
 
 	for (size_t i = 1, sz = getNumArgs(); i < sz; ++i) {
@@ -115,6 +115,13 @@ public:
 
 	void destructor(Value* value) const { }
 
+	/**
+	 * Calls the function from native code, the same way Function<>::call()
+	 * does; retval receives the return value when has_return is true
+	 */
+	static void invoke(const Function*, const ValueVector*, Value* retval,
+		bool has_return);
+
 	/**
 	 * Type methods
 	 */
@@ -123,6 +130,8 @@ public:
 	static CLEVER_METHOD(call);
 	static CLEVER_METHOD(constructor);
 	static CLEVER_METHOD(isValid);
+	static CLEVER_METHOD(clearCache);
+	static CLEVER_METHOD(cacheSize);
 private:
 	DISALLOW_COPY_AND_ASSIGN(FunctionType);
 };
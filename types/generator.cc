@@ -0,0 +1,150 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "compiler/compiler.h"
+#include "types/type.h"
+#include "types/generator.h"
+#include "types/generatorvalue.h"
+#include "vm/vm.h"
+
+namespace clever {
+
+/**
+ * Runs the generator body until it yields a value or finishes, unless
+ * there is already a value waiting to be consumed
+ */
+static bool _generator_fetch(GeneratorValue* gen) {
+	if (!gen->hasCurrent() && !gen->isDone()) {
+		VM::resume(gen);
+	}
+
+	return gen->hasCurrent();
+}
+
+/**
+ * Void Generator<T>::Generator<T>(Generator<T>)
+ */
+CLEVER_METHOD(Generator::constructor) {
+	DataValue* gen = CLEVER_ARG_DATA_VALUE(0);
+
+	gen->addRef();
+
+	CLEVER_RETURN_DATA_VALUE(gen);
+}
+
+/**
+ * Void Generator<T>::__assign__(Generator<T>)
+ */
+CLEVER_METHOD(Generator::do_assign) {
+	CLEVER_THIS()->copy(CLEVER_ARG(0));
+}
+
+/**
+ * Bool Generator<T>::valid()
+ * Returns true when there is a value to be read by get()
+ */
+CLEVER_METHOD(Generator::valid) {
+	CLEVER_OBJECT_INIT(gen, GeneratorValue*);
+
+	CLEVER_RETURN_BOOL(_generator_fetch(gen));
+}
+
+/**
+ * Void Generator<T>::next()
+ * Discards the current value, the body is resumed on the next access
+ */
+CLEVER_METHOD(Generator::next) {
+	CLEVER_OBJECT_INIT(gen, GeneratorValue*);
+
+	_generator_fetch(gen);
+	gen->consume();
+}
+
+/**
+ * T Generator<T>::get()
+ */
+CLEVER_METHOD(Generator::get) {
+	CLEVER_OBJECT_INIT(gen, GeneratorValue*);
+
+	if (_generator_fetch(gen)) {
+		retval->copy(gen->getCurrent());
+		return;
+	}
+
+	Compiler::warningf("Trying to get a value from an exhausted generator (%S).",
+		CLEVER_THIS()->getName());
+}
+
+/**
+ * Generator<T> Generator<T>::__pre_inc__()
+ */
+CLEVER_METHOD(Generator::pre_inc) {
+	CLEVER_OBJECT_INIT(gen, GeneratorValue*);
+
+	_generator_fetch(gen);
+	gen->consume();
+
+	gen->addRef();
+	CLEVER_RETURN_DATA_VALUE(gen);
+}
+
+Value* Generator::getIterator() const {
+	Value* it = new Value;
+	it->setTypePtr(this);
+
+	return it;
+}
+
+void Generator::init() {
+	/**
+	 * Checks if we are in our "virtual" Generator type
+	 */
+	if (CLEVER_TPL_ARG(0) == NULL) {
+		return;
+	}
+
+	const Type* value_type = CLEVER_TPL_ARG(0);
+
+	addMethod((new Method(CLEVER_CTOR_NAME, &Generator::constructor, this))
+		->addArg("generator", this)
+	);
+
+	addMethod((new Method(CLEVER_OPERATOR_ASSIGN, &Generator::do_assign,
+		CLEVER_VOID))
+		->addArg("rhs", this)
+	);
+
+	addMethod(new Method(CLEVER_OPERATOR_PRE_INC, &Generator::pre_inc, this));
+
+	addMethod(new Method("valid", &Generator::valid, CLEVER_BOOL));
+	addMethod(new Method("next", &Generator::next, CLEVER_VOID));
+	addMethod(new Method("get", &Generator::get, value_type));
+}
+
+DataValue* Generator::allocateValue() const {
+	return NULL;
+}
+
+} // clever
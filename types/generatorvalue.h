@@ -0,0 +1,110 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_GENERATORVALUE_H
+#define CLEVER_GENERATORVALUE_H
+
+#include <vector>
+#include "compiler/value.h"
+#include "compiler/function.h"
+
+namespace clever {
+
+/**
+ * Suspended state of a generator function call
+ */
+struct GeneratorValue : public DataValue {
+	// Function variable and its value inside this generator
+	typedef std::vector<std::pair<Value*, Value*> > Frame;
+
+	explicit GeneratorValue(const Function* func)
+		: m_func(func), m_next_op(func->getOffset() + 1),
+		m_current(new Value), m_has_current(false), m_yielded(false),
+		m_done(false) {}
+
+	~GeneratorValue() {
+		for (size_t i = 0, j = m_frame.size(); i < j; ++i) {
+			delete m_frame[i].second;
+		}
+		m_current->delRef();
+	}
+
+	bool valid() const { return !m_done; }
+
+	const Function* getFunction() const { return m_func; }
+
+	Frame& getFrame() { return m_frame; }
+
+	/**
+	 * Exchanges the current values of the function variables with the
+	 * ones saved by this generator, so the body sees its own locals while
+	 * running and the caller gets its values back on suspension
+	 */
+	void swapFrame() {
+		Value tmp;
+
+		for (size_t i = 0, j = m_frame.size(); i < j; ++i) {
+			tmp.copy(m_frame[i].first);
+			m_frame[i].first->copy(m_frame[i].second);
+			m_frame[i].second->copy(&tmp);
+		}
+	}
+
+	size_t getNextOp() const { return m_next_op; }
+
+	/**
+	 * Called by the yield opcode, saving the produced value and where to
+	 * resume from
+	 */
+	void yield(const Value* value, size_t next_op) {
+		m_current->copy(value);
+		m_next_op = next_op;
+		m_has_current = true;
+		m_yielded = true;
+	}
+
+	Value* getCurrent() const { return m_current; }
+
+	bool hasCurrent() const { return m_has_current; }
+	void consume() { m_has_current = false; }
+
+	bool hasYielded() const { return m_yielded; }
+	void resetYielded() { m_yielded = false; }
+
+	bool isDone() const { return m_done; }
+	void setDone() { m_done = true; }
+private:
+	const Function* m_func;
+	Frame m_frame;
+	size_t m_next_op;
+	Value* m_current;
+	bool m_has_current, m_yielded, m_done;
+
+	DISALLOW_COPY_AND_ASSIGN(GeneratorValue);
+};
+
+} // clever
+
+#endif // CLEVER_GENERATORVALUE_H
@@ -24,6 +24,7 @@
  */
 
 #include "compiler/cstring.h"
+#include "compiler/numconv.h"
 #include "types/type.h"
 #include "types/int.h"
 
@@ -49,7 +50,10 @@ CLEVER_METHOD(Integer::constructor) {
  * Converts the number to string
  */
 CLEVER_METHOD(Integer::toString) {
-	retval->setString(CSTRING(value->toString()));
+	char buf[CLEVER_NUM_BUFSIZE];
+	size_t len = format_int(CLEVER_THIS()->getInteger(), buf);
+
+	CLEVER_RETURN_STR(CSTRINGT(std::string(buf, len)));
 }
 
 /**
@@ -397,6 +401,8 @@ void Integer::init() {
 	);
 
 	addMethod(new Method("toString", &Integer::toString, CLEVER_STR));
+
+	setInfallibleMethods();
 }
 
 DataValue* Integer::allocateValue() const {
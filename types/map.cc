@@ -48,6 +48,24 @@ CLEVER_METHOD(Map::do_assign) {
 	CLEVER_THIS()->copy(CLEVER_ARG(0));
 }
 
+/**
+ * Map<K, V [, C]> Map<K, V [, C]>::__copy__(Map<K, V [, C]> obj)
+ * Returns a copy of the Map
+ */
+CLEVER_METHOD(Map::do_copy) {
+	CLEVER_RETURN_DATA_VALUE(
+		CLEVER_ARG(0)->getTypePtr()->copy(CLEVER_ARG(0), false));
+}
+
+/**
+ * Map<K, V [, C]> Map<K, V [, C]>::__deep_copy__(Map<K, V [, C]> obj)
+ * Returns a deep copy of the Map
+ */
+CLEVER_METHOD(Map::do_deepcopy) {
+	CLEVER_RETURN_DATA_VALUE(
+		CLEVER_ARG(0)->getTypePtr()->copy(CLEVER_ARG(0), true));
+}
+
 /**
  * Array<K> Map<K, V [, C]>::_at_(K key)
  * Access the element whose key is equal `key'
@@ -93,6 +111,9 @@ CLEVER_METHOD(Map::isEmpty) {
  */
 CLEVER_METHOD(Map::insert) {
 	MapValue* map = CLEVER_GET_VALUE(MapValue*, value);
+
+	map->detach();
+
 	Value* key = new Value();
 	Value* val = new Value();
 
@@ -107,6 +128,9 @@ CLEVER_METHOD(Map::insert) {
  */
 CLEVER_METHOD(Map::clear) {
 	MapValue* map = CLEVER_GET_VALUE(MapValue*, value);
+
+	map->detach();
+
 	MapValue::Iterator it = map->getMap().begin(),
 		end = map->getMap().end();
 
@@ -325,18 +349,58 @@ void Map::init() {
 	
 	addMethod(new Method("begin", &Map::begin, iter_type));
 	addMethod(new Method("end", &Map::end, iter_type));
+
+	addMethod(
+		(new Method(CLEVER_COPY_NAME, &Map::do_copy, this, false))
+			->addArg("orig", this)
+	);
+
+	addMethod(
+		(new Method(CLEVER_DEEP_COPY_NAME, &Map::do_deepcopy, this, false))
+			->addArg("orig", this)
+	);
+}
+
+/**
+ * Copies share the entries until one of the Maps is changed. A deep copy
+ * only needs its own entries when they aren't primitive values.
+ */
+DataValue* Map::copy(const Value* orig, bool deep) const {
+	MapValue* source = CLEVER_GET_VALUE(MapValue*, orig);
+
+	if (!deep || (CLEVER_TPL_ARG(0)->getKind() == Type::PRIMITIVE
+		&& CLEVER_TPL_ARG(1)->getKind() == Type::PRIMITIVE)) {
+		return static_cast<DataValue*>(new MapValue(source));
+	}
+
+	MapValue* map = static_cast<MapValue*>(allocateValue());
+	MapValue::Iterator it = source->getMap().begin(),
+		end = source->getMap().end();
+
+	for (; it != end; ++it) {
+		Value* key = new Value();
+		Value* val = new Value();
+
+		key->deepCopy(it->first);
+		val->deepCopy(it->second);
+
+		map->getMap().insert(std::make_pair(key, val));
+	}
+
+	return static_cast<DataValue*>(map);
 }
 
 DataValue* Map::allocateValue() const {
 	if (this->getNumArgs() == 2) {
 		TypeVector tv(2, getTypeArg(0));
 		return new MapValue(getTypeArg(0)
-			->getMethod(CSTRING(CLEVER_OPERATOR_LESS), &tv));
+			->getMethod(CACHE_PTR(CLEVER_OP_LESS, CLEVER_OPERATOR_LESS), &tv));
 	}
 
 	TypeVector tv(2, getTypeArg(0));
 	return new MapValue(getTypeArg(2)
-		->getMethod(CSTRING("compare"), &tv), new Value(getTypeArg(2)));
+		->getMethod(CACHE_PTR(CLEVER_COMPARE, "compare"), &tv),
+		new Value(getTypeArg(2)));
 }
 
 } // clever
@@ -83,7 +83,8 @@ public:
 			return NULL;
 		}
 
-		const Method* method = args.at(2)->getMethod(CSTRING("compare"), &tv);
+		const Method* method = args.at(2)->getMethod(
+			CACHE_PTR(CLEVER_COMPARE, "compare"), &tv);
 		if (!method || method->getReturnType() != CLEVER_BOOL) {
 			std::ostringstream oss;
 			sprintf(oss, "Unable to instantiate the type "
@@ -140,22 +141,17 @@ public:
 	void init();
 	DataValue* allocateValue() const;
 
-	void destructor(Value* value) const {
-		MapValue* map = CLEVER_GET_VALUE(MapValue*, value);
-		MapValue::Iterator it = map->getMap().begin(),
-			end = map->getMap().end();
+	DataValue* copy(const Value*, bool) const;
 
-		while (it != end) {
-			it->first->delRef();
-			it->second->delRef();
-			++it;
-		}
-	}
+	// The entries are released by MapData, which may be shared
+	void destructor(Value* value) const { }
 
 	/**
 	 * Type methods
 	 */
 	static CLEVER_METHOD(do_assign);
+	static CLEVER_METHOD(do_copy);
+	static CLEVER_METHOD(do_deepcopy);
 	static CLEVER_METHOD(size);
 	static CLEVER_METHOD(insert);
 	static CLEVER_METHOD(clear);
@@ -34,7 +34,9 @@ namespace clever {
 
 struct MapIteratorValue : public DataValue {
 	MapIteratorValue(MapValue* map) : m_iterator(map->getMap().begin()),
-		m_end(map->getMap().end()) {
+		m_end(map->getMap().end()), m_data(map->getData()) {
+		// Keeps the entries alive if the Map is detached from them
+		m_data->addRef();
 	}
 	
 	bool valid() const {
@@ -66,9 +68,11 @@ struct MapIteratorValue : public DataValue {
 	}
 
 	~MapIteratorValue() {
+		m_data->delRef();
 	}
 private:
 	MapValue::MapInternal::iterator m_iterator, m_end;
+	MapData* m_data;
 	DISALLOW_COPY_AND_ASSIGN(MapIteratorValue);
 };
 
@@ -39,6 +39,13 @@ struct Comparator {
 		}
 	}
 
+	Comparator(const Comparator& other)
+		: m_comp(other.m_comp), m_value(other.m_value) {
+		if (m_value) {
+			m_value->addRef();
+		}
+	}
+
 	~Comparator() {
 		if (m_value) {
 			m_value->delRef();
@@ -65,28 +72,95 @@ struct Comparator {
 private:
 	const Method* m_comp;
 	Value* m_value;
+
+	Comparator& operator=(const Comparator&);
 };
 
-struct MapValue : public DataValue {
+/**
+ * Map entries, shared by the copies of a Map until one of them is changed
+ * (copy-on-write)
+ */
+struct MapData : public RefCounted {
 	typedef std::map<Value*, Value*, Comparator> MapInternal;
+
+	explicit MapData(const Comparator& comp)
+		: RefCounted(1), m_map(comp) {}
+
+	explicit MapData(const MapInternal& map)
+		: RefCounted(1), m_map(map) {
+		for (MapInternal::iterator it = m_map.begin(); it != m_map.end(); ++it) {
+			it->first->addRef();
+			it->second->addRef();
+		}
+	}
+
+	~MapData() {
+		for (MapInternal::iterator it = m_map.begin(); it != m_map.end(); ++it) {
+			it->first->delRef();
+			it->second->delRef();
+		}
+	}
+
+	MapInternal m_map;
+private:
+	DISALLOW_COPY_AND_ASSIGN(MapData);
+};
+
+struct MapValue : public DataValue {
+	typedef MapData::MapInternal MapInternal;
 	typedef MapInternal::iterator Iterator;
 	typedef MapInternal ValueType;
 
+	/**
+	 * The comparator object, when given, is owned by the Map
+	 */
 	MapValue(const Method* method, Value* value = NULL)
-		: m_map(Comparator(method, value)) {
+		: m_data(new MapData(Comparator(method, value))) {
+		if (value) {
+			value->delRef();
+		}
+	}
+
+	/**
+	 * Creates a Map sharing the entries of another one
+	 */
+	explicit MapValue(MapValue* other)
+		: m_data(other->m_data) {
+		m_data->addRef();
 	}
 
 	MapInternal& getMap() {
-		return m_map;
+		return m_data->m_map;
+	}
+
+	MapData* getData() const {
+		return m_data;
 	}
 	
 	bool valid() const {
 		return true;
 	}
 
-	~MapValue() {}
+	/**
+	 * Must be called before changing the entries, so that a Map sharing
+	 * them gets its own copy first
+	 */
+	void detach() {
+		if (EXPECTED(m_data->refCount() == 1)) {
+			return;
+		}
+
+		MapData* data = new MapData(m_data->m_map);
+
+		m_data->delRef();
+		m_data = data;
+	}
+
+	~MapValue() {
+		m_data->delRef();
+	}
 private:
-	MapInternal m_map;
+	MapData* m_data;
 
 	DISALLOW_COPY_AND_ASSIGN(MapValue);
 };
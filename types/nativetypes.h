@@ -37,5 +37,6 @@
 #include "types/pair.h"
 #include "types/function.h"
 #include "types/iterator.h"
+#include "types/generator.h"
 
 #endif // CLEVER_NATIVE_TYPES_H
@@ -91,7 +91,7 @@ CLEVER_METHOD(Pair::equal) {
 	TypeVector tv(2, CLEVER_THIS_ARG(0));
 
 	const Method* method = CLEVER_THIS_ARG(0)
-		->getMethod(CSTRING(CLEVER_OPERATOR_EQUAL), &tv);
+		->getMethod(CACHE_PTR(CLEVER_OP_EQUAL, CLEVER_OPERATOR_EQUAL), &tv);
 
 	PairValue* v1 = CLEVER_GET_VALUE(PairValue*, CLEVER_ARG(0));
 	PairValue* v2 = CLEVER_GET_VALUE(PairValue*, CLEVER_ARG(1));
@@ -109,7 +109,7 @@ CLEVER_METHOD(Pair::equal) {
 		tv[0] = tv[1] = CLEVER_THIS_ARG(1);
 
 		method = CLEVER_THIS_ARG(1)->
-			getMethod(CSTRING(CLEVER_OPERATOR_EQUAL), &tv);
+			getMethod(CACHE_PTR(CLEVER_OP_EQUAL, CLEVER_OPERATOR_EQUAL), &tv);
 
 		vv[0] = v1->second();
 		vv[1] = v2->second();
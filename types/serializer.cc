@@ -0,0 +1,482 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <limits>
+#include "compiler/cstring.h"
+#include "compiler/value.h"
+#include "types/nativetypes.h"
+#include "types/serializer.h"
+
+namespace clever {
+
+/**
+ * Returns the tag of a type that can be serialized, 0 for the others
+ */
+static char _type_tag(const Type* type) {
+	if (type == NULL) {
+		return 0;
+	} else if (type == CLEVER_INT) {
+		return Serializer::INT;
+	} else if (type == CLEVER_DOUBLE) {
+		return Serializer::DOUBLE;
+	} else if (type == CLEVER_STR) {
+		return Serializer::STRING;
+	} else if (type == CLEVER_BOOL) {
+		return Serializer::BOOL;
+	} else if (type == CLEVER_BYTE) {
+		return Serializer::BYTE;
+	}
+
+	const CString* name = type->getName();
+
+	if (name->compare(0, 6, "Array<") == 0) {
+		return Serializer::ARRAY;
+	} else if (name->compare(0, 4, "Map<") == 0) {
+		return Serializer::MAP;
+	} else if (name->compare(0, 5, "Pair<") == 0) {
+		return Serializer::PAIR;
+	}
+
+	return 0;
+}
+
+static const Type* _type_arg(const Type* type, size_t index) {
+	return static_cast<const TemplatedType*>(type)->getTypeArg(index);
+}
+
+static bool _write_signature(const Type* type, std::string& out) {
+	char tag = _type_tag(type);
+
+	if (tag == 0) {
+		return false;
+	}
+
+	out += tag;
+
+	switch (tag) {
+		case Serializer::ARRAY:
+			return _write_signature(_type_arg(type, 0), out);
+		case Serializer::MAP:
+		case Serializer::PAIR:
+			return _write_signature(_type_arg(type, 0), out)
+				&& _write_signature(_type_arg(type, 1), out);
+	}
+
+	return true;
+}
+
+/**
+ * Returns the end of the signature starting at sig
+ */
+static const char* _skip_signature(const char* sig) {
+	switch (*sig++) {
+		case Serializer::ARRAY:
+			return _skip_signature(sig);
+		case Serializer::MAP:
+		case Serializer::PAIR:
+			return _skip_signature(_skip_signature(sig));
+	}
+
+	return sig;
+}
+
+template <typename T>
+static void _append(std::string& out, const T& v) {
+	out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+static bool _append_size(std::string& out, size_t size) {
+	if (size > std::numeric_limits<uint32_t>::max()) {
+		return false;
+	}
+
+	_append(out, static_cast<uint32_t>(size));
+	return true;
+}
+
+/**
+ * Reserves the size of a block, which is filled by _end_block() once
+ * the block is written
+ */
+static size_t _begin_block(std::string& out) {
+	size_t mark = out.size();
+
+	_append(out, uint32_t(0));
+	return mark;
+}
+
+static bool _end_block(std::string& out, size_t mark) {
+	size_t size = out.size() - mark - sizeof(uint32_t);
+
+	if (size > std::numeric_limits<uint32_t>::max()) {
+		return false;
+	}
+
+	uint32_t size32 = size;
+	std::memcpy(&out[mark], &size32, sizeof(size32));
+	return true;
+}
+
+static bool _write_value(const char* sig, const Value* value, std::string& out) {
+	switch (*sig) {
+		case Serializer::INT:
+			_append(out, value->getInteger());
+			return true;
+		case Serializer::DOUBLE:
+			_append(out, value->getDouble());
+			return true;
+		case Serializer::BOOL:
+			out += char(value->getBoolean());
+			return true;
+		case Serializer::BYTE:
+			out += char(value->getByte());
+			return true;
+		case Serializer::STRING: {
+			const CString* str = value->getStringP();
+
+			if (str == NULL) {
+				return _append_size(out, 0);
+			}
+			if (!_append_size(out, str->size())) {
+				return false;
+			}
+			out.append(*str);
+			return true;
+		}
+		case Serializer::ARRAY: {
+			const ArrayValue* av = static_cast<ArrayValue*>(value->getDataValue());
+			size_t count = av ? av->getArray()->size() : 0;
+
+			if (!_append_size(out, count)) {
+				return false;
+			}
+
+			size_t mark = _begin_block(out);
+
+			for (size_t i = 0; i < count; ++i) {
+				if (!_write_value(sig + 1, av->getArray()->at(i), out)) {
+					return false;
+				}
+			}
+			return _end_block(out, mark);
+		}
+		case Serializer::MAP: {
+			MapValue* mv = static_cast<MapValue*>(value->getDataValue());
+
+			if (mv == NULL) {
+				_append(out, uint32_t(0));
+				_append(out, uint32_t(0));
+				return true;
+			}
+			if (!_append_size(out, mv->getMap().size())) {
+				return false;
+			}
+
+			const char* value_sig = _skip_signature(sig + 1);
+			size_t mark = _begin_block(out);
+			MapValue::Iterator it = mv->getMap().begin(),
+				end = mv->getMap().end();
+
+			for (; it != end; ++it) {
+				if (!_write_value(sig + 1, it->first, out)
+					|| !_write_value(value_sig, it->second, out)) {
+					return false;
+				}
+			}
+			return _end_block(out, mark);
+		}
+		case Serializer::PAIR: {
+			const PairValue* pv = static_cast<PairValue*>(value->getDataValue());
+
+			if (pv == NULL) {
+				return false;
+			}
+
+			size_t mark = _begin_block(out);
+
+			return _write_value(sig + 1, pv->first(), out)
+				&& _write_value(_skip_signature(sig + 1), pv->second(), out)
+				&& _end_block(out, mark);
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Cursor over the input, the returned pointers address the input itself
+ */
+class Cursor {
+public:
+	Cursor(const char* data, size_t size)
+		: m_pos(data), m_end(data + size) {}
+
+	template <typename T>
+	bool get(T& v) {
+		if (sizeof(T) > size_t(m_end - m_pos)) {
+			return false;
+		}
+		std::memcpy(&v, m_pos, sizeof(T));
+		m_pos += sizeof(T);
+		return true;
+	}
+
+	const char* take(size_t len) {
+		if (len > size_t(m_end - m_pos)) {
+			return NULL;
+		}
+		m_pos += len;
+		return m_pos - len;
+	}
+
+	bool atEnd() const {
+		return m_pos == m_end;
+	}
+private:
+	const char* m_pos;
+	const char* m_end;
+};
+
+/**
+ * Reads the count and the block of an Array or Map, every element takes
+ * at least a byte so a larger count can't be right
+ */
+static bool _read_block(Cursor& in, uint32_t& count, Cursor& block) {
+	uint32_t size;
+	const char* data;
+
+	if (!in.get(count) || !in.get(size) || count > size
+		|| (data = in.take(size)) == NULL) {
+		return false;
+	}
+
+	block = Cursor(data, size);
+	return true;
+}
+
+static bool _read_value(const char* sig, const Type* type, Cursor& in, Value* out);
+
+static bool _read_array(const char* sig, const Type* type, Cursor& in, Value* out) {
+	uint32_t count;
+	Cursor block(NULL, 0);
+
+	if (!_read_block(in, count, block)) {
+		return false;
+	}
+
+	const Type* elem_type = _type_arg(type, 0);
+	ValueVector* vec = new ValueVector;
+	ArrayValue* av = new ArrayValue(vec);
+
+	vec->reserve(count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		Value* elem = new Value(elem_type);
+
+		vec->push_back(elem);
+
+		if (!_read_value(sig + 1, elem_type, block, elem)) {
+			av->delRef();
+			return false;
+		}
+	}
+
+	if (!block.atEnd()) {
+		av->delRef();
+		return false;
+	}
+
+	out->setDataValue(av);
+	return true;
+}
+
+static bool _read_map(const char* sig, const Type* type, Cursor& in, Value* out) {
+	uint32_t count;
+	Cursor block(NULL, 0);
+
+	if (!_read_block(in, count, block)) {
+		return false;
+	}
+
+	const Type* key_type = _type_arg(type, 0);
+	const Type* value_type = _type_arg(type, 1);
+	const char* value_sig = _skip_signature(sig + 1);
+	MapValue* mv = static_cast<MapValue*>(type->allocateValue());
+
+	for (uint32_t i = 0; i < count; ++i) {
+		Value* key = new Value(key_type);
+		Value* val = new Value(value_type);
+
+		if (!_read_value(sig + 1, key_type, block, key)
+			|| !_read_value(value_sig, value_type, block, val)
+			|| !mv->getMap().insert(std::make_pair(key, val)).second) {
+			key->delRef();
+			val->delRef();
+			mv->delRef();
+			return false;
+		}
+	}
+
+	if (!block.atEnd()) {
+		mv->delRef();
+		return false;
+	}
+
+	out->setDataValue(mv);
+	return true;
+}
+
+static bool _read_pair(const char* sig, const Type* type, Cursor& in, Value* out) {
+	uint32_t size;
+	const char* data;
+
+	if (!in.get(size) || (data = in.take(size)) == NULL) {
+		return false;
+	}
+
+	Cursor block(data, size);
+	PairValue* pv = static_cast<PairValue*>(type->allocateValue());
+
+	if (!_read_value(sig + 1, _type_arg(type, 0), block, pv->first())
+		|| !_read_value(_skip_signature(sig + 1), _type_arg(type, 1),
+			block, pv->second())
+		|| !block.atEnd()) {
+		pv->delRef();
+		return false;
+	}
+
+	out->setDataValue(pv);
+	return true;
+}
+
+static bool _read_value(const char* sig, const Type* type, Cursor& in, Value* out) {
+	switch (*sig) {
+		case Serializer::INT: {
+			int64_t v;
+
+			if (!in.get(v)) {
+				return false;
+			}
+			out->setInteger(v);
+			return true;
+		}
+		case Serializer::DOUBLE: {
+			double v;
+
+			if (!in.get(v)) {
+				return false;
+			}
+			out->setDouble(v);
+			return true;
+		}
+		case Serializer::BOOL: {
+			uint8_t v;
+
+			if (!in.get(v)) {
+				return false;
+			}
+			out->setBoolean(v != 0);
+			return true;
+		}
+		case Serializer::BYTE: {
+			uint8_t v;
+
+			if (!in.get(v)) {
+				return false;
+			}
+			out->setByte(v);
+			return true;
+		}
+		case Serializer::STRING: {
+			uint32_t len;
+			const char* str;
+
+			if (!in.get(len) || (str = in.take(len)) == NULL) {
+				return false;
+			}
+			out->setString(CSTRINGT(std::string(str, len)));
+			return true;
+		}
+		case Serializer::ARRAY:
+			return _read_array(sig, type, in, out);
+		case Serializer::MAP:
+			return _read_map(sig, type, in, out);
+		case Serializer::PAIR:
+			return _read_pair(sig, type, in, out);
+	}
+
+	return false;
+}
+
+bool Serializer::serialize(const Value* value, std::string& out) {
+	std::string sig;
+
+	if (!_write_signature(value->getTypePtr(), sig)) {
+		return false;
+	}
+
+	size_t start = out.size();
+
+	out += VERSION;
+	out += sig;
+
+	if (!_write_value(sig.data(), value, out)) {
+		out.resize(start);
+		return false;
+	}
+
+	return true;
+}
+
+bool Serializer::deserialize(const char* data, size_t length, Value* value) {
+	const Type* type = value->getTypePtr();
+	std::string sig;
+
+	if (!_write_signature(type, sig)) {
+		return false;
+	}
+
+	Cursor in(data, length);
+	char version;
+	const char* data_sig;
+
+	if (!in.get(version) || version != VERSION
+		|| (data_sig = in.take(sig.size())) == NULL
+		|| std::memcmp(data_sig, sig.data(), sig.size()) != 0) {
+		return false;
+	}
+
+	Value result(type);
+
+	if (!_read_value(sig.data(), type, in, &result) || !in.atEnd()) {
+		return false;
+	}
+
+	value->copy(&result);
+	return true;
+}
+
+} // clever
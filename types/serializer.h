@@ -0,0 +1,89 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_SERIALIZER_H
+#define CLEVER_SERIALIZER_H
+
+#include <cstddef>
+#include <string>
+
+namespace clever {
+
+class Value;
+
+/**
+ * Binary encoding of the native values: Int, Double, String, Bool, Byte
+ * and Arrays, Maps and Pairs of them, nested at will.
+ *
+ * An encoded value is a version byte, the signature of its type (one tag
+ * per type, each template followed by the signature of its arguments)
+ * and the payload, which holds no further tags:
+ *
+ *   Int, Double  8 bytes, in host byte order
+ *   Bool, Byte   1 byte
+ *   String       uint32 length, bytes
+ *   Array        uint32 count, uint32 size in bytes, elements
+ *   Map          uint32 count, uint32 size in bytes, key and value pairs
+ *   Pair         uint32 size in bytes, first, second
+ *
+ * The signature is checked once against the type of the output value, and
+ * every container is bounds checked as a whole before reading its elements,
+ * so they are decoded without looking at types or lengths again. Strings
+ * are built straight from the input buffer.
+ */
+class Serializer {
+public:
+	enum Tag {
+		INT = 1,
+		DOUBLE,
+		STRING,
+		BOOL,
+		BYTE,
+		ARRAY,
+		MAP,
+		PAIR
+	};
+
+	static const char VERSION = 1;
+
+	/**
+	 * Appends the encoding of the value to the buffer, returns false when
+	 * its type or a part of it can't be serialized
+	 */
+	static bool serialize(const Value* value, std::string& out);
+
+	/**
+	 * Decodes the data into the value, returns false (and leaves the value
+	 * untouched) unless the data is a whole encoding of a value of the
+	 * same type
+	 */
+	static bool deserialize(const char* data, size_t length, Value* value);
+private:
+	Serializer() {}
+};
+
+} // clever
+
+#endif // CLEVER_SERIALIZER_H
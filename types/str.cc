@@ -24,15 +24,110 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include "compiler/cstring.h"
 #include "compiler/compiler.h"
+#include "compiler/numconv.h"
 #include "types/type.h"
 #include "types/array.h"
 #include "types/str.h"
 
 namespace clever {
 
+/**
+ * Byte set used to classify characters in a single table lookup
+ */
+class ByteSet {
+public:
+	explicit ByteSet(const ::std::string& chars) {
+		::memset(m_set, 0, sizeof(m_set));
+
+		for (size_t i = 0, j = chars.size(); i < j; ++i) {
+			m_set[static_cast<unsigned char>(chars[i])] = true;
+		}
+	}
+
+	bool has(char c) const {
+		return m_set[static_cast<unsigned char>(c)];
+	}
+
+	/**
+	 * Returns the position of the first character in [pos, str.size()) that
+	 * belongs (or not, when in_set is false) to the set
+	 */
+	size_t scan(const ::std::string& str, size_t pos, bool in_set) const {
+		const char* data = str.data();
+
+		for (size_t size = str.size(); pos < size; ++pos) {
+			if (has(data[pos]) == in_set) {
+				return pos;
+			}
+		}
+		return ::std::string::npos;
+	}
+private:
+	bool m_set[256];
+};
+
+/**
+ * Characters removed by the trim methods
+ */
+static const ByteSet s_trim_chars(" \n\r\t");
+
+/**
+ * Finds the first occurrence of needle in str starting at pos.
+ * memchr() is used to jump straight to the bytes matching the needle's
+ * first character and the last character is checked before comparing
+ * the whole needle.
+ */
+static size_t _str_find(const ::std::string& str, const ::std::string& needle,
+	size_t pos) {
+	size_t size = str.size(), nsize = needle.size();
+
+	if (pos > size || size - pos < nsize) {
+		return ::std::string::npos;
+	}
+	if (nsize == 0) {
+		return pos;
+	}
+
+	const char* data = str.data();
+	const char* ndata = needle.data();
+	const char* p = data + pos;
+	const char* last = data + (size - nsize);
+	const char first = ndata[0], final = ndata[nsize - 1];
+
+	while (p <= last) {
+		p = static_cast<const char*>(::memchr(p, first, last - p + 1));
+
+		if (p == NULL) {
+			break;
+		}
+		if (p[nsize - 1] == final
+			&& ::memcmp(p + 1, ndata + 1, nsize - 1) == 0) {
+			return p - data;
+		}
+		++p;
+	}
+	return ::std::string::npos;
+}
+
+/**
+ * Returns the [pos, pos+len) range of the string, sharing the original
+ * CString instead of copying it when the range covers the whole string
+ */
+static void _return_range(Value* retval, const CString* str, size_t pos,
+	size_t len) {
+	if (pos == 0 && len >= str->size()) {
+		CLEVER_RETURN_STR(str);
+	} else if (pos >= str->size() || len == 0) {
+		CLEVER_RETURN_EMPTY_STR();
+	} else {
+		CLEVER_RETURN_STR(CSTRINGT(*str, pos, len));
+	}
+}
+
 /**
  * String::toString()
  * Returns the itself string
@@ -46,9 +141,10 @@ CLEVER_METHOD(String::toString) {
  * Trim non letters from left
  */
 CLEVER_METHOD(String::ltrim) {
-    std::string newString = CLEVER_THIS()->toString();
-    newString.erase(0, newString.find_first_not_of(" \n\r\t"));
-    CLEVER_RETURN_STR(CSTRINGT(newString));
+	const CString* str = CLEVER_THIS()->getStringP();
+	size_t start = s_trim_chars.scan(*str, 0, false);
+
+	_return_range(retval, str, start, ::std::string::npos);
 }
 
 /**
@@ -56,9 +152,14 @@ CLEVER_METHOD(String::ltrim) {
  * Trim non letters from right
  */
 CLEVER_METHOD(String::rtrim) {
-    std::string newString = CLEVER_THIS()->toString();
-    newString.erase(newString.find_last_not_of(" \n\r\t") + 1);
-    CLEVER_RETURN_STR(CSTRINGT(newString));
+	const CString* str = CLEVER_THIS()->getStringP();
+	size_t end = str->size();
+
+	while (end > 0 && s_trim_chars.has((*str)[end - 1])) {
+		--end;
+	}
+
+	_return_range(retval, str, 0, end);
 }
 
 /**
@@ -66,14 +167,21 @@ CLEVER_METHOD(String::rtrim) {
  * Trim non letters from both sides
  */
 CLEVER_METHOD(String::trim) {
-    std::string newString = CLEVER_THIS()->toString();
-    // ltrim
-    newString.erase(0, newString.find_first_not_of(" \n\r\t"));
+	const CString* str = CLEVER_THIS()->getStringP();
+	size_t start = s_trim_chars.scan(*str, 0, false);
 
-    // rtrim
-    newString.erase(newString.find_last_not_of(" \n\r\t") + 1);
+	if (start == ::std::string::npos) {
+		CLEVER_RETURN_EMPTY_STR();
+		return;
+	}
 
-    CLEVER_RETURN_STR(CSTRINGT(newString));
+	size_t end = str->size();
+
+	while (s_trim_chars.has((*str)[end - 1])) {
+		--end;
+	}
+
+	_return_range(retval, str, start, end - start);
 }
 
 /**
@@ -81,23 +189,35 @@ CLEVER_METHOD(String::trim) {
  * Replace part of the string and returns the new one.
  */
 CLEVER_METHOD(String::replace) {
-	size_t needleLength, needlePos;
-	std::string newString = CLEVER_THIS()->toString();
+	const CString* str = CLEVER_THIS()->getStringP();
+	const CString& needle = CLEVER_ARG_STR(0);
+	const CString& replacement = CLEVER_ARG_STR(1);
+	size_t needlePos = needle.empty() ?
+		::std::string::npos : _str_find(*str, needle, 0);
+
+	// Nothing to replace, the string is shared as is
+	if (needlePos == ::std::string::npos) {
+		CLEVER_RETURN_STR(str);
+		return;
+	}
+
+	CString* newString = const_cast<CString*>(CSTRINGT(""));
+	size_t lastPos = 0;
 
-	// Initial replace
-	needlePos = newString.find(CLEVER_ARG_STR(0), 0);
-	needleLength = CLEVER_ARG_STR(0).length();
+	newString->reserve(str->size());
 
+	// Copies the chunks between the occurrences in a single pass
 	do {
-		// Do the replace
-		newString = newString.replace(needlePos, needleLength, CLEVER_ARG_STR(1));
+		newString->append(*str, lastPos, needlePos - lastPos);
+		newString->append(replacement);
+
+		lastPos = needlePos + needle.size();
+		needlePos = _str_find(*str, needle, lastPos);
+	} while (needlePos != ::std::string::npos);
 
-		// Find the next one
-		needlePos = newString.find(CLEVER_ARG_STR(0), 0);
-		needleLength = CLEVER_ARG_STR(0).length();
-	} while (needlePos != std::string::npos);
+	newString->append(*str, lastPos, ::std::string::npos);
 
-	CLEVER_RETURN_STR(CSTRINGT(newString));
+	CLEVER_RETURN_STR(newString);
 }
 
 /**
@@ -105,10 +225,11 @@ CLEVER_METHOD(String::replace) {
  * Retrieves a substring from the original one.
  */
 CLEVER_METHOD(String::substring) {
+	const CString* str = CLEVER_THIS()->getStringP();
 	int64_t arg0 = CLEVER_ARG_INT(0);
 	int64_t arg1 = CLEVER_ARG_INT(1);
-	size_t max_size = CLEVER_THIS()->toString().max_size();
-	size_t length   = CLEVER_THIS()->toString().length();
+	size_t max_size = str->max_size();
+	size_t length   = str->length();
 	int arg0_in_range = (uint64_t)arg0 < max_size && (uint64_t)arg0 < length;
 
 	if (!arg0_in_range) {
@@ -120,8 +241,7 @@ CLEVER_METHOD(String::substring) {
 		}
 	}
 
-	std::string substr = CLEVER_THIS()->toString().substr(arg0, arg1);
-	CLEVER_RETURN_STR(CSTRINGT(substr));
+	_return_range(retval, str, arg0, arg1);
 }
 
 /**
@@ -158,13 +278,13 @@ CLEVER_METHOD(String::length) {
  * Converts the string to a double, if possible.
  */
 CLEVER_METHOD(String::toDouble) {
+	const char* str = CLEVER_THIS()->getString().c_str();
 	double floatValue = 0.0;
-	std::stringstream stream(CLEVER_THIS()->toString());
 
-	stream >> floatValue;
-
-	clever_assert(stream.fail() == false,
-		"'%s' is not a valid floating point number.", CLEVER_THIS()->toString().c_str());
+	if (parse_double(str, floatValue) == NULL) {
+		clever_assert(false,
+			"'%s' is not a valid floating point number.", str);
+	}
 
 	CLEVER_RETURN_DOUBLE(floatValue);
 }
@@ -174,13 +294,13 @@ CLEVER_METHOD(String::toDouble) {
  * Converts the string to an integer, if possible.
  */
 CLEVER_METHOD(String::toInteger) {
+	const char* str = CLEVER_THIS()->getString().c_str();
 	int64_t integer = 0L;
-	std::stringstream stream(CLEVER_THIS()->toString());
 
-	stream >> integer;
-
-	clever_assert(stream.fail() == false,
-			"'%s' is not a valid integer.", CLEVER_THIS()->toString().c_str());
+	if (parse_int(str, integer) == NULL) {
+		clever_assert(false,
+			"'%s' is not a valid integer.", str);
+	}
 
 	CLEVER_RETURN_INT(integer);
 }
@@ -284,8 +404,8 @@ CLEVER_METHOD(String::endsWith) {
  * the characters after 'pos'.
  */
 CLEVER_METHOD(String::find) {
-	const ::std::string& this_str = CLEVER_THIS()->toString();
-	const ::std::string& arg_str = CLEVER_ARG(0)->toString();
+	const CString& this_str = CLEVER_THIS()->getString();
+	const CString& arg_str = CLEVER_ARG_STR(0);
 	size_t pos = (CLEVER_NUM_ARGS() == 1 ? 0 : CLEVER_ARG(1)->getInteger());
 
 	if (pos >= this_str.size()) {
@@ -293,7 +413,7 @@ CLEVER_METHOD(String::find) {
 		return;
 	}
 
-	size_t find_pos = this_str.find(arg_str, pos);
+	size_t find_pos = _str_find(this_str, arg_str, pos);
 	CLEVER_RETURN_INT(find_pos != ::std::string::npos ? find_pos : -1LL);
 }
 
@@ -390,28 +510,28 @@ CLEVER_METHOD(String::padRight) {
  * String String::split(separator)
  */
 CLEVER_METHOD(String::split) {
-	::std::string this_str = CLEVER_THIS()->toString();
-	const ::std::string& separator = CLEVER_ARG(0)->toString();
+	const CString& this_str = CLEVER_THIS()->getString();
+	const ByteSet separator(CLEVER_ARG_STR(0));
 	ValueVector* vv = new ValueVector;
 
 	// Skip delimiters at beginning.
-	::std::string::size_type lastPos = this_str.find_first_not_of(separator, 0);
+	::std::string::size_type lastPos = separator.scan(this_str, 0, false);
 
 	// Find first "non-delimiter".
-	::std::string::size_type pos = this_str.find_first_of(separator, lastPos);
+	::std::string::size_type pos = separator.scan(this_str, lastPos, true);
 
 	while ((::std::string::npos != pos) || (::std::string::npos != lastPos)) {
 		Value *v = new Value();
 
 		// Found it.
-		v->setString(CSTRING(this_str.substr(lastPos, pos - lastPos)));
+		v->setString(CSTRINGT(this_str, lastPos, pos - lastPos));
 		vv->push_back(v);
 
 		// Skip delimiters.
-		lastPos = this_str.find_first_not_of(separator, pos);
+		lastPos = separator.scan(this_str, pos, false);
 
 		// Find next "non-delimiter"
-		pos = this_str.find_first_of(separator, lastPos);
+		pos = separator.scan(this_str, lastPos, true);
 	}
 
 	CLEVER_RETURN_ARRAY(vv);
@@ -497,64 +617,82 @@ void String::init() {
 	const Type* arr_byte = CLEVER_GET_ARRAY_TEMPLATE->getTemplatedType(CLEVER_BYTE);
 	const Type* arr_string = CLEVER_GET_ARRAY_TEMPLATE->getTemplatedType(CLEVER_STR);
 
-	addMethod(new Method(CLEVER_CTOR_NAME, &String::constructor, CLEVER_STR));
+	addMethod(
+		(new Method(CLEVER_CTOR_NAME, &String::constructor, CLEVER_STR))
+			->setInfallible()
+	);
 
 	addMethod(
 		(new Method(CLEVER_CTOR_NAME, &String::constructor, CLEVER_STR))
 			->addArg("value", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_CTOR_NAME, &String::constructor, CLEVER_STR))
 			->addArg("value", arr_byte)
+			->setInfallible()
 	);
 
-	addMethod(new Method("ltrim", &String::ltrim, CLEVER_STR));
+	addMethod(
+		(new Method("ltrim", &String::ltrim, CLEVER_STR))->setInfallible()
+	);
 
-	addMethod(new Method("rtrim", &String::rtrim, CLEVER_STR));
+	addMethod(
+		(new Method("rtrim", &String::rtrim, CLEVER_STR))->setInfallible()
+	);
 
-	addMethod(new Method("trim", &String::trim, CLEVER_STR));
+	addMethod(
+		(new Method("trim", &String::trim, CLEVER_STR))->setInfallible()
+	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_EQUAL, &String::equal, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_NE, &String::not_equal, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_GREATER, &String::greater, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_GE, &String::greater_equal, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_LESS, &String::less, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_LE, &String::less_equal, CLEVER_BOOL))
 			->addArg("arg1", CLEVER_STR)
 			->addArg("arg2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method(CLEVER_OPERATOR_PLUS, &String::plus, CLEVER_STR))
 			->addArg("str1", CLEVER_STR)
 			->addArg("str2", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
@@ -588,16 +726,19 @@ void String::init() {
 	addMethod(
 		(new Method(CLEVER_OPERATOR_ASSIGN, &String::do_assign, CLEVER_VOID))
 			->addArg("rvalue", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method("startsWith", &String::startsWith, CLEVER_BOOL))
 			->addArg("str", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
 		(new Method("endsWith", &String::endsWith, CLEVER_BOOL))
 			->addArg("str", CLEVER_STR)
+			->setInfallible()
 	);
 
 	addMethod(
@@ -605,6 +746,7 @@ void String::init() {
 			->addArg("str", CLEVER_STR)
 			->addArg("pos", CLEVER_INT)
 			->setMinNumArgs(1)
+			->setInfallible()
 	);
 
 	addMethod(
@@ -614,17 +756,25 @@ void String::init() {
 
 	addMethod(new Method("toByteArray", &String::toByteArray, arr_byte));
 
-	addMethod(new Method("length", &String::length, CLEVER_INT));
+	addMethod(
+		(new Method("length", &String::length, CLEVER_INT))->setInfallible()
+	);
 
 	addMethod(new Method("toDouble", &String::toDouble, CLEVER_DOUBLE));
 
 	addMethod(new Method("toInteger", &String::toInteger, CLEVER_INT));
 
-	addMethod(new Method("toUpper", &String::toUpper, CLEVER_STR));
+	addMethod(
+		(new Method("toUpper", &String::toUpper, CLEVER_STR))->setInfallible()
+	);
 
-	addMethod(new Method("toLower", &String::toLower, CLEVER_STR));
+	addMethod(
+		(new Method("toLower", &String::toLower, CLEVER_STR))->setInfallible()
+	);
 
-	addMethod(new Method("toString", &String::toString, CLEVER_STR));
+	addMethod(
+		(new Method("toString", &String::toString, CLEVER_STR))->setInfallible()
+	);
 
 	addMethod(
 		(new Method("pad", &String::pad, CLEVER_STR))
@@ -0,0 +1,457 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "compiler/compiler.h"
+#include "types/type.h"
+#include "types/array.h"
+#include "types/function.h"
+#include "types/stream.h"
+#include "types/streamvalue.h"
+#include "types/workpool.h"
+#include "vm/callback.h"
+
+/**
+ * Minimum number of elements handled by each thread on parallel streams
+ */
+#define CLEVER_STREAM_CHUNK 65536
+
+namespace clever {
+
+/**
+ * Pushes the source elements through the stages, handing the ones which
+ * pass all of them to the sink. Everything happens in a single pass with
+ * no intermediate containers; it stops when the sink returns false or a
+ * take() stage is satisfied
+ */
+template <typename Sink>
+static void _run_pipeline(const StreamValue* stream, Sink& sink) {
+	const ValueVector* vec = CLEVER_GET_ARRAY(stream->getSource());
+	const StreamStages& stages = stream->getStages();
+	size_t num_stages = stages.size();
+	std::vector<int64_t> taken(num_stages, 0);
+	std::vector<Callback*> callbacks(num_stages, static_cast<Callback*>(NULL));
+	bool done = false;
+	Value cur, ret;
+
+	for (size_t k = 0; k < num_stages; ++k) {
+		if (stages[k].func) {
+			callbacks[k] = new Callback(stages[k].func);
+		}
+	}
+
+	for (size_t i = 0, j = vec->size(); !done && i < j; ++i) {
+		bool pass = true;
+
+		cur.copy(vec->at(i));
+
+		for (size_t k = 0; pass && k < num_stages; ++k) {
+			switch (stages[k].kind) {
+				case StreamStage::MAP:
+					callbacks[k]->setArg(0, &cur);
+					callbacks[k]->call(&ret);
+					cur.copy(&ret);
+					break;
+				case StreamStage::FILTER:
+					callbacks[k]->setArg(0, &cur);
+					callbacks[k]->call(&ret);
+					pass = ret.getBoolean();
+					break;
+				case StreamStage::TAKE:
+					if (taken[k] >= stages[k].count) {
+						pass = false;
+						done = true;
+						break;
+					}
+					// No other element can get past this stage
+					if (++taken[k] == stages[k].count) {
+						done = true;
+					}
+					break;
+			}
+		}
+
+		if (pass && !sink(&cur)) {
+			done = true;
+		}
+	}
+
+	for (size_t k = 0; k < num_stages; ++k) {
+		delete callbacks[k];
+	}
+}
+
+struct ArraySink {
+	explicit ArraySink(ValueVector* vec_) : vec(vec_) {}
+
+	bool operator()(const Value* value) {
+		Value* val = new Value;
+		val->copy(value);
+		vec->push_back(val);
+		return true;
+	}
+
+	ValueVector* vec;
+};
+
+struct IntSumSink {
+	IntSumSink() : total(0) {}
+
+	bool operator()(const Value* value) {
+		total += value->getInteger();
+		return true;
+	}
+
+	int64_t total;
+};
+
+struct DoubleSumSink {
+	DoubleSumSink() : total(0) {}
+
+	bool operator()(const Value* value) {
+		total += value->getDouble();
+		return true;
+	}
+
+	double total;
+};
+
+struct ReduceSink {
+	ReduceSink(const Function* func, Value* acc_)
+		: callback(func), acc(acc_) {}
+
+	bool operator()(const Value* value) {
+		callback.setArg(0, acc);
+		callback.setArg(1, value);
+		callback.call(&ret);
+		acc->copy(&ret);
+		return true;
+	}
+
+	Callback callback;
+	Value* acc;
+	Value ret;
+};
+
+struct ForEachSink {
+	explicit ForEachSink(const Function* func)
+		: callback(func) {}
+
+	bool operator()(const Value* value) {
+		callback.setArg(0, value);
+		callback.call(&ret);
+		return true;
+	}
+
+	Callback callback;
+	Value ret;
+};
+
+/**
+ * Per-worker accumulators for a parallel sum; only numeric reads are done
+ * by the workers, the VM is never entered
+ */
+struct SumState {
+	SumState(const ValueVector* vec_, bool is_int_, size_t nworkers)
+		: vec(vec_), is_int(is_int_), itotal(nworkers, 0), dtotal(nworkers, 0) {}
+
+	const ValueVector* vec;
+	bool is_int;
+	std::vector<int64_t> itotal;
+	std::vector<double> dtotal;
+};
+
+static void _sum_range(size_t begin, size_t end, size_t worker, void* data) {
+	SumState* state = static_cast<SumState*>(data);
+
+	if (state->is_int) {
+		int64_t total = 0;
+
+		for (size_t i = begin; i < end; ++i) {
+			total += state->vec->at(i)->getInteger();
+		}
+		state->itotal[worker] += total;
+	} else {
+		double total = 0;
+
+		for (size_t i = begin; i < end; ++i) {
+			total += state->vec->at(i)->getDouble();
+		}
+		state->dtotal[worker] += total;
+	}
+}
+
+/**
+ * Sums the source splitting it across the work pool. Returns false when
+ * it's not worth it, leaving the work to the sequential path
+ */
+static bool _parallel_sum(const ValueVector* vec, bool is_int, Value* retval) {
+	size_t nworkers = WorkPool::getNumWorkers(vec->size(), CLEVER_STREAM_CHUNK);
+
+	if (nworkers < 2) {
+		return false;
+	}
+
+	SumState state(vec, is_int, nworkers);
+
+	WorkPool::run(vec->size(), CLEVER_STREAM_CHUNK, _sum_range, &state);
+
+	if (is_int) {
+		int64_t total = 0;
+
+		for (size_t i = 0; i < nworkers; ++i) {
+			total += state.itotal[i];
+		}
+		retval->setInteger(total);
+	} else {
+		double total = 0;
+
+		for (size_t i = 0; i < nworkers; ++i) {
+			total += state.dtotal[i];
+		}
+		retval->setDouble(total);
+	}
+
+	return true;
+}
+
+/**
+ * Returns a copy of the stream with one more stage, a stage with an
+ * invalid function is left out
+ */
+static StreamValue* _add_stage(const Value* value, const StreamStage& stage) {
+	StreamValue* stream = new StreamValue(CLEVER_GET_VALUE(StreamValue*, value));
+
+	if (stage.kind == StreamStage::TAKE || stage.func) {
+		stream->addStage(stage);
+	}
+
+	return stream;
+}
+
+/**
+ * Returns the function held by a Function<> argument or NULL if it's not
+ * a valid one
+ */
+static const Function* _stage_func(const Value* arg) {
+	FunctionValue* fv = CLEVER_GET_VALUE(FunctionValue*, arg);
+
+	if (!fv->valid()) {
+		Compiler::warningf("Passing an invalid %S to a stream.",
+			arg->getTypePtr()->getName());
+		return NULL;
+	}
+
+	return fv->getFunction();
+}
+
+/**
+ * Void Stream<T>::__assign__(Stream<T>)
+ */
+CLEVER_METHOD(Stream::do_assign) {
+	CLEVER_THIS()->copy(CLEVER_ARG(0));
+}
+
+/**
+ * Stream<T> Stream<T>::map(Function<T, T>)
+ */
+CLEVER_METHOD(Stream::map) {
+	CLEVER_RETURN_DATA_VALUE(_add_stage(CLEVER_THIS(),
+		StreamStage(StreamStage::MAP, _stage_func(CLEVER_ARG(0)))));
+}
+
+/**
+ * Stream<T> Stream<T>::filter(Function<Bool, T>)
+ */
+CLEVER_METHOD(Stream::filter) {
+	CLEVER_RETURN_DATA_VALUE(_add_stage(CLEVER_THIS(),
+		StreamStage(StreamStage::FILTER, _stage_func(CLEVER_ARG(0)))));
+}
+
+/**
+ * Stream<T> Stream<T>::take(Int n)
+ */
+CLEVER_METHOD(Stream::take) {
+	int64_t count = CLEVER_ARG(0)->getInteger();
+
+	CLEVER_RETURN_DATA_VALUE(_add_stage(CLEVER_THIS(),
+		StreamStage(StreamStage::TAKE, NULL, count < 0 ? 0 : count)));
+}
+
+/**
+ * Stream<T> Stream<T>::parallel()
+ * Allows the terminal operation to split the input across threads; only
+ * done for sum() without stages, as script functions can only run on the
+ * VM thread
+ */
+CLEVER_METHOD(Stream::parallel) {
+	StreamValue* stream =
+		new StreamValue(CLEVER_GET_VALUE(StreamValue*, CLEVER_THIS()));
+
+	stream->setParallel();
+
+	CLEVER_RETURN_DATA_VALUE(stream);
+}
+
+/**
+ * T Stream<T>::reduce(Function<T, T, T>, T initial)
+ */
+CLEVER_METHOD(Stream::reduce) {
+	const Function* func = _stage_func(CLEVER_ARG(0));
+
+	retval->copy(CLEVER_ARG(1));
+
+	if (func) {
+		ReduceSink sink(func, retval);
+
+		_run_pipeline(CLEVER_GET_VALUE(StreamValue*, CLEVER_THIS()), sink);
+	}
+}
+
+/**
+ * T Stream<T>::sum()
+ * Available on Stream<Int> and Stream<Double>
+ */
+CLEVER_METHOD(Stream::sum) {
+	const StreamValue* stream = CLEVER_GET_VALUE(StreamValue*, CLEVER_THIS());
+	bool is_int = CLEVER_THIS_ARG(0) == CLEVER_INT;
+
+	if (stream->isParallel() && stream->getStages().empty()
+		&& _parallel_sum(CLEVER_GET_ARRAY(stream->getSource()), is_int,
+			retval)) {
+		return;
+	}
+
+	if (is_int) {
+		IntSumSink sink;
+		_run_pipeline(stream, sink);
+		CLEVER_RETURN_INT(sink.total);
+	} else {
+		DoubleSumSink sink;
+		_run_pipeline(stream, sink);
+		CLEVER_RETURN_DOUBLE(sink.total);
+	}
+}
+
+/**
+ * Array<T> Stream<T>::toArray()
+ */
+CLEVER_METHOD(Stream::toArray) {
+	ValueVector* vec = new ValueVector;
+	ArraySink sink(vec);
+
+	_run_pipeline(CLEVER_GET_VALUE(StreamValue*, CLEVER_THIS()), sink);
+
+	CLEVER_RETURN_ARRAY(vec);
+}
+
+/**
+ * Void Stream<T>::forEach(Function<Void, T>)
+ */
+CLEVER_METHOD(Stream::forEach) {
+	const Function* func = _stage_func(CLEVER_ARG(0));
+
+	if (func) {
+		ForEachSink sink(func);
+
+		_run_pipeline(CLEVER_GET_VALUE(StreamValue*, CLEVER_THIS()), sink);
+	}
+}
+
+/**
+ * Stream type initializator
+ */
+void Stream::init() {
+	/**
+	 * Check if we are in our "virtual" Stream type
+	 */
+	if (CLEVER_TPL_ARG(0) == NULL) {
+		return;
+	}
+
+	const Type* const value_type = CLEVER_TPL_ARG(0);
+	const TemplatedType* const func_tpl =
+		static_cast<const TemplatedType*>(CLEVER_TYPE("Function"));
+	TemplateArgs tv;
+
+	// Function<T, T>
+	tv.push_back(value_type);
+	tv.push_back(value_type);
+	const Type* const map_func = func_tpl->getTemplatedType(tv);
+
+	// Function<T, T, T>
+	tv.push_back(value_type);
+	const Type* const reduce_func = func_tpl->getTemplatedType(tv);
+
+	// Function<Bool, T>
+	tv.clear();
+	tv.push_back(CLEVER_BOOL);
+	tv.push_back(value_type);
+	const Type* const filter_func = func_tpl->getTemplatedType(tv);
+
+	// Function<Void, T>
+	tv[0] = CLEVER_VOID;
+	const Type* const each_func = func_tpl->getTemplatedType(tv);
+
+	addMethod((new Method(CLEVER_OPERATOR_ASSIGN, &Stream::do_assign,
+		CLEVER_VOID))
+		->addArg("rhs", this)
+	);
+
+	addMethod((new Method("map", &Stream::map, this))
+		->addArg("func", map_func)
+	);
+
+	addMethod((new Method("filter", &Stream::filter, this))
+		->addArg("func", filter_func)
+	);
+
+	addMethod((new Method("take", &Stream::take, this))
+		->addArg("count", CLEVER_INT)
+	);
+
+	addMethod(new Method("parallel", &Stream::parallel, this));
+
+	addMethod((new Method("reduce", &Stream::reduce, value_type))
+		->addArg("func", reduce_func)
+		->addArg("initial", value_type)
+	);
+
+	if (value_type == CLEVER_INT || value_type == CLEVER_DOUBLE) {
+		addMethod(new Method("sum", &Stream::sum, value_type));
+	}
+
+	addMethod(new Method("toArray", &Stream::toArray,
+		CLEVER_TPL_ARRAY(value_type)));
+
+	addMethod((new Method("forEach", &Stream::forEach, CLEVER_VOID))
+		->addArg("func", each_func)
+	);
+}
+
+DataValue* Stream::allocateValue() const {
+	return NULL;
+}
+
+} // clever
@@ -0,0 +1,109 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_STREAM_H
+#define CLEVER_STREAM_H
+
+#include "types/type.h"
+#include "compiler/value.h"
+#include "compiler/scope.h"
+
+namespace clever {
+
+/**
+ * Stream<T> is a lazy map/filter/take pipeline returned by
+ * Array<T>::stream(), whose stages are fused into a single pass over the
+ * array by the terminal operations (reduce, sum, toArray, forEach)
+ */
+class Stream : public TemplatedType {
+public:
+	Stream()
+		: TemplatedType(CSTRING("Stream"), CLEVER_OBJECT) {
+		addArg(NULL);
+	}
+
+	Stream(const CString* name, const Type* val_arg)
+		: TemplatedType(name, CLEVER_OBJECT) {
+		addArg(val_arg);
+	}
+
+	const std::string* checkTemplateArgs(const TemplateArgs& args) const {
+		if (args.size() != 1) {
+			std::ostringstream oss;
+			sprintf(oss, "Wrong number of template arguments given. "
+				"`%S' requires 1 argument and %l was given.",
+				this->getName(), args.size()
+			);
+
+			return new std::string(oss.str());
+		}
+
+		return NULL;
+	}
+
+	virtual const Type* getTemplatedType(const Type* val_arg) const {
+		std::string name = getName()->str() + "<"
+			+ val_arg->getName()->str() + ">";
+
+		const CString* cname = CSTRING(name);
+		const Type* type = g_scope.getType(cname);
+
+		if (type == NULL) {
+			Type* ntype = new Stream(cname, val_arg);
+			g_scope.pushType(cname, ntype);
+			ntype->init();
+
+			return ntype;
+		}
+
+		return type;
+	}
+
+	virtual const Type* getTemplatedType(const TemplateArgs& args) const {
+		return getTemplatedType(args.at(0));
+	}
+
+	void init();
+	DataValue* allocateValue() const;
+
+	/**
+	 * Type methods
+	 */
+	static CLEVER_METHOD(do_assign);
+	static CLEVER_METHOD(map);
+	static CLEVER_METHOD(filter);
+	static CLEVER_METHOD(take);
+	static CLEVER_METHOD(parallel);
+	static CLEVER_METHOD(reduce);
+	static CLEVER_METHOD(sum);
+	static CLEVER_METHOD(toArray);
+	static CLEVER_METHOD(forEach);
+private:
+	DISALLOW_COPY_AND_ASSIGN(Stream);
+};
+
+} // clever
+
+#endif // CLEVER_STREAM_H
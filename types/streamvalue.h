@@ -0,0 +1,94 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_STREAMVALUE_H
+#define CLEVER_STREAMVALUE_H
+
+#include <vector>
+#include "compiler/value.h"
+#include "compiler/function.h"
+
+namespace clever {
+
+/**
+ * A pipeline stage, applied to each element in order
+ */
+struct StreamStage {
+	enum StageKind { MAP, FILTER, TAKE };
+
+	StreamStage(StageKind kind_, const Function* func_, int64_t count_ = 0)
+		: kind(kind_), func(func_), count(count_) {}
+
+	StageKind kind;
+	const Function* func;
+	int64_t count;
+};
+
+typedef std::vector<StreamStage> StreamStages;
+
+/**
+ * Lazy pipeline over an Array, nothing runs until a terminal operation
+ */
+struct StreamValue : public DataValue {
+	explicit StreamValue(const Value* source)
+		: m_source(new Value), m_parallel(false) {
+		m_source->copy(source);
+	}
+
+	/**
+	 * Each stage method returns a new stream, so a stream stored in a
+	 * variable isn't changed by building other pipelines from it
+	 */
+	explicit StreamValue(const StreamValue* orig)
+		: m_source(new Value), m_stages(orig->m_stages),
+		m_parallel(orig->m_parallel) {
+		m_source->copy(orig->m_source);
+	}
+
+	~StreamValue() {
+		delete m_source;
+	}
+
+	bool valid() const { return true; }
+
+	const Value* getSource() const { return m_source; }
+
+	const StreamStages& getStages() const { return m_stages; }
+
+	void addStage(const StreamStage& stage) { m_stages.push_back(stage); }
+
+	bool isParallel() const { return m_parallel; }
+	void setParallel() { m_parallel = true; }
+private:
+	Value* m_source;
+	StreamStages m_stages;
+	bool m_parallel;
+
+	DISALLOW_COPY_AND_ASSIGN(StreamValue);
+};
+
+} // clever
+
+#endif // CLEVER_STREAMVALUE_H
@@ -23,10 +23,52 @@
  * OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#if defined(CLEVER_DEBUG) && defined(HAVE_LIBPTHREAD)
+# include <pthread.h>
+#endif
 #include "types/type.h"
 
 namespace clever {
 
+size_t Type::s_method_generation = 1;
+
+#if defined(CLEVER_DEBUG) && defined(HAVE_LIBPTHREAD)
+// Static initialization runs on the thread which later runs the VM
+static pthread_t s_main_thread = pthread_self();
+#endif
+
+/**
+ * Computes the dispatch cache key for a method name and its argument types
+ */
+static size_t _dispatch_key(CString::IdType name_id, const TypeVector* args) {
+	size_t key = name_id;
+
+	if (args) {
+		for (size_t i = 0, j = args->size(); i < j; ++i) {
+			key = key * 31 + (reinterpret_cast<size_t>(args->at(i)) >> 3);
+		}
+	}
+
+	return key;
+}
+
+/**
+ * Checks if the cache entry was resolved for the same name and signature
+ */
+static bool _dispatch_match(const Type::DispatchEntry& entry,
+	CString::IdType name_id, const TypeVector* args, size_t generation) {
+	if (entry.name_id != name_id
+		|| (entry.generation != 0 && entry.generation != generation)) {
+		return false;
+	}
+
+	if (args == NULL) {
+		return entry.args.empty();
+	}
+
+	return entry.args == *args;
+}
+
 Type::~Type() {
 	MethodMap::const_iterator it = m_methods.begin(), end = m_methods.end();
 
@@ -53,12 +95,24 @@ void Type::addMethod(Method* method) {
 		method->setReference(0);
 	}
 
+	// Previous resolutions might now find this method instead
+	++s_method_generation;
+
+	CString::IdType name_id = CSTRING(method->getName())->getId();
+	DispatchEntry entry;
+
+	entry.name_id = name_id;
+	entry.method = method;
+
 	std::vector<const Type*> v_args;
 	for (int n = 1; it != args.end(); ++it, ++n) {
 		v_args.push_back(it->second);
 		if (min_args != num_args && n >= min_args) {
 			m_methods[method->getName()].insert(MethodPair(v_args, method));
 			method->addRef();
+
+			entry.args = v_args;
+			m_dispatch[_dispatch_key(name_id, &v_args)] = entry;
 		}
 	}/*
 		if (method->getName() == "call") {
@@ -67,13 +121,60 @@ void Type::addMethod(Method* method) {
 		*/
 	if (min_args == num_args || num_args == -1) {
 		m_methods[method->getName()].insert(MethodPair(v_args, method));
+
+		entry.args = v_args;
+		m_dispatch[_dispatch_key(name_id, &v_args)] = entry;
+	}
+}
+
+void Type::setInfallibleMethods() {
+	MethodMap::iterator it(m_methods.begin()), end(m_methods.end());
+
+	for (; it != end; ++it) {
+		OverloadMethodMap::iterator ov(it->second.begin());
+
+		for (; ov != it->second.end(); ++ov) {
+			ov->second->setInfallible();
+		}
 	}
 }
 
 const Method* Type::getMethod(const CString* name, const TypeVector* args) const {
+#if defined(CLEVER_DEBUG) && defined(HAVE_LIBPTHREAD)
+	clever_assert(pthread_equal(pthread_self(), s_main_thread),
+		"Method lookup must run on the main thread");
+#endif
+	CString::IdType name_id = name->getId();
+	size_t key = _dispatch_key(name_id, args);
+	DispatchCache::const_iterator it = m_dispatch.find(key);
+
+	if (EXPECTED(it != m_dispatch.end())
+		&& _dispatch_match(it->second, name_id, args, s_method_generation)) {
+		return it->second.method;
+	}
+
+	const Method* method = _lookup_method(name, args);
+
+	if (method) {
+		DispatchEntry& entry = m_dispatch[key];
+
+		entry.name_id = name_id;
+		entry.args = args ? *args : TypeVector();
+		entry.method = method;
+		entry.generation = s_method_generation;
+	}
+
+	return method;
+}
+
+/**
+ * Resolves the method by looking up the overloads of this type (and its
+ * super types) which accept the argument types
+ */
+const Method* Type::_lookup_method(const CString* name, const TypeVector* args) const {
 	MethodMap::const_iterator it1 = m_methods.find(*name);
 	
-	if (it1 == m_methods.end() && name != CSTRING(CLEVER_CTOR_NAME)) {
+	if (it1 == m_methods.end() && name != CACHE_PTR(CLEVER_CTOR, CLEVER_CTOR_NAME)) {
 		// Looking up for super type's methods
 		if (getSuperType()) {
 			return getSuperType()->getMethod(name, args);
@@ -112,7 +213,7 @@ const Method* Type::getMethod(const CString* name, const TypeVector* args) const
 	}
 
 	// If we didn't find the method yet, look for it in the super type
-	if (getSuperType() && name != CSTRING(CLEVER_CTOR_NAME)) {
+	if (getSuperType() && name != CACHE_PTR(CLEVER_CTOR, CLEVER_CTOR_NAME)) {
 		return getSuperType()->getMethod(name, args);
 	}
 
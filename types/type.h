@@ -160,6 +160,28 @@ public:
 	typedef std::tr1::unordered_map<std::string, OverloadMethodMap> MethodMap;
 	typedef std::pair<std::vector<const Type*>, Method*> MethodPair;
 	typedef std::tr1::unordered_set<const Type*> InterfaceSet;
+
+	/**
+	 * Method dispatch cache entry
+	 */
+	struct DispatchEntry {
+		DispatchEntry()
+			: name_id(0), method(NULL), generation(0) {}
+
+		CString::IdType name_id;
+		TypeVector args;
+		const Method* method;
+
+		// Method table generation when the method was resolved, 0 means
+		// an exact signature registered by addMethod() (never stale)
+		size_t generation;
+	};
+
+	/**
+	 * Dispatch cache keyed by the method name id combined with the
+	 * argument types signature
+	 */
+	typedef std::tr1::unordered_map<size_t, DispatchEntry> DispatchCache;
 	
 	enum Kind {
 		PRIMITIVE,
@@ -174,6 +196,19 @@ public:
 	virtual ~Type();
 
 	void addMethod(Method*);
+
+	/**
+	 * Marks every method added so far as infallible, for types whose
+	 * methods never report errors, see Method::setInfallible()
+	 */
+	void setInfallibleMethods();
+
+	/**
+	 * Returns the method matching the name and argument types, looking
+	 * first in the dispatch cache. Resolutions are cached without locking,
+	 * so this must only be called from the main thread: work pool tasks
+	 * only run thread-safe natives and the RPC threads only handle raw buffers
+	 */
 	const Method* getMethod(const CString*, const TypeVector*) const;
 
 	const CString* getName() const {
@@ -272,6 +307,14 @@ protected:
 	// Methods belonging this type
 	MethodMap m_methods;
 
+	// Resolved methods by name and signature, filled by getMethod() on
+	// the main thread only
+	mutable DispatchCache m_dispatch;
+
+	// Incremented every time a method is added to any type, so that the
+	// resolutions which could change are detected as stale
+	static size_t s_method_generation;
+
 	// This type's name
 	const CString* const m_name;
 
@@ -284,6 +327,8 @@ protected:
 	// Type kind
 	const Kind m_kind;
 private:
+	const Method* _lookup_method(const CString*, const TypeVector*) const;
+
 	DISALLOW_COPY_AND_ASSIGN(Type);
 };
 
@@ -0,0 +1,247 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+# include <unistd.h>
+#endif
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include "types/workpool.h"
+
+namespace clever {
+
+size_t WorkPool::getNumWorkers(size_t size, size_t grain) {
+#ifdef HAVE_LIBPTHREAD
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return std::max(size_t(1),
+		std::min(size_t(ncpu > 0 ? ncpu : 1), size / (grain ? grain : 1)));
+#else
+	return 1;
+#endif
+}
+
+#ifdef HAVE_LIBPTHREAD
+typedef std::pair<size_t, size_t> WorkRange;
+
+/**
+ * Chunks owned by a worker; the owner takes from the back and the other
+ * workers steal from the front
+ */
+struct WorkQueue {
+	WorkQueue() { pthread_mutex_init(&lock, NULL); }
+	~WorkQueue() { pthread_mutex_destroy(&lock); }
+
+	bool take(WorkRange& range, bool steal) {
+		bool found = false;
+
+		pthread_mutex_lock(&lock);
+		if (!ranges.empty()) {
+			if (steal) {
+				range = ranges.front();
+				ranges.pop_front();
+			} else {
+				range = ranges.back();
+				ranges.pop_back();
+			}
+			found = true;
+		}
+		pthread_mutex_unlock(&lock);
+
+		return found;
+	}
+
+	pthread_mutex_t lock;
+	std::deque<WorkRange> ranges;
+};
+
+struct WorkState {
+	std::vector<WorkQueue*> queues;
+	RangeTask task;
+	void* data;
+};
+
+/**
+ * Helper threads are started on demand and kept for the whole process,
+ * sleeping on work_cond until run() publishes a new generation of work
+ */
+static pthread_mutex_t g_run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;
+static std::vector<pthread_t> g_helpers;
+static WorkState* g_state = NULL;
+static size_t g_generation = 0;
+static size_t g_pending = 0;
+
+static void _work(WorkState* state, size_t id) {
+	size_t nqueues = state->queues.size();
+	WorkRange range;
+
+	while (true) {
+		bool found = state->queues[id]->take(range, false);
+
+		// Nothing is queued after start, so empty queues mean we're done
+		for (size_t i = 1; !found && i < nqueues; ++i) {
+			found = state->queues[(id + i) % nqueues]->take(range, true);
+		}
+
+		if (!found) {
+			break;
+		}
+
+		state->task(range.first, range.second, id, state->data);
+	}
+}
+
+/**
+ * A new helper only answers generations published after it was created
+ */
+struct HelperStart {
+	size_t id;
+	size_t generation;
+};
+
+static void* _helper(void* arg) {
+	HelperStart* start = static_cast<HelperStart*>(arg);
+	size_t id = start->id;
+	size_t seen = start->generation;
+
+	delete start;
+
+	pthread_mutex_lock(&g_lock);
+
+	while (true) {
+		while (seen == g_generation) {
+			pthread_cond_wait(&g_work_cond, &g_lock);
+		}
+		seen = g_generation;
+
+		WorkState* state = g_state;
+
+		pthread_mutex_unlock(&g_lock);
+
+		// Helpers beyond this run's worker count just check in
+		if (id < state->queues.size()) {
+			_work(state, id);
+		}
+
+		pthread_mutex_lock(&g_lock);
+		if (--g_pending == 0) {
+			pthread_cond_signal(&g_done_cond);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Grows the helper set to nhelpers threads, returns how many are running
+ */
+static size_t _start_helpers(size_t nhelpers) {
+	pthread_mutex_lock(&g_lock);
+
+	while (g_helpers.size() < nhelpers) {
+		pthread_t thread;
+		HelperStart* start = new HelperStart;
+
+		start->id = g_helpers.size() + 1;
+		start->generation = g_generation;
+
+		if (pthread_create(&thread, NULL, _helper, start) != 0) {
+			delete start;
+			break;
+		}
+		g_helpers.push_back(thread);
+	}
+
+	size_t running = g_helpers.size();
+
+	pthread_mutex_unlock(&g_lock);
+
+	return running;
+}
+#endif
+
+void WorkPool::run(size_t size, size_t grain, RangeTask task, void* data) {
+	size_t nworkers = getNumWorkers(size, grain);
+
+	if (nworkers < 2) {
+		task(0, size, 0, data);
+		return;
+	}
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&g_run_lock);
+
+	WorkState state;
+	size_t nchunks = (size + grain - 1) / grain;
+	size_t nhelpers = _start_helpers(nworkers - 1);
+
+	state.task = task;
+	state.data = data;
+
+	// Each worker starts with a contiguous run of chunks, the queues of
+	// helpers which couldn't be started get stolen by the others
+	for (size_t i = 0; i < nworkers; ++i) {
+		WorkQueue* queue = new WorkQueue;
+		size_t first = i * nchunks / nworkers;
+		size_t last = (i + 1) * nchunks / nworkers;
+
+		for (size_t c = first; c < last; ++c) {
+			queue->ranges.push_back(
+				WorkRange(c * grain, std::min(size, (c + 1) * grain)));
+		}
+		state.queues.push_back(queue);
+	}
+
+	pthread_mutex_lock(&g_lock);
+	g_state = &state;
+	g_pending = nhelpers;
+	++g_generation;
+	pthread_cond_broadcast(&g_work_cond);
+	pthread_mutex_unlock(&g_lock);
+
+	// The first worker runs on the calling thread
+	_work(&state, 0);
+
+	pthread_mutex_lock(&g_lock);
+	while (g_pending > 0) {
+		pthread_cond_wait(&g_done_cond, &g_lock);
+	}
+	g_state = NULL;
+	pthread_mutex_unlock(&g_lock);
+
+	for (size_t i = 0; i < nworkers; ++i) {
+		delete state.queues[i];
+	}
+
+	pthread_mutex_unlock(&g_run_lock);
+#endif
+}
+
+} // clever
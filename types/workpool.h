@@ -0,0 +1,64 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_WORKPOOL_H
+#define CLEVER_WORKPOOL_H
+
+#include <cstddef>
+
+namespace clever {
+
+/**
+ * Work over the index range [begin, end) done by the given worker
+ */
+typedef void (*RangeTask)(size_t begin, size_t end, size_t worker, void* data);
+
+/**
+ * Splits an index range into chunks run by a set of threads. Each worker
+ * owns a queue of chunks and steals from the other queues when its own is
+ * empty. The helper threads are started by the first run needing them and
+ * then sleep between runs. Tasks must not enter the VM; they may only touch
+ * their own range and the per-worker data selected by the worker number.
+ */
+class WorkPool {
+public:
+	/**
+	 * Number of workers used to run a range of the given size, this is 1
+	 * when threads aren't available or the range is too small
+	 */
+	static size_t getNumWorkers(size_t size, size_t grain);
+
+	/**
+	 * Runs the task over [0, size) and waits for all the workers, runs
+	 * from several threads are serialized
+	 */
+	static void run(size_t size, size_t grain, RangeTask task, void* data);
+private:
+	WorkPool() {}
+};
+
+} // clever
+
+#endif // CLEVER_WORKPOOL_H
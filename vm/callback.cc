@@ -0,0 +1,79 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "vm/callback.h"
+#include "compiler/scope.h"
+#include "types/function.h"
+
+namespace clever {
+
+Callback::Callback(const Function* func)
+	: m_func(func), m_running(false) {
+	const FunctionArgs& fargs = func->getArgs();
+
+	m_args.reserve(fargs.size());
+
+	for (size_t i = 0, sz = fargs.size(); i < sz; ++i) {
+		m_args.push_back(new Value(fargs[i].type));
+
+		if (func->isUserDefined()) {
+			m_params.push_back(
+				func->getScope()->getValue(CSTRING(fargs[i].name)));
+		}
+	}
+}
+
+Callback::~Callback() {
+	for (size_t i = 0, sz = m_args.size(); i < sz; ++i) {
+		m_args[i]->delRef();
+	}
+}
+
+void Callback::call(Value* retval) {
+	bool has_return = m_func->getReturnType() != CLEVER_VOID;
+
+	if (!m_func->isUserDefined()) {
+		FunctionType::invoke(m_func, &m_args, retval, has_return);
+		return;
+	}
+
+	if (m_running) {
+		// Re-entered from the function itself, use a regular execution
+		FunctionType::invoke(m_func, &m_args, retval, has_return);
+		return;
+	}
+
+	m_running = true;
+	VM::run(this);
+	m_running = false;
+
+	if (has_return && VM::getLastReturnValue()) {
+		retval->copy(VM::getLastReturnValue());
+	} else if (!has_return) {
+		retval->setTypePtr(CLEVER_VOID);
+	}
+}
+
+} // clever
@@ -0,0 +1,82 @@
+/**
+ * Clever programming language
+ * Copyright (c) 2011-2012 Clever Team
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLEVER_CALLBACK_H
+#define CLEVER_CALLBACK_H
+
+#include <vector>
+#include "compiler/value.h"
+#include "vm/vm.h"
+
+namespace clever {
+
+/**
+ * Prepared call handle used by native code to call a function many times,
+ * e.g. once per element. The argument slots and the execution state are
+ * allocated once and reused on every call.
+ */
+class Callback {
+public:
+	explicit Callback(const Function*);
+
+	~Callback();
+
+	const Function* getFunction() const { return m_func; }
+
+	size_t getNumArgs() const { return m_args.size(); }
+
+	/**
+	 * Returns the i-th argument slot, to be filled before calling
+	 */
+	Value* getArg(size_t i) { return m_args[i]; }
+
+	void setArg(size_t i, const Value* value) { m_args[i]->copy(value); }
+
+	/**
+	 * Calls the function with the current argument slots, retval receives
+	 * the return value when the function isn't Void
+	 */
+	void call(Value* retval);
+private:
+	friend class VM;
+
+	const Function* m_func;
+
+	// Argument slots filled by the caller
+	ValueVector m_args;
+
+	// Parameter variables in the function scope, bound on each call
+	std::vector<Value*> m_params;
+
+	// Execution state reused while the callback isn't re-entered
+	VMVars m_vars;
+	bool m_running;
+
+	DISALLOW_COPY_AND_ASSIGN(Callback);
+};
+
+} // clever
+
+#endif // CLEVER_CALLBACK_H
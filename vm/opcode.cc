@@ -59,6 +59,7 @@ const char* Opcode::getOpName(OpcodeType op) const {
 		CASE(OP_MCALL);
 		CASE(OP_FCALL);
 		CASE(OP_RETURN);
+		CASE(OP_YIELD);
 		CASE(OP_REGEX);
 		CASE(OP_NOT);
 		CASE(OP_BW_NOT);
@@ -83,6 +84,14 @@ const char* Opcode::getOpName(OpcodeType op) const {
 		CASE(OP_INIT_VAR);
 		CASE(OP_LEAVE);
 		CASE(OP_CLONE);
+		CASE(OP_CONCAT);
+		CASE(OP_FOREACH_INIT);
+		CASE(OP_FOREACH_NEXT);
+		CASE(OP_SWITCH_TABLE);
+		CASE(OP_SWITCH_SEARCH);
+		CASE(OP_SWITCH_HASH);
+		CASE(OP_ARRAY_AT);
+		CASE(OP_ARRAY_SET);
 		default:
 			return "UNKNOWN";
 	}
@@ -189,6 +198,14 @@ VM::opcode_handler Opcode::getHandlerByType(OpcodeType op_type) {
 		case OP_BW_NOT:  return &VM_H(bw_not);
 		case OP_INIT_VAR:return &VM_H(init_var);
 		case OP_CLONE:   return &VM_H(clone);
+		case OP_CONCAT:  return &VM_H(concat);
+		case OP_FOREACH_INIT: return &VM_H(foreach_init);
+		case OP_FOREACH_NEXT: return &VM_H(foreach_next);
+		case OP_SWITCH_TABLE: return &VM_H(switch_table);
+		case OP_SWITCH_SEARCH: return &VM_H(switch_search);
+		case OP_SWITCH_HASH: return &VM_H(switch_hash);
+		case OP_ARRAY_AT: return &VM_H(array_at);
+		case OP_ARRAY_SET: return &VM_H(array_set);
 		default:	     return &VM_H(mcall);
 	}
 }
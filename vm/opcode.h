@@ -46,6 +46,7 @@ enum OpcodeType {
 	OP_FCALL,
 	OP_MCALL,
 	OP_RETURN,
+	OP_YIELD,
 	OP_REGEX,
 	OP_NOT,
 	OP_BW_NOT,
@@ -69,7 +70,15 @@ enum OpcodeType {
 	OP_AT,
 	OP_INIT_VAR,
 	OP_LEAVE,
-	OP_CLONE
+	OP_CLONE,
+	OP_CONCAT,
+	OP_FOREACH_INIT,
+	OP_FOREACH_NEXT,
+	OP_SWITCH_TABLE,
+	OP_SWITCH_SEARCH,
+	OP_SWITCH_HASH,
+	OP_ARRAY_AT,
+	OP_ARRAY_SET
 };
 
 /**
@@ -93,6 +102,11 @@ public:
 		: m_type(op_type), m_handler(handler), m_op1(op1), m_op2(),
 			m_result() {}
 
+	Opcode(OpcodeType op_type, VM::opcode_handler handler, long op1,
+		ValueVector* op2)
+		: m_type(op_type), m_handler(handler), m_op1(op1), m_op2(op2),
+			m_result() {}
+
 	Opcode(OpcodeType op_type, VM::opcode_handler handler, Value* op1,
 		Value* op2, Value* result)
 		: m_type(op_type), m_handler(handler), m_op1(op1), m_op2(op2),
@@ -109,6 +123,11 @@ public:
 
 	VM::opcode_handler getHandler() const { return m_handler; }
 
+	void setHandler(OpcodeType op_type, VM::opcode_handler handler) {
+		m_type = op_type;
+		m_handler = handler;
+	}
+
 	const Operand& getOp1() const { return m_op1; }
 	Value* getOp1Value() const { return m_op1.getValue(); }
 	CallableValue* getOp1Callable() const { return m_op1.getCallable(); }
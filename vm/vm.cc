@@ -24,10 +24,15 @@
  */
 
 #include <iostream>
+#include <limits>
 #include "vm/vm.h"
 #include "vm/opcode.h"
 #include "compiler/compiler.h"
 #include "compiler/scope.h"
+#include "types/arrayvalue.h"
+#include "types/mapiteratorvalue.h"
+#include "types/generatorvalue.h"
+#include "vm/callback.h"
 
 namespace clever {
 
@@ -37,14 +42,20 @@ const OpcodeList* VM::s_opcodes;
 const Value* VM::s_return_value;
 
 inline void VM::start_new_execution() {
+	VMVars* caller = s_var;
+
 	s_vars.push(VMVars());
 	s_var = &s_vars.top();
 	s_var->running = true;
+	s_var->generator = NULL;
+	s_var->caller = caller;
 }
 
 inline void VM::end_current_execution() {
+	VMVars* caller = s_var->caller;
+
 	s_vars.pop();
-	s_var = &s_vars.top();
+	s_var = caller;
 }
 
 /**
@@ -76,6 +87,17 @@ void VM::run(size_t start, VMMode mode) {
 void VM::run(const Function* func, const ValueVector* args) {
 	clever_assert_not_null(func);
 
+	std::string key;
+
+	if (UNEXPECTED(func->isMemoized())) {
+		const Value* cached = memo_find(func, args, key);
+
+		if (cached) {
+			s_return_value = cached;
+			return;
+		}
+	}
+
 	start_new_execution();
 
 	size_t last_op = s_opcodes->size();
@@ -85,6 +107,10 @@ void VM::run(const Function* func, const ValueVector* args) {
 
 	s_var->call.push(StackFrame(NULL));
 
+	if (UNEXPECTED(func->isMemoized())) {
+		memo_bind(func, key);
+	}
+
 	if (args) {
 		push_args(func->getScope(), func->getArgs(), args);
 	}
@@ -101,6 +127,269 @@ void VM::run(const Function* func, const ValueVector* args) {
 	end_current_execution();
 }
 
+/**
+ * Resumes a generator body until its next yield or its end
+ */
+void VM::resume(GeneratorValue* gen) {
+	clever_assert_not_null(gen);
+
+	start_new_execution();
+
+	size_t last_op = s_opcodes->size();
+
+	s_var->mode = INTERNAL;
+	s_var->generator = gen;
+
+	s_var->call.push(StackFrame(NULL));
+
+	gen->resetYielded();
+	gen->swapFrame();
+
+	for (size_t next_op = gen->getNextOp(); next_op < last_op && s_var->running; ++next_op) {
+		const Opcode& opcode = *(*s_opcodes)[next_op];
+
+		// Invoke the opcode handler
+		opcode.getHandler()(opcode, next_op);
+	}
+
+	gen->swapFrame();
+
+	// Reached return or the end of the function
+	if (!gen->hasYielded()) {
+		gen->setDone();
+	}
+
+	end_current_execution();
+}
+
+/**
+ * Collects the variables of the generator function scope and its children
+ */
+static void _save_generator_frame(Scope* scope, GeneratorValue::Frame& frame) {
+	const SymbolMap& symbols = scope->getSymbols();
+	SymbolMap::const_iterator it(symbols.begin()), end(symbols.end());
+
+	while (it != end) {
+		if (it->second->isValue()) {
+			Value* val = it->second->getValue();
+
+			if (!val->isCallable()) {
+				Value* tmp = new Value;
+				tmp->copy(val);
+				frame.push_back(VarPair(val, tmp));
+			}
+		}
+		++it;
+	}
+
+	const ScopeVector& children = scope->getChildren();
+
+	for (size_t i = 0, j = children.size(); i < j; ++i) {
+		_save_generator_frame(children[i], frame);
+	}
+}
+
+/**
+ * Creates the generator returned by calling a generator function, the
+ * arguments are bound to its saved frame and the body starts on first use
+ */
+static GeneratorValue* _new_generator(const Function* func,
+	const ValueVector* args) {
+	GeneratorValue* gen = new GeneratorValue(func);
+	GeneratorValue::Frame& frame = gen->getFrame();
+	Scope* scope = func->getScope();
+
+	_save_generator_frame(scope, frame);
+
+	if (args == NULL) {
+		return gen;
+	}
+
+	const FunctionArgs& fargs = func->getArgs();
+
+	for (size_t i = 0, j = fargs.size(); i < j; ++i) {
+		Value* var = scope->getLocalValue(CSTRING(fargs[i].name));
+
+		for (size_t k = 0, l = frame.size(); k < l; ++k) {
+			if (frame[k].first == var) {
+				frame[k].second->copy(args->at(i));
+				break;
+			}
+		}
+	}
+
+	return gen;
+}
+
+/**
+ * Integer division and modulo by zero (or overflowing) trap, so they are
+ * never run by the compile time evaluation
+ */
+static bool _eval_traps(const Opcode& opcode) {
+	if (opcode.getOp1().getType() != VALUE
+		|| opcode.getOp2().getType() != VECTOR
+		|| opcode.getOp1Value() == NULL
+		|| !opcode.getOp1Value()->isCallable()) {
+		return false;
+	}
+
+	const CallableValue* call = opcode.getOp1Callable();
+	bool is_mod = opcode.getType() == OP_MOD;
+
+	// Explicit calls, e.g. x.__div__(y)
+	if (opcode.getType() == OP_MCALL && call->isMethod() && call->getMethod()) {
+		const std::string& name = call->getMethod()->getName();
+
+		is_mod = name == CLEVER_OPERATOR_MOD;
+
+		if (!is_mod && name != CLEVER_OPERATOR_DIV) {
+			return false;
+		}
+	} else if (!is_mod && opcode.getType() != OP_DIV) {
+		return false;
+	}
+
+	const ValueVector* args = opcode.getOp2Vector();
+
+	if (args == NULL || args->empty()) {
+		return false;
+	}
+
+	const Value* lhs = args->size() > 1 ? args->front() : call->getContext();
+	const Value* rhs = args->back();
+
+	if (rhs->isInteger()) {
+		int64_t min = std::numeric_limits<int64_t>::min();
+
+		return rhs->getInteger() == 0 || (rhs->getInteger() == -1
+			&& lhs && lhs->isInteger() && lhs->getInteger() == min);
+	}
+	if (rhs->isByte()) {
+		return rhs->getByte() == 0;
+	}
+
+	// Integer::mod truncates a Double divisor
+	return is_mod && rhs->isDouble();
+}
+
+/**
+ * Runs a function while its caller is still being compiled, giving up
+ * after max_ops opcodes or before an operation which would trap. The
+ * function may only call infallible methods, see _is_foldable(). Returns
+ * the value returned by the function or NULL when it didn't finish
+ */
+const Value* VM::eval(OpcodeList* opcodes, const Function* func,
+	const ValueVector* args, size_t max_ops) {
+	const OpcodeList* saved_opcodes = s_opcodes;
+	bool finished = false;
+	size_t count = 0;
+
+	s_opcodes = opcodes;
+	s_return_value = NULL;
+
+	start_new_execution();
+
+	s_var->mode = INTERNAL;
+	s_var->call.push(StackFrame(NULL));
+
+	if (args) {
+		push_args(func->getScope(), func->getArgs(), args);
+	}
+
+	for (size_t next_op = func->getOffset() + 1, last_op = opcodes->size();
+		next_op < last_op && s_var->running; ++next_op) {
+		const Opcode& opcode = *(*s_opcodes)[next_op];
+
+		if (++count > max_ops || _eval_traps(opcode)) {
+			break;
+		}
+
+		opcode.getHandler()(opcode, next_op);
+	}
+
+	finished = !s_var->running;
+
+	// Release the frames left by an unfinished run
+	while (!s_var->call.empty()) {
+		StackFrame& frame = s_var->call.top();
+
+		for (size_t k = 0; frame.params && k < frame.params->size(); ++k) {
+			delete frame.params->at(k).second;
+		}
+		for (size_t k = 0; frame.locals && k < frame.locals->size(); ++k) {
+			delete frame.locals->at(k).second;
+		}
+		delete frame.params;
+		delete frame.locals;
+
+		s_var->call.pop();
+	}
+
+	while (!s_var->context.empty()) {
+		for (size_t k = 0; k < s_var->context.top().size(); ++k) {
+			delete s_var->context.top().at(k).second;
+		}
+		s_var->context.pop();
+	}
+
+	end_current_execution();
+
+	s_opcodes = saved_opcodes;
+
+	return finished ? s_return_value : NULL;
+}
+
+/**
+ * Runs a prepared callback on its own execution state, which is reused
+ * between calls instead of pushing a new one
+ */
+void VM::run(Callback* callback) {
+	const Function* func = callback->m_func;
+	VMVars* vars = &callback->m_vars;
+	size_t last_op = s_opcodes->size();
+	size_t start = func->getOffset() + 1;
+	std::string key;
+
+	if (UNEXPECTED(func->isMemoized())) {
+		const Value* cached = memo_find(func, &callback->m_args, key);
+
+		if (cached) {
+			s_return_value = cached;
+			return;
+		}
+	}
+
+	vars->mode = INTERNAL;
+	vars->running = true;
+	vars->generator = NULL;
+	vars->caller = s_var;
+
+	s_var = vars;
+	s_var->call.push(StackFrame(NULL));
+
+	if (UNEXPECTED(func->isMemoized())) {
+		memo_bind(func, key);
+	}
+
+	// The parameters are bound straight into the function scope
+	for (size_t i = 0, sz = callback->m_params.size(); i < sz; ++i) {
+		callback->m_params[i]->copy(callback->m_args[i]);
+	}
+
+	for (size_t next_op = start; next_op < last_op && s_var->running; ++next_op) {
+		const Opcode& opcode = *(*s_opcodes)[next_op];
+
+		opcode.getHandler()(opcode, next_op);
+	}
+
+	// A function leaving without return keeps its frame
+	while (!vars->call.empty()) {
+		vars->call.pop();
+	}
+
+	s_var = vars->caller;
+}
+
 /**
  * Destroy the opcodes data
  */
@@ -340,6 +629,27 @@ CLEVER_VM_HANDLER(VM::jmp_handler) {
 	CLEVER_VM_GOTO(opcode.getJmpAddr1());
 }
 
+/**
+ * Looks up the result of a call to a memoized function, on a miss the key
+ * is kept for memo_bind()
+ */
+const Value* VM::memo_find(const Function* func, const ValueVector* args,
+	std::string& key) {
+	MemoCache::buildKey(args, key);
+
+	return func->getMemo()->find(key);
+}
+
+/**
+ * Makes the return from the current stack frame store the result
+ */
+void VM::memo_bind(const Function* func, std::string& key) {
+	StackFrame& frame = s_var->call.top();
+
+	frame.memo = func->getMemo();
+	frame.memo_key.swap(key);
+}
+
 /**
  * Performs a function call
  */
@@ -352,12 +662,34 @@ CLEVER_VM_HANDLER(VM::fcall_handler) {
 	if (func->isNearCall()) {
 		const Function* fptr = func->getFunction();
 
+		// Generators just save their arguments, the body runs on demand
+		if (fptr->isGenerator()) {
+			result->setDataValue(_new_generator(fptr, args));
+			return;
+		}
+
+		std::string key;
+
+		// Memoized functions don't run the body when the result is cached
+		if (UNEXPECTED(fptr->isMemoized())) {
+			const Value* cached = memo_find(fptr, args, key);
+
+			if (cached) {
+				result->copy(cached);
+				return;
+			}
+		}
+
 		// New context
 		s_var->context.push(VarVector());
 
 		// New stack frame
 		s_var->call.push(StackFrame(&opcode));
 
+		if (UNEXPECTED(fptr->isMemoized())) {
+			memo_bind(fptr, key);
+		}
+
 		if (EXPECTED(args != NULL)) {
 			push_args(fptr->getScope(), fptr->getArgs(), args);
 		}
@@ -436,11 +768,15 @@ CLEVER_VM_HANDLER(VM::return_handler) {
 	const Value* const value = opcode.getOp1Value();
 
 	if (!s_var->call.empty()) {
-		const Opcode* call = s_var->call.top().ret;
+		const StackFrame& frame = s_var->call.top();
+		const Opcode* call = frame.ret;
 
 		if (EXPECTED(call && value)) {
 			call->getResultValue()->copy(value);
 		}
+		if (UNEXPECTED(frame.memo != NULL) && value) {
+			frame.memo->insert(frame.memo_key, value);
+		}
 		// pop + restore arguments from stack
 		pop_args(call);
 		restore_local_vars();
@@ -474,6 +810,17 @@ CLEVER_VM_HANDLER(VM::return_handler) {
 	}
 }
 
+/**
+ * Suspends the running generator, handing the value to its caller
+ */
+CLEVER_VM_HANDLER(VM::yield_handler) {
+	clever_assert_not_null(s_var->generator);
+
+	s_var->generator->yield(opcode.getOp1Value(), next_op + 1);
+
+	CLEVER_VM_EXIT();
+}
+
 /**
  * Add arithmetic operation
  */
@@ -653,4 +1000,183 @@ CLEVER_VM_HANDLER(VM::clone_handler) {
 	save_context(opcode);
 }
 
+/**
+ * N-ary String concatenation (x + y + ... + z)
+ */
+CLEVER_VM_HANDLER(VM::concat_handler) {
+	const ValueVector* const args = opcode.getOp2Vector();
+	size_t i, size = args->size(), len = 0;
+
+	for (i = 0; i < size; ++i) {
+		len += args->at(i)->getString().size();
+	}
+
+	CString* str = const_cast<CString*>(CSTRINGT(""));
+
+	str->reserve(len);
+
+	for (i = 0; i < size; ++i) {
+		str->append(args->at(i)->getString());
+	}
+
+	opcode.getResultValue()->setString(str);
+	save_context(opcode);
+}
+
+/**
+ * Resets the foreach cursor: an index for Array, a MapIterator for Map
+ */
+CLEVER_VM_HANDLER(VM::foreach_init_handler) {
+	const Value* const collection = opcode.getOp1Value();
+	Value* cursor = opcode.getOp2Value();
+
+	if (cursor->isInteger()) {
+		cursor->setInteger(0);
+	} else {
+		cursor->setDataValue(new MapIteratorValue(
+			CLEVER_GET_VALUE(MapValue*, collection)));
+	}
+}
+
+/**
+ * Binds the current element (and key/index) to the loop variables and
+ * advances the cursor, or jumps out of the loop when it is exhausted
+ */
+CLEVER_VM_HANDLER(VM::foreach_next_handler) {
+	const ValueVector* const slots = opcode.getOp2Vector();
+	Value* cursor = slots->at(1);
+	Value* elem = slots->at(2);
+	Value* key = slots->size() > 3 ? slots->at(3) : NULL;
+
+	if (cursor->isInteger()) {
+		const ValueVector* array =
+			CLEVER_GET_VALUE(ArrayValue*, slots->at(0))->getArray();
+		int64_t index = cursor->getInteger();
+
+		if (size_t(index) >= array->size()) {
+			CLEVER_VM_GOTO(opcode.getJmpAddr1());
+		}
+
+		elem->copy(array->at(index));
+
+		if (key) {
+			key->setInteger(index);
+		}
+		cursor->setInteger(index + 1);
+	} else {
+		MapIteratorValue* it = CLEVER_GET_VALUE(MapIteratorValue*, cursor);
+
+		if (!it->valid()) {
+			CLEVER_VM_GOTO(opcode.getJmpAddr1());
+		}
+
+		if (key) {
+			key->copy(it->getIterator()->first);
+			elem->copy(it->getIterator()->second);
+		} else {
+			elem->copy(it->getIterator()->first);
+		}
+		++(*it);
+	}
+}
+
+/**
+ * Returns the integer being switched on
+ */
+static CLEVER_FORCE_INLINE int64_t _switch_key(const Value* value) {
+	return value->isByte() ? value->getByte() : value->getInteger();
+}
+
+/**
+ * SWITCH_TABLE - Jumps through a dense table indexed by the value
+ * Table: min, default addr, addr for min, addr for min+1, ...
+ */
+CLEVER_VM_HANDLER(VM::switch_table_handler) {
+	const ValueVector& table = *opcode.getOp2Vector();
+	// Unsigned, so keys far from min neither overflow nor land in range
+	uint64_t index = uint64_t(_switch_key(opcode.getOp1Value()))
+		- uint64_t(table[0]->getInteger());
+
+	if (index < table.size() - 2) {
+		CLEVER_VM_GOTO(table[index + 2]->getInteger());
+	}
+
+	CLEVER_VM_GOTO(table[1]->getInteger());
+}
+
+/**
+ * SWITCH_SEARCH - Binary search on the sorted case values
+ * Table: default addr, then (value, addr) pairs
+ */
+CLEVER_VM_HANDLER(VM::switch_search_handler) {
+	const ValueVector& table = *opcode.getOp2Vector();
+	int64_t key = _switch_key(opcode.getOp1Value());
+	size_t low = 0, high = (table.size() - 1) / 2;
+
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+
+		if (table[1 + mid * 2]->getInteger() < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if (low < (table.size() - 1) / 2 && table[1 + low * 2]->getInteger() == key) {
+		CLEVER_VM_GOTO(table[2 + low * 2]->getInteger());
+	}
+
+	CLEVER_VM_GOTO(table[0]->getInteger());
+}
+
+/**
+ * SWITCH_HASH - Perfect hash dispatch on the string id
+ * Table: default addr, multiplier, shift, then (id, addr) slots
+ */
+CLEVER_VM_HANDLER(VM::switch_hash_handler) {
+	const ValueVector& table = *opcode.getOp2Vector();
+	const CString* str = opcode.getOp1Value()->getStringP();
+	CString::IdType id = str->isInterned()
+		? str->getId() : CStringTable::getId(str->str());
+	size_t slot = (id * CString::IdType(table[1]->getInteger()))
+		>> table[2]->getInteger();
+
+	if (CString::IdType(table[3 + slot * 2]->getInteger()) == id) {
+		CLEVER_VM_GOTO(table[4 + slot * 2]->getInteger());
+	}
+
+	CLEVER_VM_GOTO(table[0]->getInteger());
+}
+
+/**
+ * ARRAY_AT - Array<T>::at() on an index known to be in range
+ */
+CLEVER_VM_HANDLER(VM::array_at_handler) {
+	const ValueVector& vec = *CLEVER_GET_VALUE(ArrayValue*,
+		opcode.getOp1Callable()->getContext())->getArray();
+
+	opcode.getResultValue()->copy(
+		vec[(*opcode.getOp2Vector())[0]->getInteger()]);
+}
+
+/**
+ * ARRAY_SET - Array<T>::set() on an index known to be in range
+ */
+CLEVER_VM_HANDLER(VM::array_set_handler) {
+	ArrayValue* array = CLEVER_GET_VALUE(ArrayValue*,
+		opcode.getOp1Callable()->getContext());
+
+	array->detach();
+
+	ValueVector& vec = *array->getArray();
+	const ValueVector& args = *opcode.getOp2Vector();
+	Value*& elem = vec[args[0]->getInteger()];
+	Value* val = new Value();
+
+	val->copy(args[1]);
+	elem->delRef();
+	elem = val;
+}
+
 } // clever
@@ -50,6 +50,8 @@ namespace clever {
 class Opcode;
 class Scope;
 class Value;
+class Callback;
+struct GeneratorValue;
 
 typedef std::pair<Value*, Value*> VarPair;
 typedef std::vector<VarPair> VarVector;
@@ -59,7 +61,7 @@ typedef std::vector<VarPair> VarVector;
  */
 struct StackFrame {
 	StackFrame(const Opcode* opcode)
-		: ret(opcode), params(NULL), locals(NULL) {}
+		: ret(opcode), params(NULL), locals(NULL), memo(NULL) {}
 
 	// Return address as an opcode pointer
 	const Opcode* ret;
@@ -67,6 +69,10 @@ struct StackFrame {
 	// Local and parameter variables
 	VarVector* params;
 	VarVector* locals;
+
+	// Cache receiving the result of a memoized function call
+	MemoCache* memo;
+	std::string memo_key;
 };
 
 typedef std::vector<Opcode*> OpcodeList;
@@ -89,6 +95,10 @@ struct VMVars {
 	bool running;
 	CallStack call;
 	ContextStack context;
+	// Generator being resumed on this execution, if any
+	GeneratorValue* generator;
+	// Execution to go back to when this one ends
+	VMVars* caller;
 };
 typedef std::stack<VMVars> ExecVars;
 
@@ -115,6 +125,10 @@ public:
 	 */
 	static void run(size_t offset = 0, VMMode mode = NORMAL);
 	static void run(const Function*, const ValueVector*);
+	static void resume(GeneratorValue*);
+	static void run(Callback*);
+	static const Value* eval(OpcodeList*, const Function*, const ValueVector*,
+		size_t);
 
 	static void shutdown();
 
@@ -134,6 +148,13 @@ public:
 	static void pop_local_vars();
 	static void restore_local_vars();
 
+	/**
+	 * Memoized function results, used by every call path
+	 */
+	static const Value* memo_find(const Function*, const ValueVector*,
+		std::string&);
+	static void memo_bind(const Function*, std::string&);
+
 	/**
 	 * Context handling
 	 */
@@ -153,6 +174,7 @@ public:
 	static CLEVER_VM_HANDLER(assign_handler);
 	static CLEVER_VM_HANDLER(leave_handler);
 	static CLEVER_VM_HANDLER(return_handler);
+	static CLEVER_VM_HANDLER(yield_handler);
 	static CLEVER_VM_HANDLER(clone_handler);
 
 	/**
@@ -166,6 +188,30 @@ public:
 	static CLEVER_VM_HANDLER(inc_handler);
 	static CLEVER_VM_HANDLER(dec_handler);
 
+	/**
+	 * String operation
+	 */
+	static CLEVER_VM_HANDLER(concat_handler);
+
+	/**
+	 * Native Array and Map iteration
+	 */
+	static CLEVER_VM_HANDLER(foreach_init_handler);
+	static CLEVER_VM_HANDLER(foreach_next_handler);
+
+	/**
+	 * Switch dispatch
+	 */
+	static CLEVER_VM_HANDLER(switch_table_handler);
+	static CLEVER_VM_HANDLER(switch_search_handler);
+	static CLEVER_VM_HANDLER(switch_hash_handler);
+
+	/**
+	 * Array element access without bounds checking
+	 */
+	static CLEVER_VM_HANDLER(array_at_handler);
+	static CLEVER_VM_HANDLER(array_set_handler);
+
 	/**
 	 * Bit-wise operation
 	 */